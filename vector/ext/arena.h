@@ -0,0 +1,133 @@
+//Bump-pointer arena that lets pmr::vector grow in place
+//
+//std::pmr::monotonic_buffer_resource never reuses memory, so every time a vector in
+//it grows the old block is abandoned: building an n-element vector by push_back
+//burns about 2n elements' worth of arena on dead blocks, and several vectors
+//growing in turn make that worse. bump_arena is the same kind of monotonic,
+//request-scoped resource, but it is also a std::vector_expandable_resource:
+//when a vector's buffer is the arena's most recent allocation, growth just moves the
+//bump pointer (vector.h asks before it allocates), so nothing is copied and no
+//block is left behind.
+//
+//deallocate is a no-op; memory comes back all at once with release() or when the
+//arena is destroyed. Not thread safe, like monotonic_buffer_resource.
+//
+//    ext::bump_arena arena(stack_buffer, sizeof(stack_buffer));
+//    std::pmr::vector<int> v(&arena);
+//    for(...) v.push_back(x);    //grows in place while v is the latest allocation
+#pragma once
+#include "../vector.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+namespace ext{
+    class bump_arena : public std::vector_expandable_resource{
+    public:
+        explicit bump_arena(std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept
+            : m_upstream(upstream){}
+
+        //hand out the first initial_size bytes from one upstream chunk
+        explicit bump_arena(std::size_t initial_size, std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept
+            : m_upstream(upstream), m_first_chunk(initial_size > 0 ? initial_size : min_chunk), m_next_chunk(m_first_chunk){}
+
+        //start with a caller-owned buffer (e.g. on the stack); upstream is only used once it is full
+        bump_arena(void* buffer, std::size_t size, std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept
+            : m_upstream(upstream), m_buffer(static_cast<char*>(buffer)), m_buffer_size(size),
+              m_cur(m_buffer), m_end(m_buffer + size), m_first_chunk(size > min_chunk ? size * 2 : min_chunk), m_next_chunk(m_first_chunk){}
+
+        bump_arena(const bump_arena&) = delete;
+        bump_arena& operator=(const bump_arena&) = delete;
+
+        ~bump_arena() override{
+            release();
+        }
+
+        //return every upstream chunk and start again from the initial buffer.
+        //Everything allocated from the arena is invalid afterwards.
+        void release() noexcept{
+            while(m_chunks){
+                chunk* prev = m_chunks->prev;
+                m_upstream->deallocate(m_chunks, m_chunks->size, alignof(chunk));
+                m_chunks = prev;
+            }
+            m_cur = m_buffer;
+            m_end = m_buffer + m_buffer_size;
+            m_last = nullptr;
+            m_next_chunk = m_first_chunk;
+            m_used = 0;
+        }
+
+        //if p is the most recent allocation (old_bytes long), extend it to new_bytes
+        //without moving it. Shrinking always succeeds for the latest allocation.
+        bool try_expand(void* p, std::size_t old_bytes, std::size_t new_bytes) noexcept override{
+            char* c = static_cast<char*>(p);
+            if(c == nullptr || c != m_last || c + old_bytes != m_cur) return false;
+            if(new_bytes > static_cast<std::size_t>(m_end - c)) return false;
+            m_cur = c + new_bytes;
+            m_used = m_used - old_bytes + new_bytes;
+            return true;
+        }
+
+        [[nodiscard]] std::pmr::memory_resource* upstream_resource() const noexcept{ return m_upstream; }
+
+        //bytes handed out (including in-place growth), not counting alignment padding
+        [[nodiscard]] std::size_t bytes_used() const noexcept{ return m_used; }
+
+        //bytes left before the next upstream chunk is needed
+        [[nodiscard]] std::size_t bytes_remaining() const noexcept{ return static_cast<std::size_t>(m_end - m_cur); }
+
+    protected:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override{
+            char* p = align_up(m_cur, alignment);
+            if(p == nullptr || p > m_end || bytes > static_cast<std::size_t>(m_end - p)){
+                new_chunk(bytes, alignment);
+                p = align_up(m_cur, alignment);
+            }
+            m_cur = p + bytes;
+            m_last = p;
+            m_used += bytes;
+            return p;
+        }
+
+        void do_deallocate(void*, std::size_t, std::size_t) override{}
+
+    private:
+        static constexpr std::size_t min_chunk = 4096;
+
+        //header at the front of each upstream chunk, chained for release()
+        struct chunk{
+            chunk* prev;
+            std::size_t size;
+        };
+
+        static char* align_up(char* p, std::size_t alignment) noexcept{
+            if(p == nullptr) return nullptr;
+            auto v = reinterpret_cast<std::uintptr_t>(p);
+            return reinterpret_cast<char*>((v + alignment - 1) & ~(alignment - 1));
+        }
+
+        //chunks grow geometrically so a long-lived arena needs few upstream calls
+        void new_chunk(std::size_t bytes, std::size_t alignment){
+            std::size_t need = sizeof(chunk) + bytes + alignment;
+            std::size_t size = m_next_chunk > need ? m_next_chunk : need;
+            void* mem = m_upstream->allocate(size, alignof(chunk));
+            m_chunks = ::new(mem) chunk{m_chunks, size};
+            m_cur = reinterpret_cast<char*>(m_chunks + 1);
+            m_end = static_cast<char*>(mem) + size;
+            m_last = nullptr;
+            m_next_chunk = size * 2;
+        }
+
+        std::pmr::memory_resource* m_upstream;
+        char* m_buffer = nullptr;
+        std::size_t m_buffer_size = 0;
+        char* m_cur = nullptr;
+        char* m_end = nullptr;
+        char* m_last = nullptr;
+        chunk* m_chunks = nullptr;
+        std::size_t m_first_chunk = min_chunk;
+        std::size_t m_next_chunk = min_chunk;
+        std::size_t m_used = 0;
+    };
+}
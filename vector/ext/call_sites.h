@@ -0,0 +1,107 @@
+//Per-source-location records, shared by growth_sites.h and capacity_hints.h
+//
+//call_site_allocator<T, Site> is std::allocator<T> plus a pointer to the Site
+//for the source location that created it; vector<T, call_site_allocator<T,
+//Site>> reports to that Site through the customization points in vector.h.
+//The sites of each kind sit in a call_site_registry<Site>, one per source
+//location, and are never freed, so vectors destroyed during static destruction
+//can still report. A Site has
+//    const char* file; std::uint_least32_t line; const char* function;
+//    Site* next;                                   //the registry's list
+//    Site(const char* file, std::uint_least32_t line, const char* function)
+//    void allocated(std::size_t bytes) noexcept    //around every allocate
+//    void deallocated(std::size_t bytes) noexcept  //and deallocate
+//Allocators made without a site share one "(unattributed)" site with line 0.
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <source_location>
+
+namespace ext{
+    namespace detail{
+        template<class Site>
+        class call_site_registry{
+        public:
+            static call_site_registry& instance(){
+                static call_site_registry* registry = new call_site_registry;
+                return *registry;
+            }
+
+            Site* find(const std::source_location& loc){
+                return find(loc.file_name(), loc.line(), loc.function_name(), false);
+            }
+
+            //`own` copies the strings, for sites that do not come from a source_location
+            Site* find(const char* file, std::uint_least32_t line, const char* function, bool own){
+                std::lock_guard<std::mutex> lock(m_lock);
+                for(Site* s = m_sites.load(std::memory_order_relaxed); s; s = s->next){
+                    if(s->line == line && std::strcmp(s->file, file) == 0 && std::strcmp(s->function, function) == 0) return s;
+                }
+                if(own){
+                    file = ::strdup(file);
+                    function = ::strdup(function);
+                    if(!file || !function) throw std::bad_alloc();
+                }
+                return add(new Site(file, line, function));
+            }
+
+            Site* unattributed() noexcept{ return &m_unattributed; }
+
+            Site* head() const noexcept{ return m_sites.load(std::memory_order_acquire); }
+
+        private:
+            call_site_registry(){ add(&m_unattributed); }
+
+            Site* add(Site* s) noexcept{
+                s->next = m_sites.load(std::memory_order_relaxed);
+                m_sites.store(s, std::memory_order_release);
+                return s;
+            }
+
+            std::mutex m_lock;
+            std::atomic<Site*> m_sites{nullptr};
+            Site m_unattributed{"(unattributed)", 0, ""};
+        };
+    }
+
+    //where a call_site_allocator was made
+    template<class Site>
+    struct call_site_tag{
+        Site* site;
+    };
+
+    template<class T, class Site>
+    class call_site_allocator{
+    public:
+        using value_type = T;
+
+        call_site_allocator() noexcept : m_site(detail::call_site_registry<Site>::instance().unattributed()){}
+        call_site_allocator(call_site_tag<Site> tag) noexcept : m_site(tag.site){}
+        template<class U>
+        call_site_allocator(const call_site_allocator<U, Site>& other) noexcept : m_site(other.site()){}
+
+        [[nodiscard]] T* allocate(std::size_t n){
+            T* p = std::allocator<T>().allocate(n);
+            m_site->allocated(n * sizeof(T));
+            return p;
+        }
+
+        void deallocate(T* p, std::size_t n) noexcept{
+            m_site->deallocated(n * sizeof(T));
+            std::allocator<T>().deallocate(p, n);
+        }
+
+        [[nodiscard]] Site* site() const noexcept{ return m_site; }
+
+        //the memory itself is plain std::allocator memory, whatever the site
+        friend bool operator==(const call_site_allocator&, const call_site_allocator&) noexcept{ return true; }
+
+    private:
+        Site* m_site;
+    };
+}
@@ -0,0 +1,69 @@
+//malloc/free allocator whose zeroed blocks come from calloc
+//
+//vector<T>(n) and resize(n) value-initialise their new elements, which for an
+//int means writing n zeros, so every page of the buffer is touched and becomes
+//resident before the first real write. With calloc_allocator<T> a scalar T
+//takes the zeros calloc hands out instead (vector_allocator_zeroed in
+//vector.h). glibc's calloc does not clear a block it has just mmapped, which
+//is what a large allocation gets, nor the part of the heap it has just grown
+//into, so
+//    ext::calloc_vector<int> counts(std::size_t(1) << 30);     //4 GiB
+//costs a mmap and nothing more: the pages fault in as zero pages when first
+//touched, and pages never written never become resident. A block recycled from
+//the heap is cleared by calloc instead, which costs what the loop would.
+//
+//page_allocator (page_release.h) and reserving_allocator (reserved_vector.h)
+//always map fresh memory and take the same shortcut.
+#pragma once
+#include "../vector.h"
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace ext{
+    template<class T>
+    class calloc_allocator{
+    public:
+        using value_type = T;
+
+        calloc_allocator() noexcept = default;
+        template<class U>
+        calloc_allocator(const calloc_allocator<U>&) noexcept{}
+
+        [[nodiscard]] T* allocate(std::size_t n){
+            static_assert(alignof(T) <= alignof(std::max_align_t), "calloc_allocator aligns like malloc");
+            if(n > static_cast<std::size_t>(-1) / sizeof(T)) throw std::bad_array_new_length();
+            void* p = std::malloc(n * sizeof(T));
+            if(!p) throw std::bad_alloc();
+            return static_cast<T*>(p);
+        }
+
+        //n elements of all zero bytes
+        [[nodiscard]] T* allocate_zeroed(std::size_t n){
+            static_assert(alignof(T) <= alignof(std::max_align_t), "calloc_allocator aligns like malloc");
+            void* p = std::calloc(n, sizeof(T));
+            if(!p) throw std::bad_alloc();
+            return static_cast<T*>(p);
+        }
+
+        void deallocate(T* p, std::size_t) noexcept{
+            std::free(p);
+        }
+
+        friend bool operator==(const calloc_allocator&, const calloc_allocator&) noexcept{ return true; }
+    };
+
+    template<class T>
+    using calloc_vector = std::vector<T, calloc_allocator<T>>;
+}
+
+namespace std{
+    template<class T>
+    struct vector_allocator_zeroed<ext::calloc_allocator<T>>{
+        static constexpr bool enabled = true;
+
+        static T* allocate_zeroed(ext::calloc_allocator<T>& alloc, size_t n){
+            return alloc.allocate_zeroed(n);
+        }
+    };
+}
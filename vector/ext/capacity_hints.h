@@ -0,0 +1,196 @@
+//Capacity hints learned per call site
+//
+//hint_allocator<T> is std::allocator<T> plus a pointer to the source location
+//that created it (call_sites.h), like site_allocator in growth_sites.h. Every vector<T,
+//hint_allocator<T>> that allocated reports its size when it is destroyed, and
+//the site keeps a histogram of those final sizes. Once a site has seen
+//min_samples vectors, a new vector from it whose first growth comes from
+//push_back, emplace_back, insert or resize allocates the site's p90 final size
+//at once (vector_capacity_policy in vector.h), so nine in ten of them never
+//reallocate. An explicit reserve() or sized construction is left alone.
+//
+//The histogram is exact below 16 and has 8 steps per power of two above, so the
+//hint is at most 12.5% above the real p90; it is recomputed every 64 samples.
+//What counts is the size at destruction: a vector drained before it dies
+//teaches its site to expect small vectors.
+//
+//The learned table can be saved and loaded again at startup, so that sizes
+//seen in production become the hints of the next run without code changes:
+//    ext::hinted_vector<route> routes(ext::this_hint_site());
+//    ext::load_capacity_hints("hints.tsv");            //or VECTOR_CAPACITY_HINTS=hints.tsv
+//    ext::save_capacity_hints_at_exit("hints.tsv");
+//A loaded hint is used until the site has collected min_samples of its own.
+//The file is tab-separated text, sites matched by file, line and function:
+//    vector capacity hints 1
+//    <hint>	<samples>	<line>	<file>	<function>
+//
+//Looking up the site takes a lock, so do it where vectors are created, not per
+//element. Recording is a few relaxed atomic adds per destroyed vector.
+#pragma once
+#include "../vector.h"
+#include "call_sites.h"
+#include "log_linear_buckets.h"
+#include "posix_fd.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <source_location>
+#include <string>
+
+namespace ext{
+    namespace detail{
+        struct hint_site{
+            static constexpr std::size_t min_samples = 16;
+            using bucket = log_linear_buckets<3>;                  //8 steps per power of two, exact below 16
+
+            const char* file;
+            std::uint_least32_t line;
+            const char* function;
+            std::atomic<std::uint64_t> counts[bucket::count] = {};
+            std::atomic<std::uint64_t> samples{0};
+            std::atomic<std::uint64_t> loaded_samples{0};
+            std::atomic<std::size_t> hint{0};
+            hint_site* next = nullptr;
+
+            hint_site(const char* f, std::uint_least32_t l, const char* fn) noexcept : file(f), line(l), function(fn){}
+
+            void allocated(std::size_t) noexcept{}
+            void deallocated(std::size_t) noexcept{}
+
+            void record(std::size_t size) noexcept{
+                counts[bucket::index(size)].fetch_add(1, std::memory_order_relaxed);
+                const std::uint64_t n = samples.fetch_add(1, std::memory_order_relaxed) + 1;
+                if(n >= min_samples && (n < 64 || n % 64 == 0)) hint.store(p90(), std::memory_order_relaxed);
+            }
+
+            //the upper end of the bucket nine in ten sizes are at or below
+            [[nodiscard]] std::size_t p90() const noexcept{
+                std::uint64_t total = 0;
+                for(const auto& c : counts) total += c.load(std::memory_order_relaxed);
+                const std::uint64_t rank = (total * 9 + 9) / 10;
+                std::uint64_t seen = 0;
+                for(std::size_t i = 0; i < bucket::count; ++i){
+                    seen += counts[i].load(std::memory_order_relaxed);
+                    if(seen >= rank && seen > 0) return static_cast<std::size_t>(bucket::highest_in(i));
+                }
+                return 0;
+            }
+        };
+
+        //false if the file cannot be opened or is not a table; lines that do not parse are skipped
+        inline bool load_hints(call_site_registry<hint_site>& registry, const char* path){
+            std::ifstream in(path);
+            std::string line;
+            if(!in || !std::getline(in, line) || line != "vector capacity hints 1") return false;
+            while(std::getline(in, line)){
+                unsigned long long hint = 0, samples = 0;
+                unsigned long at = 0;
+                int used = 0;
+                if(std::sscanf(line.c_str(), "%llu\t%llu\t%lu\t%n", &hint, &samples, &at, &used) != 3 || used == 0) continue;
+                const std::size_t tab = line.find('\t', used);
+                if(tab == std::string::npos) continue;
+                const std::string file = line.substr(used, tab - used);
+                hint_site* s = registry.find(file.c_str(), static_cast<std::uint_least32_t>(at), line.c_str() + tab + 1, true);
+                s->loaded_samples.store(samples, std::memory_order_relaxed);
+                if(s->samples.load(std::memory_order_relaxed) < hint_site::min_samples) s->hint.store(hint, std::memory_order_relaxed);
+            }
+            return true;
+        }
+
+        //the registry, with VECTOR_CAPACITY_HINTS loaded into it on first use
+        inline call_site_registry<hint_site>& hint_sites(){
+            static call_site_registry<hint_site>& registry = []() -> call_site_registry<hint_site>&{
+                call_site_registry<hint_site>& r = call_site_registry<hint_site>::instance();
+                if(const char* path = std::getenv("VECTOR_CAPACITY_HINTS")) load_hints(r, path);
+                return r;
+            }();
+            return registry;
+        }
+    }
+
+    //where a hint_allocator was made; see this_hint_site()
+    using hint_site_tag = call_site_tag<detail::hint_site>;
+
+    [[nodiscard]] inline hint_site_tag this_hint_site(std::source_location loc = std::source_location::current()){
+        return {detail::hint_sites().find(loc)};
+    }
+
+    template<class T>
+    using hint_allocator = call_site_allocator<T, detail::hint_site>;
+
+    template<class T>
+    using hinted_vector = std::vector<T, hint_allocator<T>>;
+
+    //the hint a new vector from this site starts with, 0 for none yet
+    [[nodiscard]] inline std::size_t capacity_hint(hint_site_tag tag) noexcept{
+        return tag.site->hint.load(std::memory_order_relaxed);
+    }
+
+    //merge the sites in a saved table; false if the file cannot be opened or is not one
+    inline bool load_capacity_hints(const char* path){
+        return detail::load_hints(detail::hint_sites(), path);
+    }
+
+    //write every site with a hint; throws std::system_error if the file cannot be written
+    inline void save_capacity_hints(const char* path){
+        std::unique_ptr<std::FILE, int(*)(std::FILE*)> out(std::fopen(path, "w"), &std::fclose);
+        if(!out) detail::throw_errno("save_capacity_hints: fopen");
+        std::fputs("vector capacity hints 1\n", out.get());
+        for(const detail::hint_site* s = detail::hint_sites().head(); s; s = s->next){
+            const std::size_t hint = s->hint.load(std::memory_order_relaxed);
+            if(s->line == 0 || hint == 0) continue;
+            const std::uint64_t samples = s->samples.load(std::memory_order_relaxed) + s->loaded_samples.load(std::memory_order_relaxed);
+            std::fprintf(out.get(), "%zu\t%llu\t%u\t%s\t%s\n", hint, static_cast<unsigned long long>(samples),
+                         static_cast<unsigned>(s->line), s->file, s->function);
+        }
+        if(std::fflush(out.get()) != 0 || std::ferror(out.get())) detail::throw_errno("save_capacity_hints: write");
+    }
+
+    //save the table to path when the process exits normally; errors are reported on stderr
+    inline void save_capacity_hints_at_exit(const char* path){
+        static std::string exit_path;
+        static bool registered = false;
+        exit_path = path;
+        if(!registered){
+            registered = true;
+            std::atexit([]{
+                try{
+                    save_capacity_hints(exit_path.c_str());
+                }catch(const std::exception& e){
+                    std::fprintf(stderr, "%s\n", e.what());
+                }
+            });
+        }
+    }
+}
+
+namespace std{
+    template<class T>
+    struct vector_stats_policy<T, ext::hint_allocator<T>>{
+        static constexpr bool enabled = true;
+        using alloc_type = ext::hint_allocator<T>;
+
+        static void relocated(const alloc_type&, vector_event, size_t, size_t, size_t, bool) noexcept{}
+        static void expanded(const alloc_type&, size_t, size_t) noexcept{}
+        static void size_grew(const alloc_type&, size_t, size_t) noexcept{}
+
+        static void released(const alloc_type& alloc, size_t size, size_t) noexcept{
+            //not learned from: vectors without a site share no size distribution
+            ext::detail::hint_site* s = alloc.site();
+            if(s->line) s->record(size);
+        }
+    };
+
+    template<class T>
+    struct vector_capacity_policy<T, ext::hint_allocator<T>>{
+        static constexpr bool enabled = true;
+
+        static size_t first_capacity(const ext::hint_allocator<T>& alloc, size_t) noexcept{
+            return alloc.site()->hint.load(memory_order_relaxed);
+        }
+    };
+}
@@ -0,0 +1,167 @@
+//Copy-on-write vector for cheap copies of rarely mutated buffers
+//
+//cow_vector<T> holds its elements in a vector<T> inside a reference-counted block.
+//Copying a cow_vector only bumps the count; the first mutating call on a copy whose
+//block is shared (use_count() > 1) detaches it by copying the elements once.
+//
+//Reads never touch the count: operator[], data(), begin()/end() and view() go
+//straight to the shared vector, so passing a table by value and reading it costs
+//the same as reading a vector<T>.
+//
+//There is deliberately no non-const operator[] or iterator. A mutable reference
+//handed out by a COW container stays live across later copies and would then write
+//into a shared buffer (the old std::string problem). Mutations go through the
+//member functions below, or through mutate(fn), which detaches and hands fn the
+//private vector<T> for the duration of the call.
+//
+//Thread safety is that of shared_ptr: distinct cow_vector objects may be read,
+//copied, mutated and destroyed concurrently even when they share a buffer.
+#pragma once
+#include "../vector.h"
+#include <atomic>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace ext{
+    template<class T, class Allocator = std::allocator<T>>
+    class cow_vector{
+    public:
+        using vector_type = std::vector<T, Allocator>;
+        using value_type = T;
+        using allocator_type = Allocator;
+        using size_type = typename vector_type::size_type;
+        using difference_type = typename vector_type::difference_type;
+        using const_reference = const T&;
+        using const_pointer = const T*;
+        using const_iterator = typename vector_type::const_iterator;
+
+        cow_vector() noexcept = default;
+
+        //takes the elements over without copying them
+        explicit cow_vector(vector_type v) : m_rep(new rep{1, std::move(v)}){}
+
+        cow_vector(std::initializer_list<T> init) : cow_vector(vector_type(init)){}
+
+        template<class InputIt> requires std::input_iterator<InputIt>
+        cow_vector(InputIt first, InputIt last) : cow_vector(vector_type(first, last)){}
+
+        cow_vector(const cow_vector& other) noexcept : m_rep(other.m_rep){
+            if(m_rep) m_rep->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        cow_vector(cow_vector&& other) noexcept : m_rep(std::exchange(other.m_rep, nullptr)){}
+
+        cow_vector& operator=(cow_vector other) noexcept{
+            swap(other);
+            return *this;
+        }
+
+        ~cow_vector(){
+            release(m_rep);
+        }
+
+        void swap(cow_vector& other) noexcept{
+            std::swap(m_rep, other.m_rep);
+        }
+
+        //read access, no reference count traffic
+
+        [[nodiscard]] size_type size() const noexcept{ return m_rep ? m_rep->v.size() : 0; }
+        [[nodiscard]] bool empty() const noexcept{ return size() == 0; }
+        [[nodiscard]] size_type capacity() const noexcept{ return m_rep ? m_rep->v.capacity() : 0; }
+        [[nodiscard]] const T* data() const noexcept{ return m_rep ? m_rep->v.data() : nullptr; }
+
+        //unchecked, unlike vector.h: this is the hot read path
+        [[nodiscard]] const T& operator[](size_type pos) const noexcept{ return data()[pos]; }
+
+        [[nodiscard]] const T& at(size_type pos) const{
+            if(pos >= size()) throw std::out_of_range("cow_vector::at: index out of range");
+            return data()[pos];
+        }
+
+        [[nodiscard]] const T& front() const noexcept{ return data()[0]; }
+        [[nodiscard]] const T& back() const noexcept{ return data()[size() - 1]; }
+
+        [[nodiscard]] const_iterator begin() const noexcept{ return m_rep ? m_rep->v.cbegin() : const_iterator(); }
+        [[nodiscard]] const_iterator end() const noexcept{ return m_rep ? m_rep->v.cend() : const_iterator(); }
+        [[nodiscard]] const_iterator cbegin() const noexcept{ return begin(); }
+        [[nodiscard]] const_iterator cend() const noexcept{ return end(); }
+
+        //the elements as a vector, for APIs that take const vector<T>&
+        [[nodiscard]] const vector_type& view() const noexcept{
+            static const vector_type empty_vector;
+            return m_rep ? m_rep->v : empty_vector;
+        }
+
+        [[nodiscard]] vector_type to_vector() const{ return view(); }
+
+        //number of cow_vectors sharing the buffer (0 if there is none)
+        [[nodiscard]] long use_count() const noexcept{
+            return m_rep ? static_cast<long>(m_rep->refs.load(std::memory_order_acquire)) : 0;
+        }
+
+        //mutation, detaches first
+
+        template<class Fn>
+        decltype(auto) mutate(Fn&& fn){
+            return std::forward<Fn>(fn)(detach());
+        }
+
+        void set(size_type pos, T value){
+            if(pos >= size()) throw std::out_of_range("cow_vector::set: index out of range");
+            detach()[pos] = std::move(value);
+        }
+
+        void push_back(const T& value){ detach().push_back(value); }
+        void push_back(T&& value){ detach().push_back(std::move(value)); }
+
+        //const, like every reference handed out: see the note at the top
+        template<class... Args>
+        const T& emplace_back(Args&&... args){ return detach().emplace_back(std::forward<Args>(args)...); }
+
+        void pop_back(){ detach().pop_back(); }
+        void resize(size_type count){ detach().resize(count); }
+        void resize(size_type count, const T& value){ detach().resize(count, value); }
+        void reserve(size_type new_cap){ detach().reserve(new_cap); }
+
+        //a shared buffer is simply let go, nothing is copied
+        void clear() noexcept{
+            if(m_rep && m_rep->refs.load(std::memory_order_acquire) == 1){
+                m_rep->v.clear();
+                return;
+            }
+            release(std::exchange(m_rep, nullptr));
+        }
+
+        friend bool operator==(const cow_vector& a, const cow_vector& b){
+            return a.m_rep == b.m_rep || a.view() == b.view();
+        }
+
+    private:
+        struct rep{
+            std::atomic<std::size_t> refs;
+            vector_type v;
+        };
+
+        static void release(rep* r) noexcept{
+            if(r && r->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete r;
+        }
+
+        //make the buffer ours alone and return it
+        vector_type& detach(){
+            if(!m_rep){
+                m_rep = new rep{1, vector_type()};
+            }
+            else if(m_rep->refs.load(std::memory_order_acquire) != 1){
+                rep* copy = new rep{1, m_rep->v};
+                release(std::exchange(m_rep, copy));
+            }
+            return m_rep->v;
+        }
+
+        rep* m_rep = nullptr;
+    };
+}
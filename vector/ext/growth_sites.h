@@ -0,0 +1,211 @@
+//Capacity waste and growth report per allocation site
+//
+//site_allocator<T> is std::allocator<T> plus a pointer to the source location that
+//created it (call_sites.h), captured by a std::source_location default argument
+//in this_site().
+//vector<T, site_allocator<T>> reports to that site through vector_stats_policy:
+//  vectors      vectors from the site that allocated
+//  reallocs     times one of them outgrew its block (what a reserve() would save)
+//  relocated    bytes moved or copied by those reallocations
+//  peak live    most bytes of capacity the site's vectors held at once
+//  slack        capacity - size as a share of capacity, averaged over every size
+//               increase and every destruction (about 25% under 2x growth)
+//  reserve      the largest size any vector from the site reached; reserving it
+//               up front avoids every reallocation that site made
+//Sites are ranked by waste, relocated bytes plus the slack share of peak live bytes.
+//
+//    ext::sited_vector<route> routes(ext::this_site());   //attributed to this line
+//    ext::sited_vector<route> other;                      //"(unattributed)"
+//    ext::report_growth_sites_at_exit();                  //or _on_signal(SIGUSR1)
+//
+//Looking up the site takes a lock, so do it where vectors are created, not per
+//element; the per-element cost is a few relaxed atomic adds.
+#pragma once
+#include "../vector.h"
+#include "call_sites.h"
+#include <atomic>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <source_location>
+#include <unistd.h>
+
+namespace ext{
+    namespace detail{
+        struct growth_site{
+            const char* file;
+            std::uint_least32_t line;
+            const char* function;
+            std::atomic<std::uint64_t> vectors{0};
+            std::atomic<std::uint64_t> reallocations{0};
+            std::atomic<std::uint64_t> bytes_relocated{0};
+            std::atomic<std::uint64_t> live_bytes{0};
+            std::atomic<std::uint64_t> peak_live_bytes{0};
+            std::atomic<std::uint64_t> slack_bytes{0};      //summed over samples
+            std::atomic<std::uint64_t> capacity_bytes{0};   //summed over the same samples
+            std::atomic<std::uint64_t> max_size{0};
+            growth_site* next = nullptr;
+
+            growth_site(const char* f, std::uint_least32_t l, const char* fn) noexcept : file(f), line(l), function(fn){}
+
+            void sample(std::size_t size, std::size_t capacity, std::size_t elem_size) noexcept{
+                slack_bytes.fetch_add((capacity - size) * elem_size, std::memory_order_relaxed);
+                capacity_bytes.fetch_add(capacity * elem_size, std::memory_order_relaxed);
+            }
+
+            void allocated(std::size_t bytes) noexcept{
+                store_max(peak_live_bytes, live_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+            }
+
+            void deallocated(std::size_t bytes) noexcept{
+                live_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+            }
+
+            static void store_max(std::atomic<std::uint64_t>& a, std::uint64_t v) noexcept{
+                std::uint64_t cur = a.load(std::memory_order_relaxed);
+                while(v > cur && !a.compare_exchange_weak(cur, v, std::memory_order_relaxed)){}
+            }
+        };
+
+        using growth_site_registry = call_site_registry<growth_site>;
+    }
+
+    //where a site_allocator was made; see this_site()
+    using growth_site_tag = call_site_tag<detail::growth_site>;
+
+    [[nodiscard]] inline growth_site_tag this_site(std::source_location loc = std::source_location::current()){
+        return {detail::growth_site_registry::instance().find(loc)};
+    }
+
+    template<class T>
+    using site_allocator = call_site_allocator<T, detail::growth_site>;
+
+    template<class T>
+    using sited_vector = std::vector<T, site_allocator<T>>;
+
+    namespace detail{
+        //"12.3M"-style byte count
+        inline void format_bytes(char* buf, std::size_t len, std::uint64_t bytes) noexcept{
+            static constexpr const char units[] = "BKMGTP";
+            double v = static_cast<double>(bytes);
+            int u = 0;
+            while(v >= 1024 && u < 5){ v /= 1024; ++u; }
+            if(u == 0) std::snprintf(buf, len, "%lluB", static_cast<unsigned long long>(bytes));
+            else std::snprintf(buf, len, "%.1f%c", v, units[u]);
+        }
+
+        inline double slack_share(const growth_site& s) noexcept{
+            const std::uint64_t cap = s.capacity_bytes.load(std::memory_order_relaxed);
+            return cap ? static_cast<double>(s.slack_bytes.load(std::memory_order_relaxed)) / cap : 0.0;
+        }
+
+        inline double waste(const growth_site& s) noexcept{
+            return s.bytes_relocated.load(std::memory_order_relaxed) + s.peak_live_bytes.load(std::memory_order_relaxed) * slack_share(s);
+        }
+    }
+
+    //write the top sites by waste to fd. Allocates nothing and takes no lock, so it
+    //can run from a signal handler (snprintf is not formally async-signal-safe, but
+    //is safe in practice for these conversions).
+    inline void write_growth_report(int fd, std::size_t top = 20){
+        constexpr std::size_t max_top = 64;
+        if(top > max_top) top = max_top;
+        detail::growth_site* best[max_top];
+        std::size_t found = 0, total = 0;
+        for(detail::growth_site* s = detail::growth_site_registry::instance().head(); s; s = s->next){
+            if(s->vectors.load(std::memory_order_relaxed) == 0) continue;
+            ++total;
+            const double w = detail::waste(*s);
+            std::size_t i = found < top ? found++ : top;
+            while(i > 0 && detail::waste(*best[i - 1]) < w){
+                if(i < top) best[i] = best[i - 1];
+                --i;
+            }
+            if(i < top) best[i] = s;
+        }
+
+        char line[1024];
+        auto emit = [fd](const char* text, int n){
+            if(n <= 0) return;
+            std::size_t len = static_cast<std::size_t>(n) < sizeof(line) ? static_cast<std::size_t>(n) : sizeof(line) - 1;
+            while(len > 0){
+                ssize_t w = ::write(fd, text, len);
+                if(w <= 0) return;
+                text += w;
+                len -= static_cast<std::size_t>(w);
+            }
+        };
+        emit(line, std::snprintf(line, sizeof(line), "vector growth sites: top %zu of %zu by waste (relocated + slack share of peak live)\n", found, total));
+        emit(line, std::snprintf(line, sizeof(line), "%10s %10s %10s %10s %6s %10s %14s  %s\n",
+                                 "vectors", "reallocs", "relocated", "peak live", "slack", "waste", "reserve", "site"));
+        for(std::size_t i = 0; i < found; ++i){
+            const detail::growth_site& s = *best[i];
+            char relocated[16], peak[16], waste[16], reserve[32] = "-";
+            detail::format_bytes(relocated, sizeof(relocated), s.bytes_relocated.load(std::memory_order_relaxed));
+            detail::format_bytes(peak, sizeof(peak), s.peak_live_bytes.load(std::memory_order_relaxed));
+            detail::format_bytes(waste, sizeof(waste), static_cast<std::uint64_t>(detail::waste(s)));
+            char where[512];
+            if(s.line) std::snprintf(where, sizeof(where), "%s:%u %s", s.file, static_cast<unsigned>(s.line), s.function);
+            else std::snprintf(where, sizeof(where), "%s", s.file);
+            if(s.reallocations.load(std::memory_order_relaxed))
+                std::snprintf(reserve, sizeof(reserve), "reserve(%llu)", static_cast<unsigned long long>(s.max_size.load(std::memory_order_relaxed)));
+            emit(line, std::snprintf(line, sizeof(line), "%10llu %10llu %10s %10s %5.1f%% %10s %14s  %s\n",
+                                     static_cast<unsigned long long>(s.vectors.load(std::memory_order_relaxed)),
+                                     static_cast<unsigned long long>(s.reallocations.load(std::memory_order_relaxed)),
+                                     relocated, peak, 100.0 * detail::slack_share(s), waste, reserve, where));
+        }
+    }
+
+    //print the report to stderr when the process exits normally
+    inline void report_growth_sites_at_exit(std::size_t top = 20){
+        static std::size_t exit_top = top;
+        static bool registered = false;
+        exit_top = top;
+        if(!registered){
+            registered = true;
+            std::atexit([]{ write_growth_report(STDERR_FILENO, exit_top); });
+        }
+    }
+
+    //print the report to stderr whenever sig arrives; the process keeps running
+    inline void report_growth_sites_on_signal(int sig = SIGUSR1, std::size_t top = 20){
+        static std::atomic<std::size_t> signal_top{20};
+        signal_top.store(top, std::memory_order_relaxed);
+        detail::growth_site_registry::instance();   //not first created inside the handler
+        struct sigaction sa{};
+        sa.sa_handler = [](int){ write_growth_report(STDERR_FILENO, signal_top.load(std::memory_order_relaxed)); };
+        sigemptyset(&sa.sa_mask);
+        sa.sa_flags = SA_RESTART;
+        ::sigaction(sig, &sa, nullptr);
+    }
+}
+
+namespace std{
+    template<class T>
+    struct vector_stats_policy<T, ext::site_allocator<T>>{
+        static constexpr bool enabled = true;
+        using alloc_type = ext::site_allocator<T>;
+
+        static void relocated(const alloc_type& alloc, vector_event event, size_t old_cap, size_t, size_t count, bool) noexcept{
+            ext::detail::growth_site& s = *alloc.site();
+            if(event == vector_event::shrink) return;
+            if(old_cap == 0) s.vectors.fetch_add(1, memory_order_relaxed);
+            else s.reallocations.fetch_add(1, memory_order_relaxed);
+            s.bytes_relocated.fetch_add(count * sizeof(T), memory_order_relaxed);
+        }
+
+        static void expanded(const alloc_type&, size_t, size_t) noexcept{}
+
+        static void size_grew(const alloc_type& alloc, size_t size, size_t capacity) noexcept{
+            ext::detail::growth_site& s = *alloc.site();
+            s.sample(size, capacity, sizeof(T));
+            ext::detail::growth_site::store_max(s.max_size, size);
+        }
+
+        static void released(const alloc_type& alloc, size_t size, size_t capacity) noexcept{
+            alloc.site()->sample(size, capacity, sizeof(T));
+        }
+    };
+}
@@ -0,0 +1,334 @@
+//Vector whose push_back never relocates more than a few elements at a time
+//
+//When a vector<T> outgrows its buffer, the push_back that notices moves every
+//element into the new one: amortised O(1), but that one call is O(n), which is
+//what a latency-sensitive producer sees as a stall. incremental_vector<T>
+//allocates the doubled buffer at the same point but leaves the elements where
+//they are, as incremental rehashing does with hash tables: each later
+//push_back moves the next `migrate_step` elements across, and indexing looks up
+//the element in whichever buffer holds it until the old one is empty and freed.
+//With two elements per push_back the migration is over long before the new
+//buffer fills up, so every push_back is O(1) in the worst case, not only
+//amortised.
+//
+//While a migration runs:
+//  - indices below migrated() and at or above the old size are in the new
+//    buffer, the ones in between still in the old one; operator[] picks one
+//  - both buffers are allocated, so the peak is 3x the old capacity, as in
+//    vector.h's reallocation, but for the duration of the migration
+//  - elements are moved with move_if_noexcept and a failed step leaves the
+//    vector as it was, so push_back keeps the strong guarantee
+//  - references and iterators to elements still in the old buffer are
+//    invalidated when their element is moved, i.e. by any push_back
+//The push_back that moves the last old element also frees the old buffer. For a
+//block big enough that malloc gave it its own mapping, that munmap is the one
+//cost left that grows with n (about 1 ms for 16 MiB of touched pages).
+//There is no data(), since the elements are not contiguous while migrating;
+//contiguous() finishes the migration (O(n), once) and returns the single
+//buffer. So do reserve() and copies.
+//
+//    ext::incremental_vector<sample> ring;
+//    ring.push_back(s);              //O(1), also when it grows
+//    process(ring.contiguous(), ring.size());
+#pragma once
+#include "../vector.h"
+#include <algorithm>
+#include <compare>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace ext{
+    namespace detail{
+        //random access iterator by index, routed through operator[] of the container
+        template<class Container, class T>
+        class incremental_iterator{
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using iterator_concept = std::random_access_iterator_tag;
+            using value_type = std::remove_const_t<T>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = T*;
+            using reference = T&;
+
+            incremental_iterator() noexcept = default;
+            incremental_iterator(Container* c, std::size_t i) noexcept : m_c(c), m_index(i){}
+
+            //iterator to const_iterator
+            template<class C, class U> requires std::is_const_v<Container> && (!std::is_const_v<C>)
+            incremental_iterator(const incremental_iterator<C, U>& other) noexcept : m_c(other.m_c), m_index(other.m_index){}
+
+            reference operator*() const noexcept{ return (*m_c)[m_index]; }
+            pointer operator->() const noexcept{ return &(*m_c)[m_index]; }
+            reference operator[](difference_type n) const noexcept{ return (*m_c)[m_index + n]; }
+
+            incremental_iterator& operator++() noexcept{ ++m_index; return *this; }
+            incremental_iterator operator++(int) noexcept{ incremental_iterator t = *this; ++m_index; return t; }
+            incremental_iterator& operator--() noexcept{ --m_index; return *this; }
+            incremental_iterator operator--(int) noexcept{ incremental_iterator t = *this; --m_index; return t; }
+            incremental_iterator& operator+=(difference_type n) noexcept{ m_index += n; return *this; }
+            incremental_iterator& operator-=(difference_type n) noexcept{ m_index -= n; return *this; }
+            friend incremental_iterator operator+(incremental_iterator it, difference_type n) noexcept{ return it += n; }
+            friend incremental_iterator operator+(difference_type n, incremental_iterator it) noexcept{ return it += n; }
+            friend incremental_iterator operator-(incremental_iterator it, difference_type n) noexcept{ return it -= n; }
+            friend difference_type operator-(const incremental_iterator& a, const incremental_iterator& b) noexcept{
+                return static_cast<difference_type>(a.m_index) - static_cast<difference_type>(b.m_index);
+            }
+            friend bool operator==(const incremental_iterator& a, const incremental_iterator& b) noexcept{ return a.m_index == b.m_index; }
+            friend auto operator<=>(const incremental_iterator& a, const incremental_iterator& b) noexcept{ return a.m_index <=> b.m_index; }
+
+        private:
+            template<class, class> friend class incremental_iterator;
+
+            Container* m_c = nullptr;
+            std::size_t m_index = 0;
+        };
+    }
+
+    template<class T, class Allocator = std::allocator<T>>
+    class incremental_vector{
+        using alloc_traits = std::allocator_traits<Allocator>;
+    public:
+        using value_type = T;
+        using allocator_type = Allocator;
+        using size_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using reference = T&;
+        using const_reference = const T&;
+        using iterator = detail::incremental_iterator<incremental_vector, T>;
+        using const_iterator = detail::incremental_iterator<const incremental_vector, const T>;
+
+        //elements moved to the new buffer per push_back while a migration runs;
+        //at least 2 so that it ends before the doubled buffer is full
+        static constexpr size_type migrate_step = 2;
+
+        incremental_vector() noexcept(noexcept(Allocator())) = default;
+        explicit incremental_vector(const Allocator& alloc) noexcept : m_alloc(alloc){}
+
+        //these delegate, so that the destructor frees what is built if an element copy throws
+        incremental_vector(std::initializer_list<T> init, const Allocator& alloc = Allocator()) : incremental_vector(alloc){
+            reserve(init.size());
+            for(const T& v : init) push_back(v);
+        }
+
+        incremental_vector(const incremental_vector& other)
+            : incremental_vector(alloc_traits::select_on_container_copy_construction(other.m_alloc)){
+            reserve(other.size());
+            for(const T& v : other) push_back(v);
+        }
+
+        incremental_vector(incremental_vector&& other) noexcept
+            : m_alloc(std::move(other.m_alloc)),
+              m_start(std::exchange(other.m_start, nullptr)), m_size(std::exchange(other.m_size, 0)), m_cap(std::exchange(other.m_cap, 0)),
+              m_old(std::exchange(other.m_old, nullptr)), m_old_cap(std::exchange(other.m_old_cap, 0)),
+              m_migrated(std::exchange(other.m_migrated, 0)), m_old_size(std::exchange(other.m_old_size, 0)){}
+
+        //copy and swap; like std::vector with an allocator that propagates on swap
+        incremental_vector& operator=(incremental_vector other) noexcept{
+            swap(other);
+            return *this;
+        }
+
+        ~incremental_vector(){
+            clear();
+            release(m_start, m_cap);
+        }
+
+        void swap(incremental_vector& other) noexcept{
+            using std::swap;
+            swap(m_alloc, other.m_alloc);
+            swap(m_start, other.m_start);
+            swap(m_size, other.m_size);
+            swap(m_cap, other.m_cap);
+            swap(m_old, other.m_old);
+            swap(m_old_cap, other.m_old_cap);
+            swap(m_migrated, other.m_migrated);
+            swap(m_old_size, other.m_old_size);
+        }
+
+        [[nodiscard]] size_type size() const noexcept{ return m_size; }
+        [[nodiscard]] bool empty() const noexcept{ return m_size == 0; }
+        [[nodiscard]] size_type capacity() const noexcept{ return m_cap; }
+        [[nodiscard]] allocator_type get_allocator() const noexcept{ return m_alloc; }
+
+        //whether an old buffer is still being emptied, and how far
+        [[nodiscard]] bool migrating() const noexcept{ return m_old != nullptr; }
+        [[nodiscard]] size_type migrated() const noexcept{ return m_migrated; }
+        [[nodiscard]] size_type pending() const noexcept{ return m_old_size - m_migrated; }
+
+        [[nodiscard]] T& operator[](size_type pos) noexcept{ return *slot(pos); }
+        [[nodiscard]] const T& operator[](size_type pos) const noexcept{ return *slot(pos); }
+
+        [[nodiscard]] T& at(size_type pos){
+            if(pos >= m_size) throw std::out_of_range("incremental_vector::at: index out of range");
+            return *slot(pos);
+        }
+        [[nodiscard]] const T& at(size_type pos) const{
+            if(pos >= m_size) throw std::out_of_range("incremental_vector::at: index out of range");
+            return *slot(pos);
+        }
+
+        [[nodiscard]] T& front() noexcept{ return *slot(0); }
+        [[nodiscard]] const T& front() const noexcept{ return *slot(0); }
+        [[nodiscard]] T& back() noexcept{ return *slot(m_size - 1); }
+        [[nodiscard]] const T& back() const noexcept{ return *slot(m_size - 1); }
+
+        [[nodiscard]] iterator begin() noexcept{ return iterator(this, 0); }
+        [[nodiscard]] iterator end() noexcept{ return iterator(this, m_size); }
+        [[nodiscard]] const_iterator begin() const noexcept{ return const_iterator(this, 0); }
+        [[nodiscard]] const_iterator end() const noexcept{ return const_iterator(this, m_size); }
+        [[nodiscard]] const_iterator cbegin() const noexcept{ return begin(); }
+        [[nodiscard]] const_iterator cend() const noexcept{ return end(); }
+
+        //finish any migration and return the one buffer; O(n) if one was running
+        [[nodiscard]] T* contiguous(){
+            finish_migration();
+            return m_start;
+        }
+
+        //move everything still in the old buffer now and free it
+        void finish_migration(){
+            while(m_old) migrate(pending());
+        }
+
+        void push_back(const T& value){ emplace_back(value); }
+        void push_back(T&& value){ emplace_back(std::move(value)); }
+
+        template<class... Args>
+        T& emplace_back(Args&&... args){
+            //a running migration always ends before the new buffer is full
+            if(m_size == m_cap) return grow_and_append(std::forward<Args>(args)...);
+            //append first: args may refer to an element that the migration moves
+            alloc_traits::construct(m_alloc, m_start + m_size, std::forward<Args>(args)...);
+            ++m_size;
+            if(m_old){
+                try{
+                    migrate(migrate_step);
+                }catch(...){
+                    alloc_traits::destroy(m_alloc, m_start + --m_size);
+                    throw;
+                }
+            }
+            return m_start[m_size - 1];
+        }
+
+        void pop_back() noexcept{
+            T* last = slot(m_size - 1);
+            alloc_traits::destroy(m_alloc, last);
+            --m_size;
+            if(m_old && m_size < m_old_size){
+                //the last old element went away rather than being moved
+                m_old_size = m_size;
+                if(m_migrated == m_old_size) drop_old();
+            }
+        }
+
+        //elements are destroyed, both buffers kept until the next growth or the destructor;
+        //the old buffer is freed at once since nothing is left to move out of it
+        void clear() noexcept{
+            while(m_size) pop_back();
+            drop_old();
+        }
+
+        //finishes a running migration, then relocates at once like vector::reserve
+        void reserve(size_type new_cap){
+            finish_migration();
+            if(new_cap <= m_cap) return;
+            T* fresh = alloc_traits::allocate(m_alloc, new_cap);
+            size_type i = 0;
+            try{
+                for(; i < m_size; ++i) alloc_traits::construct(m_alloc, fresh + i, std::move_if_noexcept(m_start[i]));
+            }catch(...){
+                while(i) alloc_traits::destroy(m_alloc, fresh + --i);
+                alloc_traits::deallocate(m_alloc, fresh, new_cap);
+                throw;
+            }
+            for(i = 0; i < m_size; ++i) alloc_traits::destroy(m_alloc, m_start + i);
+            release(m_start, m_cap);
+            m_start = fresh;
+            m_cap = new_cap;
+        }
+
+        friend bool operator==(const incremental_vector& a, const incremental_vector& b){
+            return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+        }
+
+    private:
+        T* slot(size_type pos) const noexcept{
+            return m_old && pos >= m_migrated && pos < m_old_size ? m_old + pos : m_start + pos;
+        }
+
+        //the new buffer, with the element appended at its final index; the old
+        //elements stay where they are unless there are too few for the step to
+        //have moved them all by the time the new buffer fills up
+        template<class... Args>
+        T& grow_and_append(Args&&... args){
+            const size_type new_cap = m_cap ? 2 * m_cap : 1;
+            if(new_cap < m_cap || new_cap > alloc_traits::max_size(m_alloc)) throw std::length_error("incremental_vector too long");
+            T* fresh = alloc_traits::allocate(m_alloc, new_cap);
+            const bool now = m_size <= migrate_step;
+            size_type i = 0;
+            try{
+                alloc_traits::construct(m_alloc, fresh + m_size, std::forward<Args>(args)...);
+                try{
+                    for(; now && i < m_size; ++i) alloc_traits::construct(m_alloc, fresh + i, std::move_if_noexcept(m_start[i]));
+                }catch(...){
+                    while(i) alloc_traits::destroy(m_alloc, fresh + --i);
+                    alloc_traits::destroy(m_alloc, fresh + m_size);
+                    throw;
+                }
+            }catch(...){
+                alloc_traits::deallocate(m_alloc, fresh, new_cap);
+                throw;
+            }
+            if(now){
+                for(i = 0; i < m_size; ++i) alloc_traits::destroy(m_alloc, m_start + i);
+                release(m_start, m_cap);
+            }else{
+                m_old = m_start;
+                m_old_cap = m_cap;
+                m_old_size = m_size;
+                m_migrated = 0;
+            }
+            m_start = fresh;
+            m_cap = new_cap;
+            return m_start[m_size++];
+        }
+
+        //move up to `count` elements from the old buffer; frees it once it is empty.
+        //A throwing move or copy leaves the element where it was.
+        void migrate(size_type count){
+            for(const size_type stop = std::min(m_old_size, m_migrated + count); m_migrated < stop; ++m_migrated){
+                alloc_traits::construct(m_alloc, m_start + m_migrated, std::move_if_noexcept(m_old[m_migrated]));
+                alloc_traits::destroy(m_alloc, m_old + m_migrated);
+            }
+            if(m_migrated == m_old_size) drop_old();
+        }
+
+        //the old buffer must hold no elements by now
+        void drop_old() noexcept{
+            release(m_old, m_old_cap);
+            m_old = nullptr;
+            m_old_cap = m_migrated = m_old_size = 0;
+        }
+
+        void release(T* p, size_type cap) noexcept{
+            if(p) alloc_traits::deallocate(m_alloc, p, cap);
+        }
+
+        [[no_unique_address]] Allocator m_alloc;
+        T* m_start = nullptr;
+        size_type m_size = 0;
+        size_type m_cap = 0;
+
+        //the buffer being emptied: [m_migrated, m_old_size) are still there
+        T* m_old = nullptr;
+        size_type m_old_cap = 0;
+        size_type m_migrated = 0;
+        size_type m_old_size = 0;
+    };
+}
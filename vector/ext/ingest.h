@@ -0,0 +1,170 @@
+//Streaming ingestion from file descriptors straight into vector capacity
+//
+//The usual way to slurp a file or pipe is read() into a scratch buffer followed by
+//v.insert(v.end(), buf, buf + n), which moves every byte through memory twice.
+//append_from_fd instead grows v geometrically and reads into the uninitialised tail
+//between size() and capacity() (through resize_and_overwrite), committing only the
+//complete elements that actually arrived.
+//
+//Each read is a readv of two buffers: the vector's tail and a small spill buffer on
+//the stack. When the tail is exactly large enough for the rest of the input (the
+//usual case for regular files, whose size is taken from fstat as a hint) the final
+//zero-length read that detects end of file needs no extra capacity; and when the
+//input turns out to be longer than the hint, the overflow lands in the spill buffer
+//and is copied into the tail after the next growth instead of being lost.
+//
+//Elements may be split across reads, so a pipe delivering half an int is fine; a
+//stream that ends in the middle of an element is an error.
+//
+//Errors: read failures throw std::system_error with the errno, a truncated trailing
+//element throws std::runtime_error. Either way v is restored to its original size
+//(the bytes consumed from fd are gone).
+#pragma once
+#include "../vector.h"
+#include "posix_fd.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace ext{
+    struct ingest_result{
+        std::size_t count;  //elements appended
+        bool eof;           //false if the call stopped early: max_count was reached,
+                            //or fd is non-blocking and had no more data
+    };
+
+    namespace detail{
+        inline constexpr std::size_t ingest_spill_bytes = 16 * 1024;
+        inline constexpr std::size_t ingest_min_chunk_bytes = 64 * 1024;
+
+        //bytes left to read from a regular file, nullopt for pipes, sockets and the like
+        inline std::optional<std::size_t> ingest_size_hint(int fd){
+            struct stat st;
+            if(::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) return std::nullopt;
+            off_t pos = ::lseek(fd, 0, SEEK_CUR);
+            if(pos < 0) return std::nullopt;
+            return st.st_size > pos ? static_cast<std::size_t>(st.st_size - pos) : 0;
+        }
+
+        inline void wait_readable(int fd){
+            pollfd p{fd, POLLIN, 0};
+            while(::poll(&p, 1, -1) < 0){
+                if(errno != EINTR) throw_errno("append_from_fd: poll");
+            }
+        }
+    }
+
+    //append up to max_count elements read from fd to v, until end of file.
+    //On a non-blocking fd it also returns (with eof == false) once no more data is
+    //available, as long as no element is left half read.
+    template<class T, class A>
+        requires std::is_trivially_copyable_v<T>
+    ingest_result append_from_fd(std::vector<T, A>& v, int fd, std::size_t max_count = std::numeric_limits<std::size_t>::max()){
+        using size_type = typename std::vector<T, A>::size_type;
+        const size_type start = v.size();
+        const size_type limit = std::min<size_type>(max_count, v.max_size() - start);
+        const size_type chunk = std::max<size_type>(1, detail::ingest_min_chunk_bytes / sizeof(T));
+        const std::optional<std::size_t> hint_bytes = detail::ingest_size_hint(fd);
+
+        alignas(16) char spill[detail::ingest_spill_bytes];
+        std::size_t spill_len = 0;
+        bool eof = false;
+        bool blocked = false;
+        bool first = true;
+        try{
+            while(!eof && !blocked && v.size() - start < limit){
+                const size_type have = v.size();
+                const size_type cap = v.capacity();
+                size_type want;
+                if(first){
+                    //use the spare capacity and the fstat hint before guessing
+                    if(hint_bytes){
+                        const size_type hint = (*hint_bytes + sizeof(T) - 1) / sizeof(T);
+                        want = std::max(cap, start + std::min(hint, limit));
+                    }else{
+                        want = cap > have ? cap : have + chunk;
+                    }
+                    first = false;
+                }else{
+                    //the tail was filled: geometric growth, never less than one chunk
+                    want = std::max(cap + std::min(cap, v.max_size() - cap), cap + chunk);
+                }
+                want = std::min(want, start + limit);
+                //the spill buffer only takes bytes that are still within max_count
+                const std::size_t spill_cap = std::min<std::size_t>(sizeof(spill), (start + limit - want) * sizeof(T));
+
+                v.resize_and_overwrite(want, [&](T* p, std::size_t n){
+                    char* dst = reinterpret_cast<char*>(p + have);
+                    const std::size_t room = (n - have) * sizeof(T);
+                    std::size_t filled = spill_len;
+                    std::memcpy(dst, spill, spill_len);
+                    spill_len = 0;
+                    //once the tail is full, keep reading into the spill buffer alone: that
+                    //either sees end of file or catches input beyond the hint
+                    while(filled < room || (spill_len == 0 && spill_cap > 0)){
+                        iovec iov[2] = {{dst + filled, room - filled}, {spill, spill_cap}};
+                        const bool full = filled == room;
+                        ssize_t got = ::readv(fd, iov + full, full || spill_cap == 0 ? 1 : 2);
+                        if(got < 0){
+                            if(errno == EINTR) continue;
+                            if(errno == EAGAIN || errno == EWOULDBLOCK){
+                                //never hand back half an element
+                                if(filled % sizeof(T) == 0){
+                                    blocked = true;
+                                    break;
+                                }
+                                detail::wait_readable(fd);
+                                continue;
+                            }
+                            detail::throw_errno("append_from_fd: read");
+                        }
+                        if(got == 0){
+                            eof = true;
+                            break;
+                        }
+                        const std::size_t n_got = static_cast<std::size_t>(got);
+                        if(n_got > room - filled){
+                            spill_len = n_got - (room - filled);
+                            filled = room;
+                        }else{
+                            filled += n_got;
+                        }
+                    }
+                    if(filled % sizeof(T) != 0) throw std::runtime_error("append_from_fd: input ends inside an element");
+                    return have + filled / sizeof(T);
+                });
+            }
+        }catch(...){
+            v.erase(v.begin() + start, v.end());
+            throw;
+        }
+        return {v.size() - start, eof};
+    }
+
+    //append the contents of the file at path to v
+    template<class T, class A>
+        requires std::is_trivially_copyable_v<T>
+    std::size_t append_file(std::vector<T, A>& v, const char* path){
+        detail::unique_fd f(::open(path, O_RDONLY | O_CLOEXEC));
+        if(f.fd < 0) detail::throw_errno("append_file: open");
+        return append_from_fd(v, f.fd).count;
+    }
+
+    //read a whole file into a new vector
+    template<class T = char, class A = std::allocator<T>>
+        requires std::is_trivially_copyable_v<T>
+    std::vector<T, A> read_file(const char* path, const A& alloc = A()){
+        std::vector<T, A> v(alloc);
+        append_file(v, path);
+        return v;
+    }
+}
@@ -0,0 +1,36 @@
+//Log-linear bucket index over 64-bit values, shared by capacity_hints.h and
+//performance/latency_histogram.h
+//
+//Values below 2^(SubBits + 1) get a bucket each; above that every power of two
+//is split into 2^SubBits equal steps, so a bucket's values are within
+//1 / 2^SubBits of each other. count buckets cover every std::uint64_t.
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace ext{
+    namespace detail{
+        template<unsigned SubBits>
+        struct log_linear_buckets{
+            static constexpr unsigned sub_bits = SubBits;
+            static constexpr std::uint64_t exact = std::uint64_t(2) << sub_bits;
+            static constexpr std::size_t count = exact + (64 - sub_bits - 1) * (exact / 2);
+
+            static constexpr std::size_t index(std::uint64_t v) noexcept{
+                if(v < exact) return static_cast<std::size_t>(v);
+                const unsigned shift = std::bit_width(v) - sub_bits - 1;     //>= 1
+                const std::uint64_t top = v >> shift;                       //[exact / 2, exact)
+                return exact + (shift - 1) * (exact / 2) + (top - exact / 2);
+            }
+
+            //the largest value in bucket i
+            static constexpr std::uint64_t highest_in(std::size_t i) noexcept{
+                if(i < exact) return i;
+                const unsigned shift = static_cast<unsigned>((i - exact) / (exact / 2)) + 1;
+                const std::uint64_t top = (i - exact) % (exact / 2) + exact / 2;
+                return ((top + 1) << shift) - 1;
+            }
+        };
+    }
+}
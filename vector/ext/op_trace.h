@@ -0,0 +1,525 @@
+//Operation traces: record what a program does to its vectors, replay it elsewhere
+//
+//recorded_vector<T> is a vector<T> whose structural changes are appended to the
+//process-wide trace while one is open (start_op_trace). Element values are not
+//recorded, only the shape of the work: which vector, where, how many.
+//performance/replay.cpp reruns a trace against vector.h, std::deque and the
+//pool allocator for a time and memory comparison under a production pattern.
+//
+//A trace file is a 16-byte header followed by records:
+//
+//  offset  size  field
+//       0     8  magic "VECOPTR\0"
+//       8     4  format version (op_trace_version)
+//      12     4  byte order marker, 0x01020304 as written by the producer
+//
+//Each record is one opcode byte and then unsigned LEB128 varints: the vector's
+//id, and the arguments below. Ids are numbered from 1 in the order vectors
+//first record something.
+//
+//  create     id sizeof(T)        the vector's first record
+//  destroy    id
+//  push_back  id                  also emplace_back
+//  pop_back   id
+//  insert     id offset count     every insert and emplace
+//  erase      id offset count
+//  reserve    id n
+//  resize     id n                also copies into it, recorded as clear + resize
+//  clear      id
+//  shrink     id                  shrink_to_fit
+//
+//A vector that already held elements when the trace started records create,
+//reserve(capacity) and resize(size) on its next change. A moved-to vector takes
+//the id of the one it was moved from. Records from different threads are
+//serialised by one lock, in the order they took it.
+//
+//    ext::start_op_trace("/tmp/orders.optrace");
+//    ext::recorded_vector<order> book;   //instead of vector<order>
+//    ...
+//    ext::stop_op_trace();
+//
+//Errors: I/O failures throw std::system_error, files that are not a well-formed
+//trace throw op_trace_error when read.
+#pragma once
+#include "../vector.h"
+#include "posix_fd.h"
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <initializer_list>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace ext{
+    inline constexpr std::uint32_t op_trace_version = 1;
+
+    enum class op_trace_op : std::uint8_t{
+        create = 1, destroy, push_back, pop_back, insert, erase, reserve, resize, clear, shrink
+    };
+
+    //one decoded record; a and b are the arguments in the order of the table above
+    struct op_trace_record{
+        op_trace_op op;
+        std::uint64_t id;
+        std::uint64_t a;
+        std::uint64_t b;
+    };
+
+    class op_trace_error : public std::runtime_error{
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    namespace detail{
+        inline constexpr char op_trace_magic[8] = {'V', 'E', 'C', 'O', 'P', 'T', 'R', '\0'};
+        inline constexpr std::uint32_t op_trace_byte_order = 0x01020304;
+
+        inline void write_full(int fd, const char* p, std::size_t n, const char* what){
+            while(n > 0){
+                ssize_t put = ::write(fd, p, n);
+                if(put < 0){
+                    if(errno == EINTR) continue;
+                    throw_errno(what);
+                }
+                p += put;
+                n -= static_cast<std::size_t>(put);
+            }
+        }
+
+        //buffers records and writes them out 64 KiB at a time. There is one, never
+        //destroyed, so a vector recording during static destruction finds it intact.
+        class op_trace_writer{
+        public:
+            static op_trace_writer& instance(){
+                static op_trace_writer* writer = new op_trace_writer;
+                return *writer;
+            }
+
+            std::atomic<bool> active{false};
+            //bumped by every open(), so that ids from an earlier trace are not reused
+            std::atomic<std::uint64_t> generation{0};
+
+            void open(const char* path){
+                std::lock_guard<std::mutex> lock(m_lock);
+                close_locked();
+                int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+                if(fd < 0) throw_errno("op_trace: open");
+                m_fd = fd;
+                m_next_id.store(1, std::memory_order_relaxed);
+                generation.fetch_add(1, std::memory_order_relaxed);
+                std::memcpy(m_buf, op_trace_magic, 8);
+                std::memcpy(m_buf + 8, &op_trace_version, 4);
+                std::memcpy(m_buf + 12, &op_trace_byte_order, 4);
+                m_used = 16;
+                active.store(true, std::memory_order_release);
+            }
+
+            void close(){
+                std::lock_guard<std::mutex> lock(m_lock);
+                close_locked();
+            }
+
+            std::uint64_t new_id() noexcept{
+                return m_next_id.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            //a record that arrives after close() is dropped
+            void record(op_trace_op op, std::uint64_t id, std::uint64_t a, std::uint64_t b, int args){
+                unsigned char rec[1 + 3 * 10];
+                std::size_t len = 0;
+                rec[len++] = static_cast<unsigned char>(op);
+                const std::uint64_t values[3] = {id, a, b};
+                for(int i = 0; i <= args; ++i){
+                    std::uint64_t v = values[i];
+                    do{
+                        rec[len++] = static_cast<unsigned char>((v & 0x7f) | (v > 0x7f ? 0x80 : 0));
+                        v >>= 7;
+                    }while(v);
+                }
+                std::lock_guard<std::mutex> lock(m_lock);
+                if(m_fd < 0) return;
+                if(m_used + len > sizeof(m_buf)) flush_locked();
+                std::memcpy(m_buf + m_used, rec, len);
+                m_used += len;
+            }
+
+        private:
+            op_trace_writer() = default;
+
+            void flush_locked(){
+                write_full(m_fd, m_buf, m_used, "op_trace: write");
+                m_used = 0;
+            }
+
+            void close_locked(){
+                if(m_fd < 0) return;
+                active.store(false, std::memory_order_relaxed);
+                const int fd = std::exchange(m_fd, -1);
+                unique_fd f(fd);
+                write_full(fd, m_buf, m_used, "op_trace: write");
+                m_used = 0;
+            }
+
+            std::mutex m_lock;
+            int m_fd = -1;
+            std::atomic<std::uint64_t> m_next_id{1};
+            std::size_t m_used = 0;
+            char m_buf[64 * 1024];
+        };
+
+        inline std::uint64_t read_varint(const unsigned char*& p, const unsigned char* end){
+            std::uint64_t v = 0;
+            for(int shift = 0; shift < 64; shift += 7){
+                if(p == end) throw op_trace_error("op_trace: truncated record");
+                const unsigned char byte = *p++;
+                v |= std::uint64_t(byte & 0x7f) << shift;
+                if(!(byte & 0x80)) return v;
+            }
+            throw op_trace_error("op_trace: varint too long");
+        }
+    }
+
+    //start recording to path (created or truncated); a trace already open is closed first
+    inline void start_op_trace(const char* path){
+        detail::op_trace_writer::instance().open(path);
+    }
+
+    //write out what is buffered and close the trace
+    inline void stop_op_trace(){
+        detail::op_trace_writer::instance().close();
+    }
+
+    //every record of the trace at path. Checks the header and that each record
+    //names a created, live vector and stays within its size, so a replay can
+    //apply the records without checks of its own.
+    inline std::vector<op_trace_record> read_op_trace(const char* path){
+        detail::unique_fd f(::open(path, O_RDONLY | O_CLOEXEC));
+        if(f.fd < 0) detail::throw_errno("op_trace: open");
+        struct stat st;
+        if(::fstat(f.fd, &st) != 0) detail::throw_errno("op_trace: fstat");
+        std::vector<unsigned char> bytes(static_cast<std::size_t>(st.st_size));
+        for(std::size_t got = 0; got < bytes.size();){
+            ssize_t n = ::read(f.fd, bytes.data() + got, bytes.size() - got);
+            if(n < 0){
+                if(errno == EINTR) continue;
+                detail::throw_errno("op_trace: read");
+            }
+            if(n == 0) throw op_trace_error("op_trace: file shrank while reading");
+            got += static_cast<std::size_t>(n);
+        }
+
+        std::uint32_t version, order;
+        if(bytes.size() < 16 || std::memcmp(bytes.data(), detail::op_trace_magic, 8) != 0)
+            throw op_trace_error("op_trace: not a trace file");
+        std::memcpy(&version, bytes.data() + 8, 4);
+        std::memcpy(&order, bytes.data() + 12, 4);
+        if(order != detail::op_trace_byte_order) throw op_trace_error("op_trace: written with another byte order");
+        if(version != op_trace_version) throw op_trace_error("op_trace: unsupported version " + std::to_string(version));
+
+        std::vector<op_trace_record> out;
+        std::vector<std::uint64_t> sizes;           //by id; ~0 when not live
+        constexpr std::uint64_t dead = ~std::uint64_t(0);
+        const unsigned char* p = bytes.data() + 16;
+        const unsigned char* end = bytes.data() + bytes.size();
+        while(p != end){
+            const std::uint8_t code = *p++;
+            if(code < static_cast<std::uint8_t>(op_trace_op::create) || code > static_cast<std::uint8_t>(op_trace_op::shrink))
+                throw op_trace_error("op_trace: unknown opcode " + std::to_string(code));
+            op_trace_record r{static_cast<op_trace_op>(code), detail::read_varint(p, end), 0, 0};
+            const int args = r.op == op_trace_op::insert || r.op == op_trace_op::erase ? 2
+                           : r.op == op_trace_op::create || r.op == op_trace_op::reserve || r.op == op_trace_op::resize ? 1 : 0;
+            if(args >= 1) r.a = detail::read_varint(p, end);
+            if(args >= 2) r.b = detail::read_varint(p, end);
+
+            if(r.op == op_trace_op::create){
+                if(r.id == 0 || r.a == 0) throw op_trace_error("op_trace: bad create record");
+                if(r.id >= sizes.size()) sizes.resize(r.id + 1, dead);
+                if(sizes[r.id] != dead) throw op_trace_error("op_trace: vector " + std::to_string(r.id) + " created twice");
+                sizes[r.id] = 0;
+            }else{
+                if(r.id >= sizes.size() || sizes[r.id] == dead)
+                    throw op_trace_error("op_trace: vector " + std::to_string(r.id) + " used but not live");
+                std::uint64_t& size = sizes[r.id];
+                bool ok = true;
+                switch(r.op){
+                    case op_trace_op::destroy: size = dead; break;
+                    case op_trace_op::push_back: ++size; break;
+                    case op_trace_op::pop_back: ok = size > 0; --size; break;
+                    case op_trace_op::insert: ok = r.a <= size; size += r.b; break;
+                    case op_trace_op::erase: ok = r.a <= size && r.b <= size - r.a; size -= r.b; break;
+                    case op_trace_op::resize: size = r.a; break;
+                    case op_trace_op::clear: size = 0; break;
+                    default: break;
+                }
+                if(!ok) throw op_trace_error("op_trace: record out of range for vector " + std::to_string(r.id));
+            }
+            out.push_back(r);
+        }
+        return out;
+    }
+
+    template<class T, class Allocator = std::allocator<T>>
+    class recorded_vector{
+    public:
+        using vector_type = std::vector<T, Allocator>;
+        using value_type = T;
+        using allocator_type = Allocator;
+        using size_type = typename vector_type::size_type;
+        using difference_type = typename vector_type::difference_type;
+        using reference = T&;
+        using const_reference = const T&;
+        using pointer = T*;
+        using const_pointer = const T*;
+        using iterator = typename vector_type::iterator;
+        using const_iterator = typename vector_type::const_iterator;
+
+        recorded_vector() = default;
+
+        explicit recorded_vector(vector_type v) : m_v(std::move(v)){}
+
+        recorded_vector(std::initializer_list<T> init) : m_v(init){}
+
+        recorded_vector(const recorded_vector& other) : m_v(other.m_v){}
+
+        recorded_vector(recorded_vector&& other) noexcept
+            : m_v(std::move(other.m_v)), m_id(std::exchange(other.m_id, 0)), m_generation(other.m_generation){}
+
+        recorded_vector& operator=(const recorded_vector& other){
+            if(this != &other){
+                const std::uint64_t id = trace_id();
+                m_v = other.m_v;
+                record(id, op_trace_op::clear);
+                record(id, op_trace_op::resize, m_v.size());
+            }
+            return *this;
+        }
+
+        recorded_vector& operator=(recorded_vector&& other) noexcept{
+            if(this != &other){
+                forget();
+                m_v = std::move(other.m_v);
+                m_id = std::exchange(other.m_id, 0);
+                m_generation = other.m_generation;
+            }
+            return *this;
+        }
+
+        ~recorded_vector(){
+            forget();
+        }
+
+        void swap(recorded_vector& other) noexcept{
+            m_v.swap(other.m_v);
+            std::swap(m_id, other.m_id);
+            std::swap(m_generation, other.m_generation);
+        }
+
+        //the vector itself, for reads; changes through it are not recorded
+        [[nodiscard]] const vector_type& get() const noexcept{ return m_v; }
+
+        [[nodiscard]] size_type size() const noexcept{ return m_v.size(); }
+        [[nodiscard]] bool empty() const noexcept{ return m_v.empty(); }
+        [[nodiscard]] size_type capacity() const noexcept{ return m_v.capacity(); }
+        [[nodiscard]] T* data() noexcept{ return m_v.data(); }
+        [[nodiscard]] const T* data() const noexcept{ return m_v.data(); }
+        [[nodiscard]] T& operator[](size_type pos){ return m_v[pos]; }
+        [[nodiscard]] const T& operator[](size_type pos) const{ return m_v[pos]; }
+        [[nodiscard]] T& at(size_type pos){ return m_v.at(pos); }
+        [[nodiscard]] const T& at(size_type pos) const{ return m_v.at(pos); }
+        [[nodiscard]] T& front(){ return m_v.front(); }
+        [[nodiscard]] const T& front() const{ return m_v.front(); }
+        [[nodiscard]] T& back(){ return m_v.back(); }
+        [[nodiscard]] const T& back() const{ return m_v.back(); }
+        [[nodiscard]] iterator begin() noexcept{ return m_v.begin(); }
+        [[nodiscard]] iterator end() noexcept{ return m_v.end(); }
+        [[nodiscard]] const_iterator begin() const noexcept{ return m_v.begin(); }
+        [[nodiscard]] const_iterator end() const noexcept{ return m_v.end(); }
+        [[nodiscard]] const_iterator cbegin() const noexcept{ return m_v.cbegin(); }
+        [[nodiscard]] const_iterator cend() const noexcept{ return m_v.cend(); }
+
+        //recorded changes; each is recorded once it succeeded
+
+        void push_back(const T& value){
+            const std::uint64_t id = trace_id();
+            m_v.push_back(value);
+            record(id, op_trace_op::push_back);
+        }
+
+        void push_back(T&& value){
+            const std::uint64_t id = trace_id();
+            m_v.push_back(std::move(value));
+            record(id, op_trace_op::push_back);
+        }
+
+        template<class... Args>
+        T& emplace_back(Args&&... args){
+            const std::uint64_t id = trace_id();
+            T& ref = m_v.emplace_back(std::forward<Args>(args)...);
+            record(id, op_trace_op::push_back);
+            return ref;
+        }
+
+        void pop_back(){
+            const std::uint64_t id = trace_id();
+            m_v.pop_back();
+            record(id, op_trace_op::pop_back);
+        }
+
+        iterator insert(const_iterator pos, const T& value){
+            return recorded_insert(pos, 1, [&]{ return m_v.insert(pos, value); });
+        }
+
+        iterator insert(const_iterator pos, T&& value){
+            return recorded_insert(pos, 1, [&]{ return m_v.insert(pos, std::move(value)); });
+        }
+
+        iterator insert(const_iterator pos, size_type count, const T& value){
+            return recorded_insert(pos, count, [&]{ return m_v.insert(pos, count, value); });
+        }
+
+        template<class InputIt> requires std::input_iterator<InputIt>
+        iterator insert(const_iterator pos, InputIt first, InputIt last){
+            const std::uint64_t id = trace_id();
+            const size_type before = m_v.size();
+            const size_type offset = static_cast<size_type>(pos - m_v.cbegin());
+            iterator it = m_v.insert(pos, first, last);
+            if(m_v.size() != before) record(id, op_trace_op::insert, offset, m_v.size() - before);
+            return it;
+        }
+
+        iterator insert(const_iterator pos, std::initializer_list<T> ilist){
+            return insert(pos, ilist.begin(), ilist.end());
+        }
+
+        template<class... Args>
+        iterator emplace(const_iterator pos, Args&&... args){
+            return recorded_insert(pos, 1, [&]{ return m_v.emplace(pos, std::forward<Args>(args)...); });
+        }
+
+        iterator erase(const_iterator pos){
+            return erase(pos, pos + 1);
+        }
+
+        iterator erase(const_iterator first, const_iterator last){
+            const std::uint64_t id = trace_id();
+            const size_type offset = static_cast<size_type>(first - m_v.cbegin());
+            const size_type count = static_cast<size_type>(last - first);
+            iterator it = m_v.erase(first, last);
+            if(count) record(id, op_trace_op::erase, offset, count);
+            return it;
+        }
+
+        void reserve(size_type n){
+            const std::uint64_t id = trace_id();
+            m_v.reserve(n);
+            record(id, op_trace_op::reserve, n);
+        }
+
+        void resize(size_type n){
+            const std::uint64_t id = trace_id();
+            m_v.resize(n);
+            record(id, op_trace_op::resize, n);
+        }
+
+        void resize(size_type n, const T& value){
+            const std::uint64_t id = trace_id();
+            m_v.resize(n, value);
+            record(id, op_trace_op::resize, n);
+        }
+
+        void clear() noexcept{
+            const std::uint64_t id = trace_id();
+            m_v.clear();
+            record(id, op_trace_op::clear);
+        }
+
+        void shrink_to_fit(){
+            const std::uint64_t id = trace_id();
+            m_v.shrink_to_fit();
+            record(id, op_trace_op::shrink);
+        }
+
+        void assign(size_type count, const T& value){
+            const std::uint64_t id = trace_id();
+            m_v.assign(count, value);
+            record(id, op_trace_op::clear);
+            record(id, op_trace_op::resize, count);
+        }
+
+        template<class InputIt> requires std::input_iterator<InputIt>
+        void assign(InputIt first, InputIt last){
+            const std::uint64_t id = trace_id();
+            m_v.assign(first, last);
+            record(id, op_trace_op::clear);
+            record(id, op_trace_op::resize, m_v.size());
+        }
+
+        friend bool operator==(const recorded_vector& a, const recorded_vector& b){ return a.m_v == b.m_v; }
+
+    private:
+        //the id to record under, 0 while no trace is open; a vector that is new to
+        //the trace (including one that had an id in an earlier trace) first
+        //records its current shape
+        //(called before the change, so that this shape is the one before it)
+        std::uint64_t trace_id() noexcept{
+            auto& writer = detail::op_trace_writer::instance();
+            if(!writer.active.load(std::memory_order_relaxed)) return 0;
+            const std::uint64_t generation = writer.generation.load(std::memory_order_relaxed);
+            if(m_id == 0 || m_generation != generation){
+                m_generation = generation;
+                m_id = writer.new_id();
+                write(op_trace_op::create, m_id, sizeof(T), 0, 1);
+                if(m_v.capacity()) write(op_trace_op::reserve, m_id, m_v.capacity(), 0, 1);
+                if(m_v.size()) write(op_trace_op::resize, m_id, m_v.size(), 0, 1);
+            }
+            return m_id;
+        }
+
+        static void record(std::uint64_t id, op_trace_op op) noexcept{
+            if(id) write(op, id, 0, 0, 0);
+        }
+
+        static void record(std::uint64_t id, op_trace_op op, std::uint64_t a) noexcept{
+            if(id) write(op, id, a, 0, 1);
+        }
+
+        static void record(std::uint64_t id, op_trace_op op, std::uint64_t a, std::uint64_t b) noexcept{
+            if(id) write(op, id, a, b, 2);
+        }
+
+        //a failing write must not fail the vector operation; the trace just ends short
+        static void write(op_trace_op op, std::uint64_t id, std::uint64_t a, std::uint64_t b, int args) noexcept{
+            try{
+                detail::op_trace_writer::instance().record(op, id, a, b, args);
+            }catch(...){}
+        }
+
+        template<class Insert>
+        iterator recorded_insert(const_iterator pos, size_type count, Insert&& insert){
+            const std::uint64_t id = trace_id();
+            const size_type offset = static_cast<size_type>(pos - m_v.cbegin());
+            iterator it = insert();
+            if(count) record(id, op_trace_op::insert, offset, count);
+            return it;
+        }
+
+        void forget() noexcept{
+            auto& writer = detail::op_trace_writer::instance();
+            if(m_id && writer.active.load(std::memory_order_relaxed) && m_generation == writer.generation.load(std::memory_order_relaxed))
+                write(op_trace_op::destroy, m_id, 0, 0, 0);
+            m_id = 0;
+        }
+
+        vector_type m_v;
+        std::uint64_t m_id = 0;
+        std::uint64_t m_generation = 0;     //of the trace m_id belongs to
+    };
+}
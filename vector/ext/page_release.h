@@ -0,0 +1,142 @@
+//Give the memory of unused capacity back to the kernel, keeping the capacity
+//
+//A large vector that is cleared and refilled every cycle keeps its buffer, which
+//is the point (no reallocation), but also keeps every page of it resident
+//between cycles. release_unused_pages(v) madvises the whole pages between
+//v.data() + v.size() and v.data() + v.capacity() away: the address range and
+//the capacity stay, the physical pages go, and the next write to one of them
+//faults in a fresh zero page. Nothing there is an element, so nothing is lost.
+//
+//  page_release::dontneed  MADV_DONTNEED: RSS drops at once; every page is
+//                          faulted in again on refill
+//  page_release::lazy_free MADV_FREE (Linux 4.5): the kernel takes the pages
+//                          only under memory pressure, until then a refill
+//                          reuses them without a fault; RSS drops only then.
+//                          Falls back to MADV_DONTNEED where unsupported
+//
+//Only pages entirely inside the unused part are released, so with std::allocator
+//up to a page at each end stays. page_allocator<T> maps every block on its own
+//from a page boundary and rounds it up to whole pages, which makes the unused
+//part page aligned at the far end and keeps malloc's bookkeeping out of it.
+//It is meant for large vectors: every block is at least one page and one mmap.
+//
+//    ext::page_vector<sample> batch;
+//    for(;;){
+//        fill(batch);
+//        process(batch);
+//        ext::clear_and_release(batch);      //capacity kept, RSS released
+//    }
+#pragma once
+#include "../vector.h"
+#include "posix_fd.h"
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace ext{
+    enum class page_release{
+        dontneed,
+        lazy_free
+    };
+
+    namespace detail{
+        inline std::size_t page_size() noexcept{
+            static const std::size_t size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+            return size;
+        }
+
+        inline std::size_t round_up_to_pages(std::size_t bytes) noexcept{
+            const std::size_t page = page_size();
+            return (bytes + page - 1) / page * page;
+        }
+
+        //bytes released in [first, last); throws std::system_error if madvise fails
+        inline std::size_t release_pages(const void* first, const void* last, page_release how){
+            const std::uintptr_t page = page_size();
+            const std::uintptr_t begin = (reinterpret_cast<std::uintptr_t>(first) + page - 1) / page * page;
+            const std::uintptr_t end = reinterpret_cast<std::uintptr_t>(last) / page * page;
+            if(end <= begin) return 0;
+            void* p = reinterpret_cast<void*>(begin);
+            const std::size_t len = end - begin;
+#ifdef MADV_FREE
+            if(how == page_release::lazy_free){
+                if(::madvise(p, len, MADV_FREE) == 0) return len;
+                if(errno != EINVAL) throw_errno("release_unused_pages: madvise(MADV_FREE)");
+            }
+#endif
+            if(::madvise(p, len, MADV_DONTNEED) != 0) throw_errno("release_unused_pages: madvise(MADV_DONTNEED)");
+            return len;
+        }
+    }
+
+    //std::allocator<T> with each block mmapped on its own, in whole pages
+    template<class T>
+    class page_allocator{
+    public:
+        using value_type = T;
+
+        page_allocator() noexcept = default;
+        template<class U>
+        page_allocator(const page_allocator<U>&) noexcept{}
+
+        [[nodiscard]] T* allocate(std::size_t n){
+            static_assert(alignof(T) <= 4096, "page_allocator aligns to pages");
+            if(n > static_cast<std::size_t>(-1) / sizeof(T)) throw std::bad_array_new_length();
+            void* p = ::mmap(nullptr, detail::round_up_to_pages(n * sizeof(T)), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(p == MAP_FAILED) throw std::bad_alloc();
+            return static_cast<T*>(p);
+        }
+
+        void deallocate(T* p, std::size_t n) noexcept{
+            ::munmap(p, detail::round_up_to_pages(n * sizeof(T)));
+        }
+
+        //a fresh anonymous mapping reads as zeros until written
+        [[nodiscard]] T* allocate_zeroed(std::size_t n){ return allocate(n); }
+
+        friend bool operator==(const page_allocator&, const page_allocator&) noexcept{ return true; }
+    };
+
+    template<class T>
+    using page_vector = std::vector<T, page_allocator<T>>;
+
+    namespace detail{
+        //allocators whose blocks are usable up to the end of their last page
+        template<class Allocator>
+        inline constexpr bool whole_page_blocks = false;
+
+        template<class T>
+        inline constexpr bool whole_page_blocks<page_allocator<T>> = true;
+    }
+
+    //release the whole pages of v's unused capacity; returns the bytes released
+    template<class T, class Allocator>
+    std::size_t release_unused_pages(std::vector<T, Allocator>& v, page_release how = page_release::dontneed){
+        if(v.capacity() == 0) return 0;
+        const char* base = reinterpret_cast<const char*>(v.data());
+        std::size_t end = v.capacity() * sizeof(T);
+        if constexpr(detail::whole_page_blocks<Allocator>) end = detail::round_up_to_pages(end);   //the block's last page is whole
+        return detail::release_pages(base + v.size() * sizeof(T), base + end, how);
+    }
+
+    //clear() that also releases the pages of the whole buffer
+    template<class T, class Allocator>
+    std::size_t clear_and_release(std::vector<T, Allocator>& v, page_release how = page_release::dontneed){
+        v.clear();
+        return release_unused_pages(v, how);
+    }
+}
+
+namespace std{
+    template<class T>
+    struct vector_allocator_zeroed<ext::page_allocator<T>>{
+        static constexpr bool enabled = true;
+
+        static T* allocate_zeroed(ext::page_allocator<T>& alloc, size_t n){
+            return alloc.allocate_zeroed(n);
+        }
+    };
+}
@@ -0,0 +1,589 @@
+//Persistent (immutable) vector with structural sharing
+//
+//persistent_vector<T> is a 32-way trie of fixed 32-element leaves plus a tail leaf
+//for the last (up to) 32 elements, as in Clojure's PersistentVector. Copying one is
+//O(1); push_back, set, pop_back and slice leave the original alone and return a new
+//version in O(log32 n), sharing every node off the modified path. That makes it
+//cheap to hand the same large vector to many readers as snapshots, where a
+//vector<T> would have to be copied for each.
+//
+//Nodes are reference counted (atomically, so versions may be read and released on
+//any thread) and a node is only ever modified in place when its count is 1, i.e.
+//nothing else can see it. That one rule gives
+//  - transient_vector<T>: a builder for batch edits. Its first write on a path
+//    copies the shared nodes once; later writes to the same nodes are in place.
+//  - rvalue overloads: std::move(v).push_back(x) reuses v's unshared nodes.
+//
+//Slices keep absolute indices: slice(first, last) cuts the trie on the right and
+//drops the nodes left of `first`, so a slice holds on to O(log n) extra nodes at
+//most rather than the whole original.
+//
+//Element access is O(log32 n) (at most 7 levels for 2^32 elements), iteration
+//visits a leaf at a time. T must be copy constructible.
+#pragma once
+#include "../vector.h"
+#include <atomic>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace ext{
+    template<class T> class persistent_vector;
+    template<class T> class transient_vector;
+
+    namespace detail{
+        inline constexpr unsigned pvec_bits = 5;
+        inline constexpr std::size_t pvec_width = std::size_t(1) << pvec_bits;
+        inline constexpr std::size_t pvec_mask = pvec_width - 1;
+
+        struct pvec_node{
+            std::atomic<std::uint32_t> refs{1};
+        };
+
+        struct pvec_inner : pvec_node{
+            pvec_node* child[pvec_width] = {};
+        };
+
+        template<class T>
+        struct pvec_leaf : pvec_node{
+            std::uint32_t count = 0;
+            alignas(T) unsigned char storage[pvec_width * sizeof(T)];
+
+            T* items() noexcept{ return reinterpret_cast<T*>(storage); }
+            const T* items() const noexcept{ return reinterpret_cast<const T*>(storage); }
+
+            ~pvec_leaf(){ std::destroy_n(items(), count); }
+        };
+
+        //The shared representation of persistent_vector and transient_vector.
+        //Elements live at absolute indices [offset, cnt): the tail leaf holds
+        //[tail_offset(), cnt), the trie holds the rest. Every pointer owns one
+        //reference. All operations mutate in place wherever the node is unshared and
+        //copy it otherwise, so a persistent update is "copy the state, then mutate".
+        template<class T>
+        class pvec_state{
+            using inner = pvec_inner;
+            using leaf = pvec_leaf<T>;
+
+        public:
+            pvec_node* root = nullptr;      //inner node at `shift`; null while the trie holds nothing live
+            leaf* tail = nullptr;           //null only when empty
+            unsigned shift = pvec_bits;
+            std::size_t offset = 0;
+            std::size_t cnt = 0;
+
+            pvec_state() noexcept = default;
+
+            pvec_state(const pvec_state& other) noexcept
+                : root(other.root), tail(other.tail), shift(other.shift), offset(other.offset), cnt(other.cnt){
+                retain(root);
+                retain(tail);
+            }
+
+            pvec_state(pvec_state&& other) noexcept
+                : root(std::exchange(other.root, nullptr)), tail(std::exchange(other.tail, nullptr)),
+                  shift(std::exchange(other.shift, pvec_bits)), offset(std::exchange(other.offset, 0)), cnt(std::exchange(other.cnt, 0)){}
+
+            pvec_state& operator=(pvec_state other) noexcept{
+                swap(other);
+                return *this;
+            }
+
+            ~pvec_state(){
+                clear();
+            }
+
+            void swap(pvec_state& other) noexcept{
+                std::swap(root, other.root);
+                std::swap(tail, other.tail);
+                std::swap(shift, other.shift);
+                std::swap(offset, other.offset);
+                std::swap(cnt, other.cnt);
+            }
+
+            std::size_t size() const noexcept{ return cnt - offset; }
+
+            std::size_t tail_offset() const noexcept{
+                return cnt < pvec_width ? 0 : ((cnt - 1) >> pvec_bits) << pvec_bits;
+            }
+
+            //the 32 elements of the block holding absolute index a
+            const T* block_for(std::size_t a) const noexcept{
+                if(a >= tail_offset()) return tail->items();
+                const pvec_node* n = root;
+                for(unsigned level = shift; level > 0; level -= pvec_bits){
+                    n = static_cast<const inner*>(n)->child[(a >> level) & pvec_mask];
+                }
+                return static_cast<const leaf*>(n)->items();
+            }
+
+            const T& get(std::size_t a) const noexcept{
+                return block_for(a)[a & pvec_mask];
+            }
+
+            void clear() noexcept{
+                release(root, shift);
+                release(tail, 0);
+                root = nullptr;
+                tail = nullptr;
+                shift = pvec_bits;
+                offset = cnt = 0;
+            }
+
+            template<class... Args>
+            void emplace_back(Args&&... args){
+                if(tail && tail->count == pvec_width){
+                    //the full tail moves into the trie; build the new one first so a
+                    //throwing constructor leaves everything as it was
+                    leaf_ptr fresh(new leaf);
+                    ::new(fresh->items()) T(std::forward<Args>(args)...);
+                    fresh->count = 1;
+                    push_leaf(cnt - pvec_width, tail);
+                    tail = fresh.release();
+                }
+                else{
+                    if(!tail) tail = new leaf;
+                    else unique_leaf(tail);
+                    ::new(tail->items() + tail->count) T(std::forward<Args>(args)...);
+                    ++tail->count;
+                }
+                ++cnt;
+            }
+
+            template<class U>
+            void set(std::size_t i, U&& value){
+                const std::size_t a = offset + i;
+                if(a >= tail_offset()){
+                    unique_leaf(tail);
+                    tail->items()[a - tail_offset()] = std::forward<U>(value);
+                    return;
+                }
+                pvec_node** slot = &root;
+                for(unsigned level = shift; level > 0; level -= pvec_bits){
+                    inner* n = unique_inner(*slot, level);
+                    slot = &n->child[(a >> level) & pvec_mask];
+                }
+                unique_leaf(*slot)->items()[a & pvec_mask] = std::forward<U>(value);
+            }
+
+            void pop_back(){
+                if(size() == 1){
+                    clear();
+                    return;
+                }
+                if(tail->count > 1){
+                    unique_leaf(tail);
+                    std::destroy_at(tail->items() + tail->count - 1);
+                    --tail->count;
+                    --cnt;
+                    return;
+                }
+                //the tail empties: the last trie leaf takes its place
+                const std::size_t new_tail_offset = ((cnt - 2) >> pvec_bits) << pvec_bits;
+                leaf* new_tail = const_cast<leaf*>(leaf_at(new_tail_offset));
+                retain(new_tail);
+                truncate_trie(new_tail_offset);
+                release(tail, 0);
+                tail = new_tail;
+                --cnt;
+            }
+
+            //keep the elements [first, last) of the current ones
+            void slice(std::size_t first, std::size_t last){
+                if(first == last){
+                    clear();
+                    return;
+                }
+                const std::size_t a = offset + first;
+                const std::size_t b = offset + last;
+                if(b < cnt){
+                    const std::size_t new_tail_offset = b < pvec_width ? 0 : ((b - 1) >> pvec_bits) << pvec_bits;
+                    const std::size_t keep = b - new_tail_offset;
+                    if(new_tail_offset == tail_offset()){
+                        unique_leaf(tail);
+                        std::destroy(tail->items() + keep, tail->items() + tail->count);
+                        tail->count = static_cast<std::uint32_t>(keep);
+                    }
+                    else{
+                        const leaf* src = leaf_at(new_tail_offset);
+                        leaf* new_tail;
+                        if(keep == pvec_width){
+                            new_tail = const_cast<leaf*>(src);
+                            retain(new_tail);
+                        }
+                        else{
+                            new_tail = copy_leaf(src, keep);
+                        }
+                        truncate_trie(new_tail_offset);
+                        release(tail, 0);
+                        tail = new_tail;
+                    }
+                    cnt = b;
+                }
+                if(a > offset){
+                    offset = a;
+                    trim_front();
+                }
+            }
+
+            static void retain(pvec_node* n) noexcept{
+                if(n) n->refs.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            //drop one reference to the subtree at n (level 0 is a leaf)
+            static void release(pvec_node* n, unsigned level) noexcept{
+                if(!n || n->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+                if(level == 0){
+                    delete static_cast<leaf*>(n);
+                    return;
+                }
+                inner* in = static_cast<inner*>(n);
+                for(pvec_node* c : in->child) release(c, level - pvec_bits);
+                delete in;
+            }
+
+        private:
+            struct leaf_deleter{
+                void operator()(leaf* l) const noexcept{ release(l, 0); }
+            };
+            using leaf_ptr = std::unique_ptr<leaf, leaf_deleter>;
+
+            static leaf* copy_leaf(const leaf* src, std::size_t n){
+                leaf_ptr l(new leaf);
+                for(; l->count < n; ++l->count){
+                    ::new(l->items() + l->count) T(src->items()[l->count]);
+                }
+                return l.release();
+            }
+
+            //make the node in `slot` exclusively ours, copying it if it is shared
+            //(or creating it if the slot is empty), and return it
+            static inner* unique_inner(pvec_node*& slot, unsigned level){
+                if(!slot){
+                    slot = new inner;
+                }
+                else if(slot->refs.load(std::memory_order_acquire) != 1){
+                    const inner* src = static_cast<const inner*>(slot);
+                    inner* copy = new inner;
+                    for(std::size_t i = 0; i < pvec_width; ++i){
+                        copy->child[i] = src->child[i];
+                        retain(copy->child[i]);
+                    }
+                    release(slot, level);
+                    slot = copy;
+                }
+                return static_cast<inner*>(slot);
+            }
+
+            //same for a leaf, held either as the tail or in a trie slot
+            template<class P>
+            static leaf* unique_leaf(P& slot){
+                leaf* l = static_cast<leaf*>(slot);
+                if(l->refs.load(std::memory_order_acquire) != 1){
+                    leaf* copy = copy_leaf(l, l->count);
+                    release(l, 0);
+                    slot = copy;
+                    return copy;
+                }
+                return l;
+            }
+
+            const leaf* leaf_at(std::size_t a) const noexcept{
+                const pvec_node* n = root;
+                for(unsigned level = shift; level > 0; level -= pvec_bits){
+                    n = static_cast<const inner*>(n)->child[(a >> level) & pvec_mask];
+                }
+                return static_cast<const leaf*>(n);
+            }
+
+            //hang the full leaf l at absolute block index a; the trie takes over l's reference
+            void push_leaf(std::size_t a, leaf* l){
+                if(!root) shift = pvec_bits;
+                //add levels until a fits: the old root becomes the leftmost child
+                while((a >> shift) >= pvec_width){
+                    inner* up = new inner;
+                    up->child[0] = root;
+                    root = up;
+                    shift += pvec_bits;
+                }
+                pvec_node** slot = &root;
+                for(unsigned level = shift; ; level -= pvec_bits){
+                    inner* n = unique_inner(*slot, level);
+                    slot = &n->child[(a >> level) & pvec_mask];
+                    if(level == pvec_bits) break;
+                }
+                *slot = l;
+            }
+
+            //keep only the trie blocks below absolute index n (a multiple of 32)
+            void truncate_trie(std::size_t n){
+                if(n <= offset){
+                    release(root, shift);
+                    root = nullptr;
+                    shift = pvec_bits;
+                    return;
+                }
+                const std::size_t last = n - 1;
+                pvec_node** slot = &root;
+                for(unsigned level = shift; ; level -= pvec_bits){
+                    inner* node = unique_inner(*slot, level);
+                    const std::size_t sub = (last >> level) & pvec_mask;
+                    for(std::size_t j = sub + 1; j < pvec_width; ++j){
+                        release(node->child[j], level - pvec_bits);
+                        node->child[j] = nullptr;
+                    }
+                    if(level == pvec_bits) break;
+                    slot = &node->child[sub];
+                }
+                //drop levels the trie no longer needs
+                while(shift > pvec_bits && (last >> shift) == 0){
+                    pvec_node* c = static_cast<inner*>(root)->child[0];
+                    retain(c);
+                    release(root, shift);
+                    root = c;
+                    shift -= pvec_bits;
+                }
+            }
+
+            //release every subtree entirely left of offset
+            void trim_front(){
+                if(offset >= tail_offset()){
+                    release(root, shift);
+                    root = nullptr;
+                    shift = pvec_bits;
+                    return;
+                }
+                pvec_node** slot = &root;
+                for(unsigned level = shift; ; level -= pvec_bits){
+                    inner* node = unique_inner(*slot, level);
+                    const std::size_t sub = (offset >> level) & pvec_mask;
+                    for(std::size_t j = 0; j < sub; ++j){
+                        release(node->child[j], level - pvec_bits);
+                        node->child[j] = nullptr;
+                    }
+                    if(level == pvec_bits) break;
+                    slot = &node->child[sub];
+                }
+            }
+        };
+
+        //random access iterator that remembers the leaf it is in
+        template<class T>
+        class pvec_iterator{
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using iterator_concept = std::random_access_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const T*;
+            using reference = const T&;
+
+            pvec_iterator() noexcept = default;
+            pvec_iterator(const pvec_state<T>* s, std::size_t a) noexcept : m_state(s), m_index(a){}
+
+            reference operator*() const noexcept{
+                const std::size_t base = m_index & ~pvec_mask;
+                if(m_block == nullptr || base != m_block_base){
+                    m_block = m_state->block_for(m_index);
+                    m_block_base = base;
+                }
+                return m_block[m_index & pvec_mask];
+            }
+            pointer operator->() const noexcept{ return &**this; }
+            reference operator[](difference_type n) const noexcept{ return *(*this + n); }
+
+            pvec_iterator& operator++() noexcept{ ++m_index; return *this; }
+            pvec_iterator operator++(int) noexcept{ pvec_iterator t = *this; ++m_index; return t; }
+            pvec_iterator& operator--() noexcept{ --m_index; return *this; }
+            pvec_iterator operator--(int) noexcept{ pvec_iterator t = *this; --m_index; return t; }
+            pvec_iterator& operator+=(difference_type n) noexcept{ m_index += n; return *this; }
+            pvec_iterator& operator-=(difference_type n) noexcept{ m_index -= n; return *this; }
+            friend pvec_iterator operator+(pvec_iterator it, difference_type n) noexcept{ return it += n; }
+            friend pvec_iterator operator+(difference_type n, pvec_iterator it) noexcept{ return it += n; }
+            friend pvec_iterator operator-(pvec_iterator it, difference_type n) noexcept{ return it -= n; }
+            friend difference_type operator-(const pvec_iterator& a, const pvec_iterator& b) noexcept{
+                return static_cast<difference_type>(a.m_index) - static_cast<difference_type>(b.m_index);
+            }
+            friend bool operator==(const pvec_iterator& a, const pvec_iterator& b) noexcept{ return a.m_index == b.m_index; }
+            friend auto operator<=>(const pvec_iterator& a, const pvec_iterator& b) noexcept{ return a.m_index <=> b.m_index; }
+
+        private:
+            const pvec_state<T>* m_state = nullptr;
+            std::size_t m_index = 0;
+            mutable const T* m_block = nullptr;
+            mutable std::size_t m_block_base = 0;
+        };
+    }
+
+    template<class T>
+    class persistent_vector{
+        static_assert(std::is_copy_constructible_v<T>, "persistent_vector elements are copied when nodes are");
+    public:
+        using value_type = T;
+        using size_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using const_reference = const T&;
+        using reference = const T&;
+        using const_iterator = detail::pvec_iterator<T>;
+        using iterator = const_iterator;
+        using transient_type = transient_vector<T>;
+
+        persistent_vector() noexcept = default;
+
+        template<class InputIt> requires std::input_iterator<InputIt>
+        persistent_vector(InputIt first, InputIt last){
+            for(; first != last; ++first) m.emplace_back(*first);
+        }
+
+        persistent_vector(std::initializer_list<T> init) : persistent_vector(init.begin(), init.end()){}
+
+        template<class A>
+        explicit persistent_vector(const std::vector<T, A>& v) : persistent_vector(v.begin(), v.end()){}
+
+        [[nodiscard]] size_type size() const noexcept{ return m.size(); }
+        [[nodiscard]] bool empty() const noexcept{ return m.size() == 0; }
+
+        [[nodiscard]] const T& operator[](size_type pos) const noexcept{ return m.get(m.offset + pos); }
+
+        [[nodiscard]] const T& at(size_type pos) const{
+            if(pos >= size()) throw std::out_of_range("persistent_vector::at: index out of range");
+            return (*this)[pos];
+        }
+
+        [[nodiscard]] const T& front() const noexcept{ return (*this)[0]; }
+        [[nodiscard]] const T& back() const noexcept{ return (*this)[size() - 1]; }
+
+        [[nodiscard]] const_iterator begin() const noexcept{ return const_iterator(&m, m.offset); }
+        [[nodiscard]] const_iterator end() const noexcept{ return const_iterator(&m, m.cnt); }
+        [[nodiscard]] const_iterator cbegin() const noexcept{ return begin(); }
+        [[nodiscard]] const_iterator cend() const noexcept{ return end(); }
+
+        //new version with value appended
+        [[nodiscard]] persistent_vector push_back(T value) const&{
+            return persistent_vector(*this).push_back(std::move(value));
+        }
+        [[nodiscard]] persistent_vector push_back(T value) &&{
+            m.emplace_back(std::move(value));
+            return std::move(*this);
+        }
+
+        //new version with element pos replaced
+        [[nodiscard]] persistent_vector set(size_type pos, T value) const&{
+            return persistent_vector(*this).set(pos, std::move(value));
+        }
+        [[nodiscard]] persistent_vector set(size_type pos, T value) &&{
+            if(pos >= size()) throw std::out_of_range("persistent_vector::set: index out of range");
+            m.set(pos, std::move(value));
+            return std::move(*this);
+        }
+
+        //new version without the last element
+        [[nodiscard]] persistent_vector pop_back() const&{
+            return persistent_vector(*this).pop_back();
+        }
+        [[nodiscard]] persistent_vector pop_back() &&{
+            if(empty()) throw std::out_of_range("persistent_vector::pop_back: empty vector");
+            m.pop_back();
+            return std::move(*this);
+        }
+
+        //new version holding the elements [first, last)
+        [[nodiscard]] persistent_vector slice(size_type first, size_type last) const&{
+            return persistent_vector(*this).slice(first, last);
+        }
+        [[nodiscard]] persistent_vector slice(size_type first, size_type last) &&{
+            if(first > last || last > size()) throw std::out_of_range("persistent_vector::slice: bad range");
+            m.slice(first, last);
+            return std::move(*this);
+        }
+
+        //builder for a batch of edits starting from this version
+        [[nodiscard]] transient_type transient() const&{
+            return transient_type(*this);
+        }
+        [[nodiscard]] transient_type transient() &&{
+            return transient_type(std::move(*this));
+        }
+
+        template<class A = std::allocator<T>>
+        [[nodiscard]] std::vector<T, A> to_vector(const A& alloc = A()) const{
+            std::vector<T, A> v(alloc);
+            v.reserve(size());
+            for(std::size_t a = m.offset; a < m.cnt;){
+                const std::size_t block_end = std::min((a | detail::pvec_mask) + 1, m.cnt);
+                const T* block = m.block_for(a);
+                v.insert(v.end(), block + (a & detail::pvec_mask), block + (a & detail::pvec_mask) + (block_end - a));
+                a = block_end;
+            }
+            return v;
+        }
+
+        void swap(persistent_vector& other) noexcept{ m.swap(other.m); }
+
+        friend bool operator==(const persistent_vector& a, const persistent_vector& b){
+            if(a.size() != b.size()) return false;
+            if(a.m.root == b.m.root && a.m.tail == b.m.tail && a.m.offset == b.m.offset) return true;
+            return std::equal(a.begin(), a.end(), b.begin());
+        }
+
+    private:
+        friend class transient_vector<T>;
+        detail::pvec_state<T> m;
+    };
+
+    //Mutable builder over the same structure. Only touches nodes it owns alone, so
+    //the persistent versions it was created from are never affected. Move-only,
+    //not thread safe.
+    template<class T>
+    class transient_vector{
+    public:
+        using value_type = T;
+        using size_type = std::size_t;
+
+        transient_vector() noexcept = default;
+        explicit transient_vector(const persistent_vector<T>& v) noexcept : m(v.m){}
+        explicit transient_vector(persistent_vector<T>&& v) noexcept : m(std::move(v.m)){}
+
+        transient_vector(transient_vector&&) noexcept = default;
+        transient_vector& operator=(transient_vector&&) noexcept = default;
+        transient_vector(const transient_vector&) = delete;
+        transient_vector& operator=(const transient_vector&) = delete;
+
+        [[nodiscard]] size_type size() const noexcept{ return m.size(); }
+        [[nodiscard]] bool empty() const noexcept{ return m.size() == 0; }
+        [[nodiscard]] const T& operator[](size_type pos) const noexcept{ return m.get(m.offset + pos); }
+
+        void push_back(const T& value){ m.emplace_back(value); }
+        void push_back(T&& value){ m.emplace_back(std::move(value)); }
+
+        template<class... Args>
+        void emplace_back(Args&&... args){ m.emplace_back(std::forward<Args>(args)...); }
+
+        void set(size_type pos, T value){
+            if(pos >= size()) throw std::out_of_range("transient_vector::set: index out of range");
+            m.set(pos, std::move(value));
+        }
+
+        void pop_back(){
+            if(empty()) throw std::out_of_range("transient_vector::pop_back: empty vector");
+            m.pop_back();
+        }
+
+        //finish the batch; the transient is left empty
+        [[nodiscard]] persistent_vector<T> persistent(){
+            persistent_vector<T> v;
+            v.m = std::move(m);
+            return v;
+        }
+
+    private:
+        detail::pvec_state<T> m;
+    };
+}
@@ -0,0 +1,22 @@
+//Small POSIX file descriptor helpers shared by the ext headers that do I/O
+#pragma once
+#include <cerrno>
+#include <system_error>
+#include <unistd.h>
+
+namespace ext{
+    namespace detail{
+        [[noreturn]] inline void throw_errno(const char* what){
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+
+        //RAII file descriptor for the path overloads
+        struct unique_fd{
+            int fd;
+            explicit unique_fd(int f) : fd(f){}
+            unique_fd(const unique_fd&) = delete;
+            unique_fd& operator=(const unique_fd&) = delete;
+            ~unique_fd(){ if(fd >= 0) ::close(fd); }
+        };
+    }
+}
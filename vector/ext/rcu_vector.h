@@ -0,0 +1,257 @@
+//RCU-published vector for read-mostly tables
+//
+//rcu_vector<T> holds a pointer to an immutable vector<T>. Writers never touch the
+//published vector: they build a new one (publish(), or update() which copies the
+//current one and lets a callback edit the copy) and swap it in with one atomic
+//exchange. Readers take a snapshot, which pins the version they loaded for as long
+//as the snapshot lives, and read it like any const vector<T>.
+//
+//Taking and dropping a snapshot is wait-free: two stores and a load to a slot
+//owned by the reading thread, on its own cache line. Readers never write to
+//anything another reader touches, so unlike shared_mutex they do not contend
+//with each other at all.
+//
+//Old versions are reclaimed with epochs. Each retired version is stamped with
+//the global epoch at which it was replaced, and freed once every thread that is
+//inside a snapshot entered it at a later epoch. Reclamation runs on the writer
+//side (each publish and update), so a snapshot held for a long time delays the
+//freeing of versions retired after it was taken, but never blocks a writer.
+//
+//Snapshots belong to the thread that took them and must be dropped on it. They
+//may be nested. Writers are serialised per rcu_vector; readers need no lock.
+//
+//    ext::rcu_vector<route> table(load_routes());
+//    { auto s = table.read(); lookup(*s, key); }             //any thread
+//    table.update([](auto& v){ v.push_back(new_route); });   //writer
+#pragma once
+#include "../vector.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace ext{
+    namespace detail{
+        //a reader thread's announcement; on its own cache line so readers never share one
+        struct alignas(64) rcu_slot{
+            std::atomic<std::uint64_t> epoch{0};    //0 while the thread is not reading
+            std::atomic<bool> in_use{false};
+            rcu_slot* next = nullptr;
+        };
+
+        class rcu_domain{
+        public:
+            //never destroyed, so readers and writers running during static destruction are safe
+            static rcu_domain& instance(){
+                static rcu_domain* domain = new rcu_domain;
+                return *domain;
+            }
+
+            //slots are reused by later threads, never freed
+            rcu_slot* acquire_slot(){
+                for(rcu_slot* s = m_slots.load(std::memory_order_acquire); s; s = s->next){
+                    bool expected = false;
+                    if(!s->in_use.load(std::memory_order_relaxed) &&
+                       s->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) return s;
+                }
+                auto* s = new rcu_slot;
+                s->in_use.store(true, std::memory_order_relaxed);
+                s->next = m_slots.load(std::memory_order_relaxed);
+                while(!m_slots.compare_exchange_weak(s->next, s, std::memory_order_release, std::memory_order_relaxed)){}
+                return s;
+            }
+
+            void release_slot(rcu_slot* s) noexcept{
+                s->epoch.store(0, std::memory_order_release);
+                s->in_use.store(false, std::memory_order_release);
+            }
+
+            std::uint64_t epoch() const noexcept{
+                return m_epoch.load(std::memory_order_seq_cst);
+            }
+
+            //p has already been unlinked; free it with deleter once no reader can hold it
+            void retire(void* p, void (*deleter)(void*)){
+                const std::uint64_t e = m_epoch.fetch_add(1, std::memory_order_seq_cst);
+                std::vector<retired> ready;
+                {
+                    std::lock_guard<std::mutex> lock(m_lock);
+                    m_retired.push_back({p, deleter, e});
+                    collect(ready);
+                }
+                for(const retired& r : ready) r.deleter(r.p);
+            }
+
+            //wait until every reader that might hold something retired so far has left, then free it
+            void synchronize(){
+                const std::uint64_t e = m_epoch.fetch_add(1, std::memory_order_seq_cst);
+                while(oldest_reader() <= e) std::this_thread::yield();
+                std::vector<retired> ready;
+                {
+                    std::lock_guard<std::mutex> lock(m_lock);
+                    collect(ready);
+                }
+                for(const retired& r : ready) r.deleter(r.p);
+            }
+
+        private:
+            struct retired{
+                void* p;
+                void (*deleter)(void*);
+                std::uint64_t epoch;    //replaced during this epoch
+            };
+
+            //smallest epoch a current reader entered at, or UINT64_MAX if nobody is reading
+            std::uint64_t oldest_reader() const noexcept{
+                std::uint64_t oldest = UINT64_MAX;
+                for(rcu_slot* s = m_slots.load(std::memory_order_acquire); s; s = s->next){
+                    const std::uint64_t e = s->epoch.load(std::memory_order_seq_cst);
+                    if(e != 0 && e < oldest) oldest = e;
+                }
+                return oldest;
+            }
+
+            //move everything no reader can see any more into ready; m_lock is held
+            void collect(std::vector<retired>& ready){
+                const std::uint64_t oldest = oldest_reader();
+                std::size_t kept = 0;
+                for(const retired& r : m_retired){
+                    if(r.epoch < oldest) ready.push_back(r);
+                    else m_retired[kept++] = r;
+                }
+                m_retired.resize(kept);
+            }
+
+            std::atomic<std::uint64_t> m_epoch{1};
+            std::atomic<rcu_slot*> m_slots{nullptr};
+            std::mutex m_lock;
+            std::vector<retired> m_retired;
+        };
+
+        //the calling thread's slot, taken on its first snapshot
+        class rcu_reader{
+        public:
+            rcu_reader() : m_slot(rcu_domain::instance().acquire_slot()){}
+            rcu_reader(const rcu_reader&) = delete;
+            rcu_reader& operator=(const rcu_reader&) = delete;
+            ~rcu_reader(){ rcu_domain::instance().release_slot(m_slot); }
+
+            void lock() noexcept{
+                if(m_depth++ == 0) m_slot->epoch.store(rcu_domain::instance().epoch(), std::memory_order_seq_cst);
+            }
+
+            void unlock() noexcept{
+                if(--m_depth == 0) m_slot->epoch.store(0, std::memory_order_release);
+            }
+
+            bool reading() const noexcept{ return m_depth != 0; }
+
+        private:
+            rcu_slot* m_slot;
+            unsigned m_depth = 0;
+        };
+
+        inline rcu_reader& local_rcu_reader(){
+            static thread_local rcu_reader reader;
+            return reader;
+        }
+    }
+
+    template<class T, class Allocator = std::allocator<T>>
+    class rcu_vector{
+    public:
+        using vector_type = std::vector<T, Allocator>;
+        using value_type = T;
+        using size_type = typename vector_type::size_type;
+
+        //a pinned version; valid until destroyed, on the thread that took it
+        class snapshot{
+        public:
+            snapshot(snapshot&& other) noexcept
+                : m_reader(std::exchange(other.m_reader, nullptr)), m_vec(other.m_vec){}
+            snapshot& operator=(snapshot&&) = delete;
+
+            ~snapshot(){
+                if(m_reader) m_reader->unlock();
+            }
+
+            [[nodiscard]] const vector_type& operator*() const noexcept{ return *m_vec; }
+            [[nodiscard]] const vector_type* operator->() const noexcept{ return m_vec; }
+            [[nodiscard]] size_type size() const noexcept{ return m_vec->size(); }
+            [[nodiscard]] bool empty() const noexcept{ return m_vec->empty(); }
+            [[nodiscard]] const T& operator[](size_type pos) const{ return (*m_vec)[pos]; }
+            [[nodiscard]] auto begin() const noexcept{ return m_vec->cbegin(); }
+            [[nodiscard]] auto end() const noexcept{ return m_vec->cend(); }
+
+        private:
+            friend class rcu_vector;
+            snapshot(detail::rcu_reader* reader, const vector_type* vec) noexcept : m_reader(reader), m_vec(vec){}
+
+            detail::rcu_reader* m_reader;
+            const vector_type* m_vec;
+        };
+
+        explicit rcu_vector(vector_type v = vector_type()) : m_current(new vector_type(std::move(v))){}
+
+        rcu_vector(const rcu_vector&) = delete;
+        rcu_vector& operator=(const rcu_vector&) = delete;
+
+        //no snapshot of this rcu_vector may still be alive
+        ~rcu_vector(){
+            delete m_current.load(std::memory_order_relaxed);
+        }
+
+        //pin the current version. Wait-free after the thread's first call, which
+        //registers it with the reclaimer.
+        [[nodiscard]] snapshot read() const{
+            detail::rcu_reader& reader = detail::local_rcu_reader();
+            reader.lock();
+            return snapshot(&reader, m_current.load(std::memory_order_seq_cst));
+        }
+
+        //replace the contents with v
+        void publish(vector_type v){
+            vector_type* fresh = new vector_type(std::move(v));
+            vector_type* old;
+            {
+                std::lock_guard<std::mutex> lock(m_write_lock);
+                old = m_current.exchange(fresh, std::memory_order_seq_cst);
+            }
+            retire(old);
+        }
+
+        //read-copy-update: fn edits a copy of the current version, which then replaces it.
+        //If fn throws nothing is published.
+        template<class Fn>
+        void update(Fn&& fn){
+            vector_type* old;
+            {
+                std::lock_guard<std::mutex> lock(m_write_lock);
+                auto fresh = std::make_unique<vector_type>(*m_current.load(std::memory_order_relaxed));
+                std::forward<Fn>(fn)(*fresh);
+                old = m_current.exchange(fresh.release(), std::memory_order_seq_cst);
+            }
+            retire(old);
+        }
+
+        //block until every version replaced so far has been freed. Must not be
+        //called while the calling thread holds a snapshot.
+        static void synchronize(){
+            if(detail::local_rcu_reader().reading())
+                throw std::logic_error("rcu_vector::synchronize: called inside a snapshot");
+            detail::rcu_domain::instance().synchronize();
+        }
+
+    private:
+        static void retire(vector_type* old){
+            detail::rcu_domain::instance().retire(old, [](void* p){ delete static_cast<vector_type*>(p); });
+        }
+
+        std::atomic<vector_type*> m_current;
+        std::mutex m_write_lock;
+    };
+}
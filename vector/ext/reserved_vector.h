@@ -0,0 +1,125 @@
+//A vector that reserves its address range up front and never relocates
+//
+//reserving_allocator<T> maps every block as one large PROT_NONE reservation
+//(64 GiB by default) and makes only the pages the capacity covers readable and
+//writable. When the vector needs more capacity, vector_allocator_expand in
+//vector.h asks it first, and it mprotects the next pages of the same
+//reservation. So reserved_vector<T> grows in place up to the reservation:
+//data() never changes, pointers, references and iterators stay valid across
+//push_back, and nothing is ever moved or copied to grow, while the elements
+//stay contiguous. It is an ordinary vector<T, Allocator> otherwise, with the
+//same members and iterators.
+//
+//Growth still follows the vector's own doubling, which now costs one mprotect
+//per step; the pages themselves are faulted in when first written, so the RSS
+//follows the size rather than the capacity, and there is never an old and a new
+//block held at once. max_size() is the reservation, and growing past it throws
+//std::length_error like any full vector.
+//
+//The reservation is MAP_NORESERVE address space, which costs no memory and no
+//commit charge until mprotected, but a 47-bit address space holds only about
+//two thousand 64 GiB reservations: this is for a few large vectors, not for
+//many small ones. Pass a smaller reservation where that matters:
+//    ext::reserved_vector<tick> ticks;                                       //64 GiB
+//    ext::reserved_vector<order> book(ext::reserving_allocator<order>(std::size_t(1) << 30));
+//
+//A copy gets a reservation of its own. shrink_to_fit moves into a new one like
+//any vector; release_unused_pages (page_release.h) gives memory back in place.
+#pragma once
+#include "../vector.h"
+#include "page_release.h"
+#include <cstddef>
+#include <new>
+#include <sys/mman.h>
+#include <type_traits>
+
+namespace ext{
+    template<class T>
+    class reserving_allocator{
+    public:
+        using value_type = T;
+        using propagate_on_container_copy_assignment = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+
+        static constexpr std::size_t default_reservation = std::size_t(64) << 30;
+
+        //reservation in bytes, rounded up to whole pages
+        explicit reserving_allocator(std::size_t reservation = default_reservation) noexcept
+            : m_reservation(detail::round_up_to_pages(reservation)){}
+
+        template<class U>
+        reserving_allocator(const reserving_allocator<U>& other) noexcept : m_reservation(other.reservation()){}
+
+        [[nodiscard]] T* allocate(std::size_t n){
+            static_assert(alignof(T) <= 4096, "reserving_allocator aligns to pages");
+            if(n > max_size()) throw std::bad_array_new_length();
+            void* p = ::mmap(nullptr, m_reservation, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if(p == MAP_FAILED) throw std::bad_alloc();
+            const std::size_t bytes = detail::round_up_to_pages(n * sizeof(T));
+            if(bytes && ::mprotect(p, bytes, PROT_READ | PROT_WRITE) != 0){
+                ::munmap(p, m_reservation);
+                throw std::bad_alloc();
+            }
+            return static_cast<T*>(p);
+        }
+
+        void deallocate(T* p, std::size_t) noexcept{
+            ::munmap(p, m_reservation);
+        }
+
+        //a fresh reservation reads as zeros until written
+        [[nodiscard]] T* allocate_zeroed(std::size_t n){ return allocate(n); }
+
+        //make the block at p, allocated or last expanded to old_cap, hold new_cap;
+        //throws std::bad_alloc if the kernel will not commit the pages
+        bool expand(T* p, std::size_t old_cap, std::size_t new_cap){
+            if(new_cap > max_size()) return false;      //the vector never asks for it: max_size() is the reservation
+            const std::size_t committed = detail::round_up_to_pages(old_cap * sizeof(T));
+            const std::size_t bytes = detail::round_up_to_pages(new_cap * sizeof(T));
+            if(bytes > committed && ::mprotect(reinterpret_cast<char*>(p) + committed, bytes - committed, PROT_READ | PROT_WRITE) != 0)
+                throw std::bad_alloc();
+            return true;
+        }
+
+        [[nodiscard]] std::size_t max_size() const noexcept{ return m_reservation / sizeof(T); }
+        [[nodiscard]] std::size_t reservation() const noexcept{ return m_reservation; }
+
+        //a block is unmapped with the reservation it was mapped with
+        friend bool operator==(const reserving_allocator& a, const reserving_allocator& b) noexcept{
+            return a.m_reservation == b.m_reservation;
+        }
+
+    private:
+        std::size_t m_reservation;
+    };
+
+    template<class T>
+    using reserved_vector = std::vector<T, reserving_allocator<T>>;
+
+    namespace detail{
+        //the pages past the capacity up to the next page boundary are committed too
+        template<class T>
+        inline constexpr bool whole_page_blocks<reserving_allocator<T>> = true;
+    }
+}
+
+namespace std{
+    template<class T>
+    struct vector_allocator_expand<ext::reserving_allocator<T>>{
+        static constexpr bool enabled = true;
+
+        static bool expand(ext::reserving_allocator<T>& alloc, T* p, size_t old_cap, size_t new_cap){
+            return alloc.expand(p, old_cap, new_cap);
+        }
+    };
+
+    template<class T>
+    struct vector_allocator_zeroed<ext::reserving_allocator<T>>{
+        static constexpr bool enabled = true;
+
+        static T* allocate_zeroed(ext::reserving_allocator<T>& alloc, size_t n){
+            return alloc.allocate_zeroed(n);
+        }
+    };
+}
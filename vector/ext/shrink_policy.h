@@ -0,0 +1,107 @@
+//Automatic capacity shrinking with hysteresis
+//
+//A vector<T> keeps its largest buffer until shrink_to_fit or destruction, so one
+//that spiked once stays that big. vector<T, shrinking_allocator<T>> gives
+//capacity back by itself (vector_shrink_policy in vector.h): once size drops
+//below shrink_below of the capacity, it moves to a buffer of size * headroom.
+//
+//The two thresholds are the hysteresis. Right after a shrink the vector is
+//1 / headroom full, so it has to grow by a factor of headroom before it
+//reallocates up, and drop to shrink_below * headroom of its size before it
+//reallocates down; after doubling it is half full and has to lose
+//1 - 2 * shrink_below of its size. So every reallocation in either direction
+//is paid for by a number of operations in proportion to the size, as with
+//growth alone, and a size that hovers around a threshold does not reallocate
+//back and forth. The options must therefore
+//have shrink_below < 1/2 and shrink_below * headroom < 1 (the defaults 1/4 and
+//2 leave a factor of 2 on each side).
+//
+//Eager (the default) shrinks inside pop_back, erase, a shrinking resize and
+//clear. Lazy leaves those alone, so removing stays cheap and never allocates,
+//and shrinks at the end of the next push_back, emplace_back or growing resize
+//instead, when the vector is reallocating anyway or can afford to; a vector
+//that is drained and never refilled keeps its buffer until it is destroyed.
+//
+//Either way a shrink moves the elements, so it invalidates every iterator,
+//pointer and reference into the vector, not just those past the new end: in
+//eager mode a pop_back, erase, shrinking resize or clear can invalidate them
+//all, and in lazy mode so can a push_back or emplace_back that still fits in
+//the capacity, which a plain vector guarantees never does.
+//
+//    ext::shrinking_vector<order> book;                       //1/4, 2x
+//    ext::lazy_shrinking_vector<order> queue(ext::shrink_options{0.1, 4, 256});
+//
+//The memory is Base's (std::allocator by default); only the options are stored.
+#pragma once
+#include "../vector.h"
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+
+namespace ext{
+    struct shrink_options{
+        double shrink_below = 0.25;         //shrink when size < capacity * shrink_below
+        double headroom = 2.0;              //to a capacity of size * headroom
+        std::size_t min_capacity = 16;      //but never below this (0 frees an empty vector)
+    };
+
+    template<class T, bool Lazy = false, class Base = std::allocator<T>>
+    class shrinking_allocator : public Base{
+    public:
+        using value_type = T;
+
+        template<class U>
+        struct rebind{
+            using other = shrinking_allocator<U, Lazy, typename std::allocator_traits<Base>::template rebind_alloc<U>>;
+        };
+
+        shrinking_allocator() = default;
+
+        //throws std::invalid_argument for options that would reallocate back and forth
+        shrinking_allocator(shrink_options options) : m_options(options){
+            if(!(options.shrink_below > 0 && options.shrink_below < 0.5 && options.headroom > 1 && options.shrink_below * options.headroom < 1))
+                throw std::invalid_argument("shrinking_allocator: need 0 < shrink_below < 1/2, headroom > 1 and shrink_below * headroom < 1");
+        }
+
+        template<class U, class B>
+        shrinking_allocator(const shrinking_allocator<U, Lazy, B>& other) noexcept
+            : Base(static_cast<const B&>(other)), m_options(other.options()){}
+
+        [[nodiscard]] const shrink_options& options() const noexcept{ return m_options; }
+
+        //the buffer to move to, or capacity to keep the one there is
+        [[nodiscard]] std::size_t shrink_to(std::size_t size, std::size_t capacity) const noexcept{
+            if(static_cast<double>(size) >= static_cast<double>(capacity) * m_options.shrink_below) return capacity;
+            const double wanted = std::ceil(static_cast<double>(size) * m_options.headroom);
+            const std::size_t target = wanted < static_cast<double>(capacity) ? static_cast<std::size_t>(wanted) : capacity;
+            return target > m_options.min_capacity ? target : (m_options.min_capacity < capacity ? m_options.min_capacity : capacity);
+        }
+
+        //the options only steer the vector; the memory is Base's
+        friend bool operator==(const shrinking_allocator& a, const shrinking_allocator& b) noexcept{
+            return static_cast<const Base&>(a) == static_cast<const Base&>(b);
+        }
+
+    private:
+        shrink_options m_options;
+    };
+
+    template<class T>
+    using shrinking_vector = std::vector<T, shrinking_allocator<T>>;
+
+    template<class T>
+    using lazy_shrinking_vector = std::vector<T, shrinking_allocator<T, true>>;
+}
+
+namespace std{
+    template<class T, bool Lazy, class Base>
+    struct vector_shrink_policy<T, ext::shrinking_allocator<T, Lazy, Base>>{
+        static constexpr bool enabled = true;
+        static constexpr bool lazy = Lazy;
+
+        static size_t shrink_to(const ext::shrinking_allocator<T, Lazy, Base>& alloc, size_t size, size_t capacity) noexcept{
+            return alloc.shrink_to(size, capacity);
+        }
+    };
+}
@@ -0,0 +1,720 @@
+//SIMD search and reduction kernels for vector<T> of arithmetic T
+//
+//The generic algorithms (std::find, std::count, std::min_element, ...) walk the
+//vector through normal_iterator one element at a time, which the compiler rarely
+//turns into wide loads. The functions here take the vector itself, hand the raw
+//buffer to a kernel written with SSE4.1/AVX2/AVX-512 intrinsics and pick the
+//widest kernel the CPU supports at runtime. Element types without a kernel
+//(anything other than int, float, double and uint8_t) and non-x86 targets fall
+//back to the std algorithm, so the functions are always safe to call.
+//
+//Semantics match the std algorithm they replace:
+//  find/count/equal compare with ==, so NaN never matches and -0.0 == +0.0
+//  min_element/max_element return the first extreme element; if the range
+//  contains a NaN the kernel gives up and the std algorithm is used instead
+//  sum is the one exception: integral elements are summed into 64-bit lanes and
+//  floating point elements are reassociated across lanes, so a float sum may
+//  differ from a sequential std::accumulate in the last bits
+//
+//The second half of the file is stream compaction for erase_if/remove_if. An
+//arbitrary callable cannot be evaluated in SIMD lanes, so the kernels only run
+//for the comparison predicates built by equal_to, less, between, ... below;
+//std::erase_if recognises them through vector_remove_if_kernel in vector.h and
+//every other predicate keeps using std::remove_if.
+#pragma once
+#include "../vector.h"
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <numeric>
+#include <type_traits>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define EXT_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define EXT_SIMD_X86 0
+#endif
+
+namespace ext{
+namespace simd{
+    //instruction set levels, ordered from narrowest to widest
+    enum class isa { scalar, sse41, avx2, avx512 };
+
+    [[nodiscard]] inline const char* isa_name(isa level) noexcept{
+        switch(level){
+            case isa::sse41: return "sse4.1";
+            case isa::avx2: return "avx2";
+            case isa::avx512: return "avx512";
+            default: return "scalar";
+        }
+    }
+
+    //the widest level this CPU can execute
+    [[nodiscard]] inline isa supported_isa() noexcept{
+#if EXT_SIMD_X86
+        static const isa level = []{
+            __builtin_cpu_init();
+            if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) return isa::avx512;
+            if(__builtin_cpu_supports("avx2")) return isa::avx2;
+            if(__builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("popcnt")) return isa::sse41;
+            return isa::scalar;
+        }();
+        return level;
+#else
+        return isa::scalar;
+#endif
+    }
+
+    namespace detail{
+        //returned by the min/max kernels when they meet a NaN and the caller
+        //has to fall back to the std algorithm
+        inline constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+        inline std::atomic<isa>& active_level() noexcept{
+            static std::atomic<isa> level{supported_isa()};
+            return level;
+        }
+    }
+
+    //the level the kernels currently dispatch to
+    [[nodiscard]] inline isa active_isa() noexcept{
+        return detail::active_level().load(std::memory_order_relaxed);
+    }
+
+    //restrict dispatch to at most `level`, used by the benchmarks and tests to
+    //compare the kernels against each other. Requests above supported_isa() are clamped.
+    inline void set_isa(isa level) noexcept{
+        if(level > supported_isa()) level = supported_isa();
+        detail::active_level().store(level, std::memory_order_relaxed);
+    }
+
+    //element types with a dedicated kernel
+    template<class T>
+    inline constexpr bool has_kernel_v = std::is_same_v<T, std::int32_t> || std::is_same_v<T, float>
+                                       || std::is_same_v<T, double> || std::is_same_v<T, std::uint8_t>;
+
+    //the type sum() returns: 64-bit for integers, T itself for floating point
+    template<class T>
+    using sum_type = std::conditional_t<std::is_floating_point_v<T>, T,
+                     std::conditional_t<std::is_signed_v<T>, std::int64_t, std::uint64_t>>;
+
+    //comparisons the compaction kernels evaluate in SIMD lanes; an element x is
+    //removed when `x op a` holds (between: a <= x <= b, outside: x < a || b < x)
+    enum class cmp { eq, ne, lt, le, gt, ge, between, outside };
+
+    //a predicate the compaction kernels understand. It is an ordinary callable
+    //too, so std::erase_if and std::remove_if accept it for any element type;
+    //build one with equal_to, less, between, ... below.
+    template<cmp K, class T>
+    struct predicate{
+        T a;
+        T b{};
+
+        constexpr bool operator()(const T& x) const{
+            if constexpr(K == cmp::eq) return x == a;
+            else if constexpr(K == cmp::ne) return x != a;
+            else if constexpr(K == cmp::lt) return x < a;
+            else if constexpr(K == cmp::le) return x <= a;
+            else if constexpr(K == cmp::gt) return a < x;
+            else if constexpr(K == cmp::ge) return a <= x;
+            else if constexpr(K == cmp::between) return a <= x && x <= b;
+            else return x < a || b < x;
+        }
+    };
+
+    template<class T> constexpr predicate<cmp::eq, T> equal_to(T value){ return {value}; }
+    template<class T> constexpr predicate<cmp::ne, T> not_equal_to(T value){ return {value}; }
+    template<class T> constexpr predicate<cmp::lt, T> less(T value){ return {value}; }
+    template<class T> constexpr predicate<cmp::le, T> less_equal(T value){ return {value}; }
+    template<class T> constexpr predicate<cmp::gt, T> greater(T value){ return {value}; }
+    template<class T> constexpr predicate<cmp::ge, T> greater_equal(T value){ return {value}; }
+    template<class T> constexpr predicate<cmp::between, T> between(T lo, T hi){ return {lo, hi}; }
+    template<class T> constexpr predicate<cmp::outside, T> outside(T lo, T hi){ return {lo, hi}; }
+
+    namespace detail{
+        //shuffle controls for left-packing the lanes selected by a bitmask
+        struct compress_tables{
+            //byte8[m]: positions of the set bits of m, one per byte, for pshufb on 8 bytes
+            std::uint64_t byte8[256];
+            //lane4[m]: pshufb control moving the 32-bit lanes set in m (4 lanes) to the front
+            alignas(16) std::uint8_t lane4[16][16];
+            //lane8[m]: vpermd control moving the 32-bit lanes set in m (8 lanes) to the front
+            alignas(32) std::uint32_t lane8[256][8];
+            //widen[m]: m with every bit doubled, a 64-bit lane being two 32-bit lanes
+            std::uint8_t widen[16];
+        };
+
+        constexpr compress_tables make_compress_tables(){
+            compress_tables t{};
+            for(unsigned m = 0; m < 256; ++m){
+                unsigned k = 0;
+                for(unsigned bit = 0; bit < 8; ++bit){
+                    if(m & (1u << bit)){
+                        t.byte8[m] |= std::uint64_t(bit) << (8 * k);
+                        t.lane8[m][k] = bit;
+                        ++k;
+                    }
+                }
+            }
+            for(unsigned m = 0; m < 16; ++m){
+                unsigned k = 0;
+                for(unsigned lane = 0; lane < 4; ++lane){
+                    if(m & (1u << lane)){
+                        for(unsigned byte = 0; byte < 4; ++byte){
+                            t.lane4[m][4 * k + byte] = static_cast<std::uint8_t>(4 * lane + byte);
+                        }
+                        ++k;
+                    }
+                }
+            }
+            for(unsigned m = 0; m < 16; ++m){
+                for(unsigned bit = 0; bit < 4; ++bit){
+                    if(m & (1u << bit)) t.widen[m] |= static_cast<std::uint8_t>(3u << (2 * bit));
+                }
+            }
+            return t;
+        }
+
+        inline constexpr compress_tables compress_table = make_compress_tables();
+    }
+}
+}
+
+#if EXT_SIMD_X86
+//Each instruction set gets its own namespace holding an ops<T> table of the
+//intrinsics for that register width, followed by the shared kernels from
+//simd_algo.tcc. Everything in between the target push/pop is compiled for that
+//instruction set only; it is reached through the runtime dispatch below.
+#define EXT_SIMD_PRAGMA(x) _Pragma(#x)
+#if defined(__clang__)
+#define EXT_SIMD_TARGET_PUSH(t) EXT_SIMD_PRAGMA(clang attribute push(__attribute__((target(t))), apply_to = function))
+#define EXT_SIMD_TARGET_POP() EXT_SIMD_PRAGMA(clang attribute pop)
+#else
+#define EXT_SIMD_TARGET_PUSH(t) EXT_SIMD_PRAGMA(GCC push_options) EXT_SIMD_PRAGMA(GCC target(t))
+#define EXT_SIMD_TARGET_POP() EXT_SIMD_PRAGMA(GCC pop_options)
+#endif
+
+EXT_SIMD_TARGET_PUSH("sse4.1,popcnt")
+namespace ext::simd::detail::sse41{
+    template<class T> struct ops;
+
+    //left-pack the bytes of x selected by keep (16 bits) to dst, 8 bytes at a
+    //time; returns the number of bytes kept. Writes up to 16 bytes at dst.
+    inline std::size_t compress_bytes16(std::uint8_t* dst, __m128i x, std::uint32_t keep){
+        const std::uint32_t lo = keep & 0xFF, hi = (keep >> 8) & 0xFF;
+        __m128i packed_lo = _mm_shuffle_epi8(x, _mm_cvtsi64_si128(static_cast<long long>(compress_table.byte8[lo])));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), packed_lo);
+        dst += std::popcount(lo);
+        __m128i packed_hi = _mm_shuffle_epi8(_mm_srli_si128(x, 8), _mm_cvtsi64_si128(static_cast<long long>(compress_table.byte8[hi])));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), packed_hi);
+        return std::popcount(lo) + std::popcount(hi);
+    }
+
+    template<> struct ops<std::int32_t>{
+        using value_type = std::int32_t;
+        using reg = __m128i;
+        using acc = __m128i;
+        static constexpr std::size_t lanes = 4;
+        static reg load(const value_type* p){ return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+        static void store(value_type* p, reg r){ _mm_storeu_si128(reinterpret_cast<__m128i*>(p), r); }
+        static reg broadcast(value_type v){ return _mm_set1_epi32(v); }
+        static std::uint64_t eq(reg a, reg b){ return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b))); }
+        static std::uint64_t unordered(reg){ return 0; }
+        static reg min(reg a, reg b){ return _mm_min_epi32(a, b); }
+        static reg max(reg a, reg b){ return _mm_max_epi32(a, b); }
+        //widen to two 64-bit lanes so the sum cannot overflow
+        static acc acc_zero(){ return _mm_setzero_si128(); }
+        static acc accumulate(acc s, reg r){
+            s = _mm_add_epi64(s, _mm_cvtepi32_epi64(r));
+            return _mm_add_epi64(s, _mm_cvtepi32_epi64(_mm_srli_si128(r, 8)));
+        }
+        static std::int64_t reduce(acc s){ return _mm_cvtsi128_si64(s) + _mm_extract_epi64(s, 1); }
+        static std::uint64_t lt(reg a, reg b){ return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(a, b))); }
+        static std::uint64_t le(reg a, reg b){ return ~lt(b, a) & 0xF; }
+        static std::size_t compress_store(value_type* dst, reg x, std::uint64_t keep){
+            const __m128i ctrl = _mm_load_si128(reinterpret_cast<const __m128i*>(compress_table.lane4[keep]));
+            store(dst, _mm_shuffle_epi8(x, ctrl));
+            return std::popcount(keep);
+        }
+    };
+
+    template<> struct ops<float>{
+        using value_type = float;
+        using reg = __m128;
+        using acc = __m128;
+        static constexpr std::size_t lanes = 4;
+        static reg load(const value_type* p){ return _mm_loadu_ps(p); }
+        static void store(value_type* p, reg r){ _mm_storeu_ps(p, r); }
+        static reg broadcast(value_type v){ return _mm_set1_ps(v); }
+        static std::uint64_t eq(reg a, reg b){ return _mm_movemask_ps(_mm_cmpeq_ps(a, b)); }
+        static std::uint64_t unordered(reg a){ return _mm_movemask_ps(_mm_cmpunord_ps(a, a)); }
+        static reg min(reg a, reg b){ return _mm_min_ps(a, b); }
+        static reg max(reg a, reg b){ return _mm_max_ps(a, b); }
+        static acc acc_zero(){ return _mm_setzero_ps(); }
+        static acc accumulate(acc s, reg r){ return _mm_add_ps(s, r); }
+        static float reduce(acc s){
+            alignas(16) float lane[lanes];
+            _mm_store_ps(lane, s);
+            return (lane[0] + lane[1]) + (lane[2] + lane[3]);
+        }
+        static std::uint64_t lt(reg a, reg b){ return _mm_movemask_ps(_mm_cmplt_ps(a, b)); }
+        static std::uint64_t le(reg a, reg b){ return _mm_movemask_ps(_mm_cmple_ps(a, b)); }
+        static std::size_t compress_store(value_type* dst, reg x, std::uint64_t keep){
+            const __m128i ctrl = _mm_load_si128(reinterpret_cast<const __m128i*>(compress_table.lane4[keep]));
+            store(dst, _mm_castsi128_ps(_mm_shuffle_epi8(_mm_castps_si128(x), ctrl)));
+            return std::popcount(keep);
+        }
+    };
+
+    template<> struct ops<double>{
+        using value_type = double;
+        using reg = __m128d;
+        using acc = __m128d;
+        static constexpr std::size_t lanes = 2;
+        static reg load(const value_type* p){ return _mm_loadu_pd(p); }
+        static void store(value_type* p, reg r){ _mm_storeu_pd(p, r); }
+        static reg broadcast(value_type v){ return _mm_set1_pd(v); }
+        static std::uint64_t eq(reg a, reg b){ return _mm_movemask_pd(_mm_cmpeq_pd(a, b)); }
+        static std::uint64_t unordered(reg a){ return _mm_movemask_pd(_mm_cmpunord_pd(a, a)); }
+        static reg min(reg a, reg b){ return _mm_min_pd(a, b); }
+        static reg max(reg a, reg b){ return _mm_max_pd(a, b); }
+        static acc acc_zero(){ return _mm_setzero_pd(); }
+        static acc accumulate(acc s, reg r){ return _mm_add_pd(s, r); }
+        static double reduce(acc s){ return _mm_cvtsd_f64(s) + _mm_cvtsd_f64(_mm_unpackhi_pd(s, s)); }
+        static std::uint64_t lt(reg a, reg b){ return _mm_movemask_pd(_mm_cmplt_pd(a, b)); }
+        static std::uint64_t le(reg a, reg b){ return _mm_movemask_pd(_mm_cmple_pd(a, b)); }
+        static std::size_t compress_store(value_type* dst, reg x, std::uint64_t keep){
+            const __m128i ctrl = _mm_load_si128(reinterpret_cast<const __m128i*>(compress_table.lane4[compress_table.widen[keep]]));
+            store(dst, _mm_castsi128_pd(_mm_shuffle_epi8(_mm_castpd_si128(x), ctrl)));
+            return std::popcount(keep);
+        }
+    };
+
+    template<> struct ops<std::uint8_t>{
+        using value_type = std::uint8_t;
+        using reg = __m128i;
+        using acc = __m128i;
+        static constexpr std::size_t lanes = 16;
+        static reg load(const value_type* p){ return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+        static void store(value_type* p, reg r){ _mm_storeu_si128(reinterpret_cast<__m128i*>(p), r); }
+        static reg broadcast(value_type v){ return _mm_set1_epi8(static_cast<char>(v)); }
+        static std::uint64_t eq(reg a, reg b){ return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b))); }
+        static std::uint64_t unordered(reg){ return 0; }
+        static reg min(reg a, reg b){ return _mm_min_epu8(a, b); }
+        static reg max(reg a, reg b){ return _mm_max_epu8(a, b); }
+        //psadbw against zero sums each group of 8 bytes into a 64-bit lane
+        static acc acc_zero(){ return _mm_setzero_si128(); }
+        static acc accumulate(acc s, reg r){ return _mm_add_epi64(s, _mm_sad_epu8(r, _mm_setzero_si128())); }
+        static std::uint64_t reduce(acc s){ return static_cast<std::uint64_t>(_mm_cvtsi128_si64(s)) + static_cast<std::uint64_t>(_mm_extract_epi64(s, 1)); }
+        //no unsigned byte compare before AVX-512: a <= b exactly when min(a, b) == a
+        static std::uint64_t le(reg a, reg b){ return eq(_mm_min_epu8(a, b), a); }
+        static std::uint64_t lt(reg a, reg b){ return ~le(b, a) & 0xFFFF; }
+        static std::size_t compress_store(value_type* dst, reg x, std::uint64_t keep){
+            return compress_bytes16(dst, x, static_cast<std::uint32_t>(keep));
+        }
+    };
+
+#include "simd_algo.tcc"
+}
+EXT_SIMD_TARGET_POP()
+
+EXT_SIMD_TARGET_PUSH("avx2,popcnt")
+namespace ext::simd::detail::avx2{
+    template<class T> struct ops;
+
+    template<> struct ops<std::int32_t>{
+        using value_type = std::int32_t;
+        using reg = __m256i;
+        using acc = __m256i;
+        static constexpr std::size_t lanes = 8;
+        static reg load(const value_type* p){ return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+        static void store(value_type* p, reg r){ _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), r); }
+        static reg broadcast(value_type v){ return _mm256_set1_epi32(v); }
+        static std::uint64_t eq(reg a, reg b){ return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b))); }
+        static std::uint64_t unordered(reg){ return 0; }
+        static reg min(reg a, reg b){ return _mm256_min_epi32(a, b); }
+        static reg max(reg a, reg b){ return _mm256_max_epi32(a, b); }
+        static acc acc_zero(){ return _mm256_setzero_si256(); }
+        static acc accumulate(acc s, reg r){
+            s = _mm256_add_epi64(s, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(r)));
+            return _mm256_add_epi64(s, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(r, 1)));
+        }
+        static std::int64_t reduce(acc s){
+            alignas(32) std::int64_t lane[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lane), s);
+            return lane[0] + lane[1] + lane[2] + lane[3];
+        }
+        static std::uint64_t lt(reg a, reg b){ return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(b, a))); }
+        static std::uint64_t le(reg a, reg b){ return ~lt(b, a) & 0xFF; }
+        static std::size_t compress_store(value_type* dst, reg x, std::uint64_t keep){
+            const __m256i ctrl = _mm256_load_si256(reinterpret_cast<const __m256i*>(compress_table.lane8[keep]));
+            store(dst, _mm256_permutevar8x32_epi32(x, ctrl));
+            return std::popcount(keep);
+        }
+    };
+
+    template<> struct ops<float>{
+        using value_type = float;
+        using reg = __m256;
+        using acc = __m256;
+        static constexpr std::size_t lanes = 8;
+        static reg load(const value_type* p){ return _mm256_loadu_ps(p); }
+        static void store(value_type* p, reg r){ _mm256_storeu_ps(p, r); }
+        static reg broadcast(value_type v){ return _mm256_set1_ps(v); }
+        static std::uint64_t eq(reg a, reg b){ return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ)); }
+        static std::uint64_t unordered(reg a){ return _mm256_movemask_ps(_mm256_cmp_ps(a, a, _CMP_UNORD_Q)); }
+        static reg min(reg a, reg b){ return _mm256_min_ps(a, b); }
+        static reg max(reg a, reg b){ return _mm256_max_ps(a, b); }
+        static acc acc_zero(){ return _mm256_setzero_ps(); }
+        static acc accumulate(acc s, reg r){ return _mm256_add_ps(s, r); }
+        static float reduce(acc s){
+            __m128 half = _mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(s, 1));
+            alignas(16) float lane[4];
+            _mm_store_ps(lane, half);
+            return (lane[0] + lane[1]) + (lane[2] + lane[3]);
+        }
+        static std::uint64_t lt(reg a, reg b){ return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+        static std::uint64_t le(reg a, reg b){ return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LE_OQ)); }
+        static std::size_t compress_store(value_type* dst, reg x, std::uint64_t keep){
+            const __m256i ctrl = _mm256_load_si256(reinterpret_cast<const __m256i*>(compress_table.lane8[keep]));
+            store(dst, _mm256_permutevar8x32_ps(x, ctrl));
+            return std::popcount(keep);
+        }
+    };
+
+    template<> struct ops<double>{
+        using value_type = double;
+        using reg = __m256d;
+        using acc = __m256d;
+        static constexpr std::size_t lanes = 4;
+        static reg load(const value_type* p){ return _mm256_loadu_pd(p); }
+        static void store(value_type* p, reg r){ _mm256_storeu_pd(p, r); }
+        static reg broadcast(value_type v){ return _mm256_set1_pd(v); }
+        static std::uint64_t eq(reg a, reg b){ return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ)); }
+        static std::uint64_t unordered(reg a){ return _mm256_movemask_pd(_mm256_cmp_pd(a, a, _CMP_UNORD_Q)); }
+        static reg min(reg a, reg b){ return _mm256_min_pd(a, b); }
+        static reg max(reg a, reg b){ return _mm256_max_pd(a, b); }
+        static acc acc_zero(){ return _mm256_setzero_pd(); }
+        static acc accumulate(acc s, reg r){ return _mm256_add_pd(s, r); }
+        static double reduce(acc s){
+            __m128d half = _mm_add_pd(_mm256_castpd256_pd128(s), _mm256_extractf128_pd(s, 1));
+            return _mm_cvtsd_f64(half) + _mm_cvtsd_f64(_mm_unpackhi_pd(half, half));
+        }
+        static std::uint64_t lt(reg a, reg b){ return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_LT_OQ)); }
+        static std::uint64_t le(reg a, reg b){ return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_LE_OQ)); }
+        static std::size_t compress_store(value_type* dst, reg x, std::uint64_t keep){
+            const __m256i ctrl = _mm256_load_si256(reinterpret_cast<const __m256i*>(compress_table.lane8[compress_table.widen[keep]]));
+            store(dst, _mm256_castps_pd(_mm256_permutevar8x32_ps(_mm256_castpd_ps(x), ctrl)));
+            return std::popcount(keep);
+        }
+    };
+
+    template<> struct ops<std::uint8_t>{
+        using value_type = std::uint8_t;
+        using reg = __m256i;
+        using acc = __m256i;
+        static constexpr std::size_t lanes = 32;
+        static reg load(const value_type* p){ return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+        static void store(value_type* p, reg r){ _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), r); }
+        static reg broadcast(value_type v){ return _mm256_set1_epi8(static_cast<char>(v)); }
+        static std::uint64_t eq(reg a, reg b){ return static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b))); }
+        static std::uint64_t unordered(reg){ return 0; }
+        static reg min(reg a, reg b){ return _mm256_min_epu8(a, b); }
+        static reg max(reg a, reg b){ return _mm256_max_epu8(a, b); }
+        static acc acc_zero(){ return _mm256_setzero_si256(); }
+        static acc accumulate(acc s, reg r){ return _mm256_add_epi64(s, _mm256_sad_epu8(r, _mm256_setzero_si256())); }
+        static std::uint64_t reduce(acc s){
+            alignas(32) std::uint64_t lane[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lane), s);
+            return lane[0] + lane[1] + lane[2] + lane[3];
+        }
+        static std::uint64_t le(reg a, reg b){ return eq(_mm256_min_epu8(a, b), a); }
+        static std::uint64_t lt(reg a, reg b){ return ~le(b, a) & 0xFFFFFFFF; }
+        static std::size_t compress_store(value_type* dst, reg x, std::uint64_t keep){
+            std::size_t n = sse41::compress_bytes16(dst, _mm256_castsi256_si128(x), keep & 0xFFFF);
+            return n + sse41::compress_bytes16(dst + n, _mm256_extracti128_si256(x, 1), (keep >> 16) & 0xFFFF);
+        }
+    };
+
+#include "simd_algo.tcc"
+}
+EXT_SIMD_TARGET_POP()
+
+EXT_SIMD_TARGET_PUSH("avx512f,avx512bw,popcnt")
+namespace ext::simd::detail::avx512{
+    template<class T> struct ops;
+
+    //widen compare masks through a general register: GCC 12 at -O1 with
+    //-fsanitize=undefined can spill a __mmask16 with a 2-byte kmovw and reload
+    //it as 8 bytes, leaving garbage in the upper bits
+    template<class Mask>
+    inline std::uint64_t bits(Mask m){
+        std::uint64_t r = m;
+        asm("" : "+r"(r));
+        return r;
+    }
+
+    //GCC 12's unmasked min/max/shift/extract intrinsics pass _mm512_undefined_*()
+    //as the merge source, which -Wall reports as used uninitialized wherever they
+    //inline; the maskz forms with every lane selected are the same instructions
+    constexpr __mmask16 all16 = 0xFFFF;
+    constexpr __mmask8 all8 = 0xFF;
+    constexpr __mmask8 all4 = 0xF;
+
+    template<class T, std::size_t N, class Reg>
+    inline T sum_lanes(Reg r){
+        alignas(64) T lane[N];
+        std::memcpy(lane, &r, sizeof(r));
+        for(std::size_t n = N / 2; n > 0; n /= 2){
+            for(std::size_t i = 0; i < n; ++i) lane[i] += lane[i + n];
+        }
+        return lane[0];
+    }
+
+    template<> struct ops<std::int32_t>{
+        using value_type = std::int32_t;
+        using reg = __m512i;
+        using acc = __m512i;
+        static constexpr std::size_t lanes = 16;
+        static reg load(const value_type* p){ return _mm512_loadu_si512(p); }
+        static void store(value_type* p, reg r){ _mm512_storeu_si512(p, r); }
+        static reg broadcast(value_type v){ return _mm512_set1_epi32(v); }
+        static std::uint64_t eq(reg a, reg b){ return bits(_mm512_cmpeq_epi32_mask(a, b)); }
+        static std::uint64_t unordered(reg){ return 0; }
+        static reg min(reg a, reg b){ return _mm512_maskz_min_epi32(all16, a, b); }
+        static reg max(reg a, reg b){ return _mm512_maskz_max_epi32(all16, a, b); }
+        static acc acc_zero(){ return _mm512_setzero_si512(); }
+        static acc accumulate(acc s, reg r){
+            //sign-extend the even and the odd 32-bit lanes in place
+            s = _mm512_add_epi64(s, _mm512_maskz_srai_epi64(all8, _mm512_maskz_slli_epi64(all8, r, 32), 32));
+            return _mm512_add_epi64(s, _mm512_maskz_srai_epi64(all8, r, 32));
+        }
+        static std::int64_t reduce(acc s){ return sum_lanes<std::int64_t, 8>(s); }
+        static std::uint64_t lt(reg a, reg b){ return bits(_mm512_cmplt_epi32_mask(a, b)); }
+        static std::uint64_t le(reg a, reg b){ return bits(_mm512_cmple_epi32_mask(a, b)); }
+        static std::size_t compress_store(value_type* dst, reg x, std::uint64_t keep){
+            //compress in a register and store the whole vector: vpcompressd to memory is slow on some cores
+            store(dst, _mm512_maskz_compress_epi32(static_cast<__mmask16>(keep), x));
+            return std::popcount(keep);
+        }
+    };
+
+    template<> struct ops<float>{
+        using value_type = float;
+        using reg = __m512;
+        using acc = __m512;
+        static constexpr std::size_t lanes = 16;
+        static reg load(const value_type* p){ return _mm512_loadu_ps(p); }
+        static void store(value_type* p, reg r){ _mm512_storeu_ps(p, r); }
+        static reg broadcast(value_type v){ return _mm512_set1_ps(v); }
+        static std::uint64_t eq(reg a, reg b){ return bits(_mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ)); }
+        static std::uint64_t unordered(reg a){ return bits(_mm512_cmp_ps_mask(a, a, _CMP_UNORD_Q)); }
+        static reg min(reg a, reg b){ return _mm512_maskz_min_ps(all16, a, b); }
+        static reg max(reg a, reg b){ return _mm512_maskz_max_ps(all16, a, b); }
+        static acc acc_zero(){ return _mm512_setzero_ps(); }
+        static acc accumulate(acc s, reg r){ return _mm512_add_ps(s, r); }
+        static float reduce(acc s){ return sum_lanes<float, 16>(s); }
+        static std::uint64_t lt(reg a, reg b){ return bits(_mm512_cmp_ps_mask(a, b, _CMP_LT_OQ)); }
+        static std::uint64_t le(reg a, reg b){ return bits(_mm512_cmp_ps_mask(a, b, _CMP_LE_OQ)); }
+        static std::size_t compress_store(value_type* dst, reg x, std::uint64_t keep){
+            store(dst, _mm512_maskz_compress_ps(static_cast<__mmask16>(keep), x));
+            return std::popcount(keep);
+        }
+    };
+
+    template<> struct ops<double>{
+        using value_type = double;
+        using reg = __m512d;
+        using acc = __m512d;
+        static constexpr std::size_t lanes = 8;
+        static reg load(const value_type* p){ return _mm512_loadu_pd(p); }
+        static void store(value_type* p, reg r){ _mm512_storeu_pd(p, r); }
+        static reg broadcast(value_type v){ return _mm512_set1_pd(v); }
+        static std::uint64_t eq(reg a, reg b){ return bits(_mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ)); }
+        static std::uint64_t unordered(reg a){ return bits(_mm512_cmp_pd_mask(a, a, _CMP_UNORD_Q)); }
+        static reg min(reg a, reg b){ return _mm512_maskz_min_pd(all8, a, b); }
+        static reg max(reg a, reg b){ return _mm512_maskz_max_pd(all8, a, b); }
+        static acc acc_zero(){ return _mm512_setzero_pd(); }
+        static acc accumulate(acc s, reg r){ return _mm512_add_pd(s, r); }
+        static double reduce(acc s){ return sum_lanes<double, 8>(s); }
+        static std::uint64_t lt(reg a, reg b){ return bits(_mm512_cmp_pd_mask(a, b, _CMP_LT_OQ)); }
+        static std::uint64_t le(reg a, reg b){ return bits(_mm512_cmp_pd_mask(a, b, _CMP_LE_OQ)); }
+        static std::size_t compress_store(value_type* dst, reg x, std::uint64_t keep){
+            store(dst, _mm512_maskz_compress_pd(static_cast<__mmask8>(keep), x));
+            return std::popcount(keep);
+        }
+    };
+
+    template<> struct ops<std::uint8_t>{
+        using value_type = std::uint8_t;
+        using reg = __m512i;
+        using acc = __m512i;
+        static constexpr std::size_t lanes = 64;
+        static reg load(const value_type* p){ return _mm512_loadu_si512(p); }
+        static void store(value_type* p, reg r){ _mm512_storeu_si512(p, r); }
+        static reg broadcast(value_type v){ return _mm512_set1_epi8(static_cast<char>(v)); }
+        static std::uint64_t eq(reg a, reg b){ return bits(_mm512_cmpeq_epi8_mask(a, b)); }
+        static std::uint64_t unordered(reg){ return 0; }
+        static reg min(reg a, reg b){ return _mm512_min_epu8(a, b); }
+        static reg max(reg a, reg b){ return _mm512_max_epu8(a, b); }
+        static acc acc_zero(){ return _mm512_setzero_si512(); }
+        static acc accumulate(acc s, reg r){ return _mm512_add_epi64(s, _mm512_sad_epu8(r, _mm512_setzero_si512())); }
+        static std::uint64_t reduce(acc s){ return sum_lanes<std::uint64_t, 8>(s); }
+        static std::uint64_t lt(reg a, reg b){ return bits(_mm512_cmplt_epu8_mask(a, b)); }
+        static std::uint64_t le(reg a, reg b){ return bits(_mm512_cmple_epu8_mask(a, b)); }
+        //byte compress needs VBMI2, so pack each 128-bit quarter with pshufb instead
+        static std::size_t compress_store(value_type* dst, reg x, std::uint64_t keep){
+            std::size_t n = sse41::compress_bytes16(dst, _mm512_maskz_extracti32x4_epi32(all4, x, 0), keep & 0xFFFF);
+            n += sse41::compress_bytes16(dst + n, _mm512_maskz_extracti32x4_epi32(all4, x, 1), (keep >> 16) & 0xFFFF);
+            n += sse41::compress_bytes16(dst + n, _mm512_maskz_extracti32x4_epi32(all4, x, 2), (keep >> 32) & 0xFFFF);
+            return n + sse41::compress_bytes16(dst + n, _mm512_maskz_extracti32x4_epi32(all4, x, 3), (keep >> 48) & 0xFFFF);
+        }
+    };
+
+#include "simd_algo.tcc"
+}
+EXT_SIMD_TARGET_POP()
+#endif
+
+namespace ext{
+namespace simd{
+    namespace detail{
+        //run `kernel` with the kernel table of the active instruction set, or
+        //`fallback` when there is no kernel for T or no usable SIMD level.
+        //The kernel tables only expose static members, so the lambdas call
+        //them through the object they are handed.
+        template<class T, class Kernel, class Fallback>
+        inline auto dispatch(Kernel kernel, Fallback fallback){
+#if EXT_SIMD_X86
+            if constexpr(has_kernel_v<T>){
+                switch(active_isa()){
+                    case isa::avx512: return kernel(avx512::kernels{});
+                    case isa::avx2: return kernel(avx2::kernels{});
+                    case isa::sse41: return kernel(sse41::kernels{});
+                    default: break;
+                }
+            }
+#endif
+            return fallback();
+        }
+    }
+
+    //find: iterator to the first element == value, or end()
+    template<class T, class A>
+    [[nodiscard]] typename std::vector<T, A>::const_iterator find(const std::vector<T, A>& v, const T& value){
+        return detail::dispatch<T>(
+            [&](auto k){ return v.begin() + k.find(v.data(), v.size(), value); },
+            [&]{ return std::find(v.begin(), v.end(), value); });
+    }
+
+    template<class T, class A>
+    [[nodiscard]] typename std::vector<T, A>::iterator find(std::vector<T, A>& v, const T& value){
+        const auto& cv = v;
+        return v.begin() + (simd::find(cv, value) - cv.begin());
+    }
+
+    //count: number of elements == value
+    template<class T, class A>
+    [[nodiscard]] typename std::vector<T, A>::size_type count(const std::vector<T, A>& v, const T& value){
+        return detail::dispatch<T>(
+            [&](auto k){ return k.count(v.data(), v.size(), value); },
+            [&]{ return static_cast<typename std::vector<T, A>::size_type>(std::count(v.begin(), v.end(), value)); });
+    }
+
+    //min_element/max_element: iterator to the first smallest/largest element, end() if empty
+    template<class T, class A>
+    [[nodiscard]] typename std::vector<T, A>::const_iterator min_element(const std::vector<T, A>& v){
+        return detail::dispatch<T>(
+            [&](auto k){
+                std::size_t idx = k.min_index(v.data(), v.size());
+                return idx == detail::npos ? std::min_element(v.begin(), v.end()) : v.begin() + idx;
+            },
+            [&]{ return std::min_element(v.begin(), v.end()); });
+    }
+
+    template<class T, class A>
+    [[nodiscard]] typename std::vector<T, A>::const_iterator max_element(const std::vector<T, A>& v){
+        return detail::dispatch<T>(
+            [&](auto k){
+                std::size_t idx = k.max_index(v.data(), v.size());
+                return idx == detail::npos ? std::max_element(v.begin(), v.end()) : v.begin() + idx;
+            },
+            [&]{ return std::max_element(v.begin(), v.end()); });
+    }
+
+    template<class T, class A>
+    [[nodiscard]] typename std::vector<T, A>::iterator min_element(std::vector<T, A>& v){
+        const auto& cv = v;
+        return v.begin() + (simd::min_element(cv) - cv.begin());
+    }
+
+    template<class T, class A>
+    [[nodiscard]] typename std::vector<T, A>::iterator max_element(std::vector<T, A>& v){
+        const auto& cv = v;
+        return v.begin() + (simd::max_element(cv) - cv.begin());
+    }
+
+    //sum of all elements, see the note at the top of the file about sum_type and rounding
+    template<class T, class A> requires std::is_arithmetic_v<T>
+    [[nodiscard]] sum_type<T> sum(const std::vector<T, A>& v){
+        return detail::dispatch<T>(
+            [&](auto k){ return static_cast<sum_type<T>>(k.sum(v.data(), v.size())); },
+            [&]{ return std::accumulate(v.begin(), v.end(), sum_type<T>{}); });
+    }
+
+    //equal: same size and pairwise ==
+    template<class T, class A1, class A2>
+    [[nodiscard]] bool equal(const std::vector<T, A1>& lhs, const std::vector<T, A2>& rhs){
+        if(lhs.size() != rhs.size()) return false;
+        return detail::dispatch<T>(
+            [&](auto k){ return k.equal(lhs.data(), rhs.data(), lhs.size()); },
+            [&]{ return std::equal(lhs.begin(), lhs.end(), rhs.begin()); });
+    }
+    //remove_if/remove: compact the kept elements to the front like std::remove_if
+    //and return the new logical end; the vector keeps its size
+    template<class T, class A, cmp K, class U>
+    typename std::vector<T, A>::iterator remove_if(std::vector<T, A>& v, const predicate<K, U>& pred){
+        if constexpr(std::is_same_v<T, U>){
+            return detail::dispatch<T>(
+                [&](auto k){ return v.begin() + k.remove_if(v.data(), v.size(), pred); },
+                [&]{ return std::remove_if(v.begin(), v.end(), pred); });
+        }
+        else{
+            return std::remove_if(v.begin(), v.end(), pred);
+        }
+    }
+
+    template<class T, class A>
+    typename std::vector<T, A>::iterator remove(std::vector<T, A>& v, const T& value){
+        return simd::remove_if(v, equal_to(value));
+    }
+
+    //erase_if/erase: the same as std::erase_if/std::erase. std::erase_if picks up
+    //the kernels by itself when handed one of the predicates above; std::erase
+    //compares with an arbitrary U and always stays scalar, use these instead.
+    template<class T, class A, class Pred>
+    typename std::vector<T, A>::size_type erase_if(std::vector<T, A>& v, Pred pred){
+        return std::erase_if(v, pred);
+    }
+
+    template<class T, class A>
+    typename std::vector<T, A>::size_type erase(std::vector<T, A>& v, const T& value){
+        return std::erase_if(v, equal_to(value));
+    }
+}
+}
+
+//route std::erase_if through the compaction kernels for the predicates above
+template<class T, ext::simd::cmp K, class U>
+struct std::vector_remove_if_kernel<T, ext::simd::predicate<K, U>>{
+    static constexpr bool enabled = ext::simd::has_kernel_v<T> && std::is_same_v<T, U>;
+
+    static std::size_t remove_if(T* first, std::size_t n, const ext::simd::predicate<K, U>& pred){
+        return ext::simd::detail::dispatch<T>(
+            [&](auto k){ return k.remove_if(first, n, pred); },
+            [&]{ return static_cast<std::size_t>(std::remove_if(first, first + n, pred) - first); });
+    }
+};
@@ -0,0 +1,176 @@
+//Kernels shared by every instruction set in simd_algo.h
+//
+//This file has no include guard on purpose: simd_algo.h includes it once inside
+//each of its per-ISA namespaces, after that namespace's ops<T> table, so the same
+//loops get compiled against 128-, 256- and 512-bit registers.
+//
+//ops<T> provides: lanes, reg, acc, load, store, broadcast, eq, lt, le and
+//unordered (bitmask with one bit per lane), min, max, acc_zero, accumulate,
+//reduce and compress_store (left-pack the lanes of a bitmask, return how many).
+
+struct kernels{
+    template<class Ops>
+    static constexpr std::uint64_t full_mask = Ops::lanes == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << Ops::lanes) - 1;
+
+    //index of the first element == value, n if there is none
+    template<class T>
+    static std::size_t find(const T* p, std::size_t n, T value){
+        using O = ops<T>;
+        const typename O::reg needle = O::broadcast(value);
+        std::size_t i = 0;
+        //four registers per iteration, the masks are only inspected once one of them hits
+        for(; i + 4 * O::lanes <= n; i += 4 * O::lanes){
+            std::uint64_t m0 = O::eq(O::load(p + i), needle);
+            std::uint64_t m1 = O::eq(O::load(p + i + O::lanes), needle);
+            std::uint64_t m2 = O::eq(O::load(p + i + 2 * O::lanes), needle);
+            std::uint64_t m3 = O::eq(O::load(p + i + 3 * O::lanes), needle);
+            if(m0 | m1 | m2 | m3){
+                if(m0) return i + std::countr_zero(m0);
+                if(m1) return i + O::lanes + std::countr_zero(m1);
+                if(m2) return i + 2 * O::lanes + std::countr_zero(m2);
+                return i + 3 * O::lanes + std::countr_zero(m3);
+            }
+        }
+        for(; i + O::lanes <= n; i += O::lanes){
+            std::uint64_t m = O::eq(O::load(p + i), needle);
+            if(m) return i + std::countr_zero(m);
+        }
+        for(; i < n; ++i){
+            if(p[i] == value) return i;
+        }
+        return n;
+    }
+
+    template<class T>
+    static std::size_t count(const T* p, std::size_t n, T value){
+        using O = ops<T>;
+        const typename O::reg needle = O::broadcast(value);
+        std::size_t result = 0;
+        std::size_t i = 0;
+        for(; i + O::lanes <= n; i += O::lanes){
+            result += std::popcount(O::eq(O::load(p + i), needle));
+        }
+        for(; i < n; ++i){
+            result += (p[i] == value);
+        }
+        return result;
+    }
+
+    //shared body of min_index and max_index: reduce to the extreme value, then
+    //find its first occurrence so ties resolve the same way as the std algorithms.
+    //Returns npos if a NaN is seen, since min/max instructions do not order NaN the way < does.
+    //(No lambdas here: they would not inherit the target of the enclosing region.)
+    template<bool Max, class T>
+    static std::size_t extreme_index(const T* p, std::size_t n){
+        using O = ops<T>;
+        if(n == 0) return 0;
+        std::size_t i = 0;
+        std::uint64_t nan = 0;
+        T best = p[0];
+        if(n >= O::lanes){
+            typename O::reg acc = O::load(p);
+            nan |= O::unordered(acc);
+            for(i = O::lanes; i + O::lanes <= n; i += O::lanes){
+                typename O::reg x = O::load(p + i);
+                nan |= O::unordered(x);
+                if constexpr(Max) acc = O::max(acc, x);
+                else acc = O::min(acc, x);
+            }
+            if(nan) return npos;
+            alignas(64) T lane[O::lanes];
+            O::store(lane, acc);
+            best = lane[0];
+            for(std::size_t l = 1; l < O::lanes; ++l){
+                if(Max ? best < lane[l] : lane[l] < best) best = lane[l];
+            }
+        }
+        for(; i < n; ++i){
+            if(p[i] != p[i]) return npos;
+            if(Max ? best < p[i] : p[i] < best) best = p[i];
+        }
+        return find(p, n, best);
+    }
+
+    template<class T>
+    static std::size_t min_index(const T* p, std::size_t n){
+        return extreme_index<false>(p, n);
+    }
+
+    template<class T>
+    static std::size_t max_index(const T* p, std::size_t n){
+        return extreme_index<true>(p, n);
+    }
+
+    template<class T>
+    static auto sum(const T* p, std::size_t n){
+        using O = ops<T>;
+        //two independent accumulators hide the add latency
+        typename O::acc s0 = O::acc_zero();
+        typename O::acc s1 = O::acc_zero();
+        std::size_t i = 0;
+        for(; i + 2 * O::lanes <= n; i += 2 * O::lanes){
+            s0 = O::accumulate(s0, O::load(p + i));
+            s1 = O::accumulate(s1, O::load(p + i + O::lanes));
+        }
+        for(; i + O::lanes <= n; i += O::lanes){
+            s0 = O::accumulate(s0, O::load(p + i));
+        }
+        auto result = O::reduce(s0) + O::reduce(s1);
+        for(; i < n; ++i){
+            result += p[i];
+        }
+        return result;
+    }
+
+    template<class T>
+    static bool equal(const T* a, const T* b, std::size_t n){
+        using O = ops<T>;
+        std::size_t i = 0;
+        for(; i + O::lanes <= n; i += O::lanes){
+            if(O::eq(O::load(a + i), O::load(b + i)) != full_mask<O>) return false;
+        }
+        for(; i < n; ++i){
+            if(!(a[i] == b[i])) return false;
+        }
+        return true;
+    }
+
+    //bitmask of the lanes of x that the predicate `K` with operands va, vb removes
+    template<cmp K, class O>
+    static std::uint64_t match(typename O::reg x, typename O::reg va, typename O::reg vb){
+        if constexpr(K == cmp::eq) return O::eq(x, va);
+        else if constexpr(K == cmp::ne) return ~O::eq(x, va) & full_mask<O>;
+        else if constexpr(K == cmp::lt) return O::lt(x, va);
+        else if constexpr(K == cmp::le) return O::le(x, va);
+        else if constexpr(K == cmp::gt) return O::lt(va, x);
+        else if constexpr(K == cmp::ge) return O::le(va, x);
+        else if constexpr(K == cmp::between) return O::le(va, x) & O::le(x, vb);
+        else return O::lt(x, va) | O::lt(vb, x);
+    }
+
+    //stream compaction: move the elements the predicate keeps to the front of
+    //p[0, n) in order and return how many there are. Works in place: the write
+    //position never passes the read position, so a full-width store at the write
+    //position only overwrites lanes that have already been loaded.
+    template<cmp K, class T>
+    static std::size_t remove_if(T* p, std::size_t n, const predicate<K, T>& pred){
+        using O = ops<T>;
+        const typename O::reg va = O::broadcast(pred.a);
+        const typename O::reg vb = O::broadcast(pred.b);
+        std::size_t i = 0;
+        //nothing has to move until the first removal
+        for(; i + O::lanes <= n; i += O::lanes){
+            if(match<K, O>(O::load(p + i), va, vb)) break;
+        }
+        std::size_t w = i;
+        for(; i + O::lanes <= n; i += O::lanes){
+            //branch-free: testing for "nothing dropped" mispredicts at mid selectivity
+            typename O::reg x = O::load(p + i);
+            w += O::compress_store(p + w, x, ~match<K, O>(x, va, vb) & full_mask<O>);
+        }
+        for(; i < n; ++i){
+            if(!pred(p[i])) p[w++] = p[i];
+        }
+        return w;
+    }
+};
@@ -0,0 +1,379 @@
+//Binary snapshots of vector<T> for trivially copyable T
+//
+//A snapshot file is a fixed 64-byte header followed by the raw element bytes:
+//
+//  offset  size  field
+//       0     8  magic "VECSNAP\0"
+//       8     4  format version (snapshot_version)
+//      12     4  byte order marker, 0x01020304 as written by the producer
+//      16     8  type tag (snapshot_type_tag<T>, 0 = untagged)
+//      24     4  sizeof(T)
+//      28     4  alignof(T)
+//      32     8  element count
+//      40     8  offset of the first element, a multiple of max(64, alignof(T))
+//      48     4  CRC32C of the element bytes
+//      52     4  CRC32C of the header bytes with this field zeroed
+//      56     8  reserved, zero
+//
+//save_snapshot writes header and payload with one writev. load_snapshot reads the
+//payload with one read straight into the vector's uninitialised capacity (through
+//resize_and_overwrite, so nothing is value-initialised first). map_snapshot maps
+//the file and returns a read-only snapshot_view over it without copying at all.
+//Reads and writes only loop when the kernel returns short, which Linux does for
+//transfers above ~2 GiB.
+//
+//Errors: I/O failures throw std::system_error with the errno, files that are not a
+//valid snapshot for T throw snapshot_error.
+#pragma once
+#include "../vector.h"
+#include "posix_fd.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define EXT_SNAPSHOT_HW_CRC 1
+#else
+#define EXT_SNAPSHOT_HW_CRC 0
+#endif
+
+namespace ext{
+    inline constexpr std::uint32_t snapshot_version = 1;
+
+    class snapshot_error : public std::runtime_error{
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    //Identifies the element type in the header so a file of float is not loaded
+    //as int. Arithmetic types get a tag from their kind and size; specialize this
+    //for your own trivially copyable types, otherwise only size and alignment are checked.
+    template<class T>
+    struct snapshot_type_tag{
+        static constexpr std::uint64_t value = [] {
+            if constexpr(std::is_floating_point_v<T>) return std::uint64_t(0x3000) | sizeof(T);
+            else if constexpr(std::is_integral_v<T> && std::is_signed_v<T>) return std::uint64_t(0x1000) | sizeof(T);
+            else if constexpr(std::is_integral_v<T>) return std::uint64_t(0x2000) | sizeof(T);
+            else return std::uint64_t(0);
+        }();
+    };
+
+    struct snapshot_header{
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byte_order;
+        std::uint64_t type_tag;
+        std::uint32_t element_size;
+        std::uint32_t element_align;
+        std::uint64_t count;
+        std::uint64_t data_offset;
+        std::uint32_t checksum;
+        std::uint32_t header_checksum;
+        std::uint64_t reserved;
+    };
+    static_assert(sizeof(snapshot_header) == 64, "snapshot header must stay 64 bytes");
+
+    namespace detail{
+        inline constexpr char snapshot_magic[8] = {'V', 'E', 'C', 'S', 'N', 'A', 'P', '\0'};
+        inline constexpr std::uint32_t snapshot_byte_order = 0x01020304;
+
+        //CRC32C (Castagnoli), software slicing-by-8 tables
+        struct crc32c_tables{
+            std::uint32_t t[8][256];
+        };
+
+        constexpr crc32c_tables make_crc32c_tables(){
+            crc32c_tables tab{};
+            for(std::uint32_t i = 0; i < 256; ++i){
+                std::uint32_t c = i;
+                for(int k = 0; k < 8; ++k) c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+                tab.t[0][i] = c;
+            }
+            for(std::uint32_t i = 0; i < 256; ++i){
+                for(int s = 1; s < 8; ++s){
+                    tab.t[s][i] = (tab.t[s - 1][i] >> 8) ^ tab.t[0][tab.t[s - 1][i] & 0xFF];
+                }
+            }
+            return tab;
+        }
+
+        inline constexpr crc32c_tables crc32c_table = make_crc32c_tables();
+
+        inline std::uint32_t crc32c_sw(std::uint32_t crc, const unsigned char* p, std::size_t n){
+            const auto& t = crc32c_table.t;
+            for(; n >= 8; p += 8, n -= 8){
+                std::uint64_t word;
+                std::memcpy(&word, p, 8);
+                word ^= crc;
+                crc = t[7][word & 0xFF] ^ t[6][(word >> 8) & 0xFF] ^ t[5][(word >> 16) & 0xFF] ^ t[4][(word >> 24) & 0xFF]
+                    ^ t[3][(word >> 32) & 0xFF] ^ t[2][(word >> 40) & 0xFF] ^ t[1][(word >> 48) & 0xFF] ^ t[0][word >> 56];
+            }
+            for(; n > 0; ++p, --n) crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xFF];
+            return crc;
+        }
+
+#if EXT_SNAPSHOT_HW_CRC
+        __attribute__((target("sse4.2")))
+        inline std::uint32_t crc32c_hw(std::uint32_t crc, const unsigned char* p, std::size_t n){
+            std::uint64_t c = crc;
+            for(; n >= 8; p += 8, n -= 8){
+                std::uint64_t word;
+                std::memcpy(&word, p, 8);
+                c = _mm_crc32_u64(c, word);
+            }
+            for(; n > 0; ++p, --n) c = _mm_crc32_u8(static_cast<std::uint32_t>(c), *p);
+            return static_cast<std::uint32_t>(c);
+        }
+#endif
+
+        inline std::uint32_t crc32c(const void* data, std::size_t n){
+            const unsigned char* p = static_cast<const unsigned char*>(data);
+#if EXT_SNAPSHOT_HW_CRC
+            static const bool hw = [] { __builtin_cpu_init(); return __builtin_cpu_supports("sse4.2") != 0; }();
+            if(hw) return ~crc32c_hw(~0u, p, n);
+#endif
+            return ~crc32c_sw(~0u, p, n);
+        }
+
+        inline void pread_full(int fd, void* buf, std::size_t n, off_t offset){
+            char* p = static_cast<char*>(buf);
+            while(n > 0){
+                ssize_t got = ::pread(fd, p, n, offset);
+                if(got < 0){
+                    if(errno == EINTR) continue;
+                    throw_errno("snapshot: read");
+                }
+                if(got == 0) throw snapshot_error("snapshot: file is truncated");
+                p += got;
+                n -= static_cast<std::size_t>(got);
+                offset += got;
+            }
+        }
+
+        constexpr std::uint64_t snapshot_data_offset(std::size_t align){
+            std::uint64_t a = align > 64 ? align : 64;
+            return (sizeof(snapshot_header) + a - 1) / a * a;
+        }
+
+        template<class T>
+        snapshot_header make_snapshot_header(const T* data, std::size_t count){
+            snapshot_header h{};
+            std::memcpy(h.magic, snapshot_magic, sizeof(h.magic));
+            h.version = snapshot_version;
+            h.byte_order = snapshot_byte_order;
+            h.type_tag = snapshot_type_tag<T>::value;
+            h.element_size = sizeof(T);
+            h.element_align = alignof(T);
+            h.count = count;
+            h.data_offset = snapshot_data_offset(alignof(T));
+            h.checksum = crc32c(data, count * sizeof(T));
+            h.header_checksum = crc32c(&h, sizeof(h));
+            return h;
+        }
+
+        //check everything in the header against T; the payload checksum is checked by the caller
+        template<class T>
+        void check_snapshot_header(snapshot_header h, std::uint64_t file_size){
+            if(std::memcmp(h.magic, snapshot_magic, sizeof(h.magic)) != 0) throw snapshot_error("snapshot: bad magic");
+            std::uint32_t stored = h.header_checksum;
+            h.header_checksum = 0;
+            if(crc32c(&h, sizeof(h)) != stored) throw snapshot_error("snapshot: header checksum mismatch");
+            if(h.version != snapshot_version) throw snapshot_error("snapshot: unsupported version " + std::to_string(h.version));
+            if(h.byte_order != snapshot_byte_order) throw snapshot_error("snapshot: written with a different byte order");
+            if(h.type_tag != snapshot_type_tag<T>::value) throw snapshot_error("snapshot: element type tag mismatch");
+            if(h.element_size != sizeof(T) || h.element_align != alignof(T)) throw snapshot_error("snapshot: element size or alignment mismatch");
+            if(h.data_offset < sizeof(snapshot_header) || h.data_offset % alignof(T) != 0) throw snapshot_error("snapshot: bad data offset");
+            if(h.data_offset > file_size || h.count > (file_size - h.data_offset) / sizeof(T)) throw snapshot_error("snapshot: file is truncated");
+        }
+
+        inline std::uint64_t file_size(int fd){
+            struct stat st;
+            if(::fstat(fd, &st) != 0) throw_errno("snapshot: fstat");
+            return static_cast<std::uint64_t>(st.st_size);
+        }
+    }
+
+    //write v to fd at its current position: header, padding and payload in one writev
+    template<class T, class A>
+        requires std::is_trivially_copyable_v<T>
+    void save_snapshot(const std::vector<T, A>& v, int fd){
+        static_assert(alignof(T) <= 4096, "snapshot: over-aligned element types are not supported");
+        snapshot_header h = detail::make_snapshot_header(v.data(), v.size());
+        static const char zeros[4096] = {};
+        const std::size_t pad = h.data_offset - sizeof(h);
+        iovec iov[3] = {
+            {&h, sizeof(h)},
+            {const_cast<char*>(zeros), pad},
+            {const_cast<T*>(v.data()), v.size() * sizeof(T)},
+        };
+        int first = 0;
+        while(first < 3){
+            ssize_t put = ::writev(fd, iov + first, 3 - first);
+            if(put < 0){
+                if(errno == EINTR) continue;
+                detail::throw_errno("snapshot: write");
+            }
+            //advance past what was written after a short write
+            std::size_t left = static_cast<std::size_t>(put);
+            while(first < 3 && left >= iov[first].iov_len){
+                left -= iov[first].iov_len;
+                ++first;
+            }
+            if(first < 3){
+                iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + left;
+                iov[first].iov_len -= left;
+            }
+        }
+    }
+
+    //create or truncate path and write v to it
+    template<class T, class A>
+        requires std::is_trivially_copyable_v<T>
+    void save_snapshot(const std::vector<T, A>& v, const char* path){
+        detail::unique_fd f(::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+        if(f.fd < 0) detail::throw_errno("snapshot: open");
+        save_snapshot(v, f.fd);
+    }
+
+    //replace the contents of v with the snapshot in fd (read from offset 0).
+    //The payload lands in v's uninitialised capacity with a single read. On any
+    //error v is left empty.
+    template<class T, class A>
+        requires std::is_trivially_copyable_v<T>
+    void load_snapshot(std::vector<T, A>& v, int fd, bool verify_checksum = true){
+        snapshot_header h;
+        detail::pread_full(fd, &h, sizeof(h), 0);
+        detail::check_snapshot_header<T>(h, detail::file_size(fd));
+        v.clear();
+        v.resize_and_overwrite(h.count, [&](T* p, std::size_t n){
+            detail::pread_full(fd, p, n * sizeof(T), static_cast<off_t>(h.data_offset));
+            return n;
+        });
+        if(verify_checksum && detail::crc32c(v.data(), v.size() * sizeof(T)) != h.checksum){
+            v.clear();
+            throw snapshot_error("snapshot: payload checksum mismatch");
+        }
+    }
+
+    template<class T, class A>
+        requires std::is_trivially_copyable_v<T>
+    void load_snapshot(std::vector<T, A>& v, const char* path, bool verify_checksum = true){
+        detail::unique_fd f(::open(path, O_RDONLY | O_CLOEXEC));
+        if(f.fd < 0) detail::throw_errno("snapshot: open");
+        load_snapshot(v, f.fd, verify_checksum);
+    }
+
+    template<class T>
+        requires std::is_trivially_copyable_v<T>
+    class snapshot_view;
+
+    template<class T>
+        requires std::is_trivially_copyable_v<T>
+    snapshot_view<T> map_snapshot(int fd, bool verify_checksum = true);
+
+    //read-only view of a memory-mapped snapshot. Pages are faulted in on first
+    //access, so opening is O(1) unless the checksum is verified.
+    template<class T>
+        requires std::is_trivially_copyable_v<T>
+    class snapshot_view{
+    public:
+        using value_type = T;
+        using size_type = std::size_t;
+        using const_iterator = const T*;
+
+        snapshot_view() noexcept = default;
+
+        snapshot_view(snapshot_view&& other) noexcept
+            : m_map(other.m_map), m_map_size(other.m_map_size), m_data(other.m_data), m_size(other.m_size){
+            other.m_map = nullptr;
+            other.m_map_size = other.m_size = 0;
+            other.m_data = nullptr;
+        }
+
+        snapshot_view& operator=(snapshot_view&& other) noexcept{
+            if(this != &other){
+                snapshot_view tmp(std::move(other));
+                swap(tmp);
+            }
+            return *this;
+        }
+
+        ~snapshot_view(){
+            if(m_map) ::munmap(m_map, m_map_size);
+        }
+
+        [[nodiscard]] const T* data() const noexcept{ return m_data; }
+        [[nodiscard]] size_type size() const noexcept{ return m_size; }
+        [[nodiscard]] bool empty() const noexcept{ return m_size == 0; }
+        [[nodiscard]] const_iterator begin() const noexcept{ return m_data; }
+        [[nodiscard]] const_iterator end() const noexcept{ return m_data + m_size; }
+        [[nodiscard]] const T& operator[](size_type pos) const noexcept{ return m_data[pos]; }
+
+        //copy the viewed elements into a vector
+        template<class A = std::allocator<T>>
+        [[nodiscard]] std::vector<T, A> to_vector(const A& alloc = A()) const{
+            return std::vector<T, A>(begin(), end(), alloc);
+        }
+
+        void swap(snapshot_view& other) noexcept{
+            std::swap(m_map, other.m_map);
+            std::swap(m_map_size, other.m_map_size);
+            std::swap(m_data, other.m_data);
+            std::swap(m_size, other.m_size);
+        }
+
+    private:
+        template<class U> requires std::is_trivially_copyable_v<U>
+        friend snapshot_view<U> map_snapshot(int fd, bool verify_checksum);
+
+        void* m_map = nullptr;
+        size_type m_map_size = 0;
+        const T* m_data = nullptr;
+        size_type m_size = 0;
+    };
+
+    template<class T>
+        requires std::is_trivially_copyable_v<T>
+    snapshot_view<T> map_snapshot(int fd, bool verify_checksum){
+        const std::uint64_t size = detail::file_size(fd);
+        if(size < sizeof(snapshot_header)) throw snapshot_error("snapshot: file is truncated");
+        void* map = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if(map == MAP_FAILED) detail::throw_errno("snapshot: mmap");
+        snapshot_view<T> view;
+        view.m_map = map;
+        view.m_map_size = size;
+        snapshot_header h;
+        std::memcpy(&h, map, sizeof(h));
+        detail::check_snapshot_header<T>(h, size);
+        view.m_data = reinterpret_cast<const T*>(static_cast<const char*>(map) + h.data_offset);
+        view.m_size = h.count;
+        if(verify_checksum){
+            //the whole file is about to be read once
+            ::madvise(map, size, MADV_SEQUENTIAL);
+            if(detail::crc32c(view.m_data, view.m_size * sizeof(T)) != h.checksum){
+                throw snapshot_error("snapshot: payload checksum mismatch");
+            }
+            ::madvise(map, size, MADV_NORMAL);
+        }
+        return view;
+    }
+
+    template<class T>
+        requires std::is_trivially_copyable_v<T>
+    snapshot_view<T> map_snapshot(const char* path, bool verify_checksum = true){
+        detail::unique_fd f(::open(path, O_RDONLY | O_CLOEXEC));
+        if(f.fd < 0) detail::throw_errno("snapshot: open");
+        //the mapping stays valid after the descriptor is closed
+        return map_snapshot<T>(f.fd, verify_checksum);
+    }
+}
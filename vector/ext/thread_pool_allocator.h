@@ -0,0 +1,255 @@
+//Thread-caching size-class pool allocator for many small vectors
+//
+//ext::pool_allocator<T> is a stateless allocator for vector<T, pool_allocator<T>>.
+//Requests up to 64 KiB are rounded up to a power-of-two size class (16 B, 32 B, ...),
+//which is exactly the sequence of block sizes calculate_growth's doubling asks for,
+//so a growing vector moves from one class to the next with no rounding waste
+//beyond the first few elements.
+//
+//Each thread keeps a small free list per class and normally allocates and frees
+//without any locking. A thread whose list runs dry takes a whole batch of blocks
+//from the central pool under one lock; one that collects more than two batches
+//hands one back the same way. So blocks freed by a different thread than the one
+//that allocated them (producer/consumer hand-off) still find their way back.
+//New memory is carved from 64 KiB slabs that are kept for the life of the process:
+//the pool only grows to the high-water mark of each class.
+//
+//Larger requests, and alignments above 4 KiB, go straight to operator new.
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+namespace ext{
+    namespace detail{
+        inline constexpr std::size_t pool_min_shift = 4;            //16-byte class: room for two links
+        inline constexpr std::size_t pool_max_shift = 16;           //64 KiB class
+        inline constexpr std::size_t pool_class_count = pool_max_shift - pool_min_shift + 1;
+        inline constexpr std::size_t pool_slab_bytes = 64 * 1024;
+        inline constexpr std::size_t pool_slab_align = 4096;
+
+        constexpr std::size_t pool_class_of(std::size_t bytes) noexcept{
+            return bytes <= (std::size_t(1) << pool_min_shift) ? 0 : std::bit_width(bytes - 1) - pool_min_shift;
+        }
+
+        constexpr std::size_t pool_class_size(std::size_t cls) noexcept{
+            return std::size_t(1) << (cls + pool_min_shift);
+        }
+
+        //blocks moved between a thread and the central pool at a time
+        constexpr std::size_t pool_batch(std::size_t cls) noexcept{
+            std::size_t n = pool_slab_bytes / pool_class_size(cls);
+            return n > 64 ? 64 : n < 2 ? 2 : n;
+        }
+
+        //a free block; next links a chain, next_batch links chains in the central pool
+        struct pool_block{
+            pool_block* next;
+            pool_block* next_batch;
+        };
+
+        class central_pool{
+        public:
+            //never destroyed, so blocks freed during static destruction still have somewhere to go
+            static central_pool& instance(){
+                static central_pool* pool = new central_pool;
+                return *pool;
+            }
+
+            //a chain of blocks of class cls, from a returned batch or a new slab
+            pool_block* take(std::size_t cls){
+                bin& b = m_bins[cls];
+                {
+                    std::lock_guard<std::mutex> lock(b.lock);
+                    if(pool_block* chain = b.batches){
+                        b.batches = chain->next_batch;
+                        return chain;
+                    }
+                }
+                return carve(cls);
+            }
+
+            void give(std::size_t cls, pool_block* chain) noexcept{
+                bin& b = m_bins[cls];
+                std::lock_guard<std::mutex> lock(b.lock);
+                chain->next_batch = b.batches;
+                b.batches = chain;
+            }
+
+        private:
+            struct bin{
+                std::mutex lock;
+                pool_block* batches = nullptr;
+            };
+
+            struct slab{
+                slab* next;
+                void* memory;
+            };
+
+            //cut a new slab into batches: keep one, publish the rest
+            pool_block* carve(std::size_t cls){
+                const std::size_t size = pool_class_size(cls);
+                const std::size_t batch = pool_batch(cls);
+                const std::size_t bytes = size * batch > pool_slab_bytes ? size * batch : pool_slab_bytes;
+                char* mem = static_cast<char*>(::operator new(bytes, std::align_val_t(pool_slab_align)));
+                const std::size_t blocks = bytes / size;
+                {
+                    //the slab list keeps the memory reachable for leak checkers
+                    std::lock_guard<std::mutex> lock(m_slab_lock);
+                    m_slabs = new slab{m_slabs, mem};
+                }
+                pool_block* first = nullptr;
+                for(std::size_t start = 0; start < blocks; start += batch){
+                    const std::size_t end = start + batch < blocks ? start + batch : blocks;
+                    for(std::size_t i = start; i < end; ++i){
+                        auto* blk = reinterpret_cast<pool_block*>(mem + i * size);
+                        blk->next = i + 1 < end ? reinterpret_cast<pool_block*>(mem + (i + 1) * size) : nullptr;
+                    }
+                    auto* chain = reinterpret_cast<pool_block*>(mem + start * size);
+                    if(first == nullptr) first = chain;
+                    else give(cls, chain);
+                }
+                return first;
+            }
+
+            bin m_bins[pool_class_count];
+            std::mutex m_slab_lock;
+            slab* m_slabs = nullptr;
+        };
+
+        constinit inline thread_local bool thread_cache_gone = false;
+
+        class thread_cache{
+        public:
+            void* allocate(std::size_t cls){
+                bin& b = m_bins[cls];
+                if(b.head == nullptr){
+                    b.head = central_pool::instance().take(cls);
+                    b.count = 0;
+                    for(pool_block* p = b.head; p; p = p->next) ++b.count;
+                }
+                pool_block* blk = b.head;
+                b.head = blk->next;
+                --b.count;
+                return blk;
+            }
+
+            void deallocate(std::size_t cls, void* p) noexcept{
+                bin& b = m_bins[cls];
+                auto* blk = static_cast<pool_block*>(p);
+                blk->next = b.head;
+                b.head = blk;
+                if(++b.count > 2 * pool_batch(cls)){
+                    //return the most recently freed batch, keep the rest warm
+                    pool_block* last = b.head;
+                    for(std::size_t i = 1; i < pool_batch(cls); ++i) last = last->next;
+                    pool_block* chain = b.head;
+                    b.head = last->next;
+                    last->next = nullptr;
+                    b.count -= pool_batch(cls);
+                    central_pool::instance().give(cls, chain);
+                }
+            }
+
+            //hand every cached block back to the central pool
+            void flush() noexcept{
+                for(std::size_t cls = 0; cls < pool_class_count; ++cls){
+                    if(m_bins[cls].head) central_pool::instance().give(cls, m_bins[cls].head);
+                    m_bins[cls] = bin{};
+                }
+            }
+
+            ~thread_cache(){
+                flush();
+                thread_cache_gone = true;
+            }
+
+        private:
+            struct bin{
+                pool_block* head = nullptr;
+                std::size_t count = 0;
+            };
+            bin m_bins[pool_class_count];
+        };
+
+        //nullptr once this thread's cache has been destroyed (thread_local destructors
+        //that still free pool memory then go to the central pool directly)
+        inline thread_cache* local_thread_cache() noexcept{
+            if(thread_cache_gone) return nullptr;
+            static thread_local thread_cache cache;
+            return &cache;
+        }
+
+        inline bool pool_handles(std::size_t bytes, std::size_t align) noexcept{
+            return bytes <= pool_class_size(pool_class_count - 1) && align <= pool_slab_align;
+        }
+
+        inline void* pool_allocate(std::size_t bytes, std::size_t align){
+            if(!pool_handles(bytes, align)){
+                if(align > __STDCPP_DEFAULT_NEW_ALIGNMENT__) return ::operator new(bytes, std::align_val_t(align));
+                return ::operator new(bytes);
+            }
+            const std::size_t cls = pool_class_of(bytes);
+            if(thread_cache* cache = local_thread_cache()) return cache->allocate(cls);
+            pool_block* chain = central_pool::instance().take(cls);
+            if(chain->next) central_pool::instance().give(cls, chain->next);
+            return chain;
+        }
+
+        inline void pool_deallocate(void* p, std::size_t bytes, std::size_t align) noexcept{
+            if(!pool_handles(bytes, align)){
+                if(align > __STDCPP_DEFAULT_NEW_ALIGNMENT__) ::operator delete(p, bytes, std::align_val_t(align));
+                else ::operator delete(p, bytes);
+                return;
+            }
+            const std::size_t cls = pool_class_of(bytes);
+            if(thread_cache* cache = local_thread_cache()){
+                cache->deallocate(cls, p);
+                return;
+            }
+            auto* blk = static_cast<pool_block*>(p);
+            blk->next = nullptr;
+            central_pool::instance().give(cls, blk);
+        }
+    }
+
+    template<class T>
+    class pool_allocator{
+    public:
+        using value_type = T;
+        using size_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using propagate_on_container_move_assignment = std::true_type;
+        using is_always_equal = std::true_type;
+
+        pool_allocator() noexcept = default;
+
+        template<class U>
+        pool_allocator(const pool_allocator<U>&) noexcept{}
+
+        [[nodiscard]] T* allocate(size_type n){
+            if(n > std::numeric_limits<size_type>::max() / sizeof(T)) throw std::bad_array_new_length();
+            return static_cast<T*>(detail::pool_allocate(n * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T* p, size_type n) noexcept{
+            detail::pool_deallocate(p, n * sizeof(T), alignof(T));
+        }
+
+        template<class U>
+        friend bool operator==(const pool_allocator&, const pool_allocator<U>&) noexcept{
+            return true;
+        }
+    };
+
+    //give the calling thread's cached blocks back to the central pool, e.g. before
+    //a worker goes idle for a long time
+    inline void pool_flush_thread_cache() noexcept{
+        if(detail::thread_cache* cache = detail::local_thread_cache()) cache->flush();
+    }
+}
@@ -0,0 +1,256 @@
+//Per-instantiation vector operation statistics
+//
+//vector_stats_recorder<T, Alloc> implements the vector_stats_policy hooks of
+//vector.h with relaxed atomic counters, one set per vector<T, Alloc> type, shared
+//by every vector of that type in the process:
+//  allocations        a first block for an empty vector (shrink_to_fit builds one)
+//  reallocations      a vector moved to a new block, per cause (grow, append,
+//                     resize, insert; see std::vector_event)
+//  in place           grown in place by the allocator instead
+//  shrinks            shrink_to_fit calls that reallocated
+//  moved / copied     elements relocated by moving, or by copying because T's
+//                     move constructor may throw (move_if_noexcept)
+//  bytes relocated    (moved + copied) * sizeof(T)
+//  peak size/capacity the largest any single vector of the type reached
+//
+//Turn it on for one type with EXT_VECTOR_STATS(T) at namespace scope before that
+//vector<T> is first used, or for every vector by defining VECTOR_STATS for the
+//whole program. Without either, vector.h does not even contain the calls.
+//
+//    EXT_VECTOR_STATS(route);
+//    ...
+//    ext::write_vector_stats(std::cerr, ext::vector_stats_format::json);
+#pragma once
+#include "../vector.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+#include <source_location>
+#include <string>
+#include <string_view>
+
+namespace ext{
+    //the counters of one instantiation, as returned by collect_vector_stats
+    struct vector_stats{
+        std::string type;               //e.g. "vector<route>"
+        std::size_t element_size;
+        std::uint64_t allocations;
+        std::uint64_t reallocations[4]; //indexed by vector_event: grow, append, resize, insert
+        std::uint64_t in_place;
+        std::uint64_t shrinks;
+        std::uint64_t moved;
+        std::uint64_t copied;
+        std::uint64_t bytes_relocated;
+        std::uint64_t peak_size;
+        std::uint64_t peak_capacity;
+
+        [[nodiscard]] std::uint64_t total_reallocations() const noexcept{
+            return reallocations[0] + reallocations[1] + reallocations[2] + reallocations[3];
+        }
+    };
+
+    enum class vector_stats_format{ text, json };
+
+    namespace detail{
+        //one per instantiation; lives in static storage and has no destructor, so
+        //vectors destroyed during static destruction can still count
+        struct vector_stats_site{
+            const char* signature;
+            std::size_t element_size;
+            std::atomic<std::uint64_t> allocations{0};
+            std::atomic<std::uint64_t> reallocations[4]{};
+            std::atomic<std::uint64_t> in_place{0};
+            std::atomic<std::uint64_t> shrinks{0};
+            std::atomic<std::uint64_t> moved{0};
+            std::atomic<std::uint64_t> copied{0};
+            std::atomic<std::uint64_t> bytes_relocated{0};
+            std::atomic<std::uint64_t> peak_size{0};
+            std::atomic<std::uint64_t> peak_capacity{0};
+            vector_stats_site* next = nullptr;
+
+            vector_stats_site(const char* sig, std::size_t elem_size) noexcept;
+        };
+
+        inline constinit std::atomic<vector_stats_site*> vector_stats_sites{nullptr};
+
+        inline vector_stats_site::vector_stats_site(const char* sig, std::size_t elem_size) noexcept
+            : signature(sig), element_size(elem_size){
+            next = vector_stats_sites.load(std::memory_order_relaxed);
+            while(!vector_stats_sites.compare_exchange_weak(next, this, std::memory_order_release, std::memory_order_relaxed)){}
+        }
+
+        inline void store_max(std::atomic<std::uint64_t>& a, std::uint64_t v) noexcept{
+            std::uint64_t cur = a.load(std::memory_order_relaxed);
+            while(v > cur && !a.compare_exchange_weak(cur, v, std::memory_order_relaxed)){}
+        }
+
+        //"vector<T>" or "vector<T, Alloc>" from the recorder's function signature
+        //(GCC: "... [with T = int; Alloc = std::allocator<int>]",
+        // Clang: "... vector_stats_recorder<int, std::allocator<int>>::site() ...")
+        inline std::string vector_stats_type_name(std::string_view sig){
+            std::string_view t, alloc;
+            if(auto with = sig.find("[with T = "); with != std::string_view::npos){
+                std::string_view rest = sig.substr(with + 10, sig.rfind(']') - with - 10);
+                std::size_t semi = rest.find("; Alloc = ");
+                t = rest.substr(0, semi);
+                if(semi != std::string_view::npos) alloc = rest.substr(semi + 10);
+            }else if(auto open = sig.find("vector_stats_recorder<"); open != std::string_view::npos){
+                std::string_view rest = sig.substr(open + 22, sig.rfind(">::") - open - 22);
+                //the allocator is the last top-level argument
+                int depth = 0;
+                std::size_t split = std::string_view::npos;
+                for(std::size_t i = 0; i < rest.size(); ++i){
+                    if(rest[i] == '<') ++depth;
+                    else if(rest[i] == '>') --depth;
+                    else if(rest[i] == ',' && depth == 0) split = i;
+                }
+                t = rest.substr(0, split);
+                if(split != std::string_view::npos) alloc = rest.substr(split + 2);
+            }else{
+                return std::string(sig);
+            }
+            std::string name = "vector<" + std::string(t);
+            const std::string default_alloc = "std::allocator<" + std::string(t);
+            if(alloc != default_alloc + ">" && alloc != default_alloc + " >") name += ", " + std::string(alloc);
+            return name + ">";
+        }
+
+        inline void write_json_string(std::ostream& os, std::string_view s){
+            os << '"';
+            for(char c : s){
+                if(c == '"' || c == '\\') os << '\\' << c;
+                else if(static_cast<unsigned char>(c) < 0x20) os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec << std::setfill(' ');
+                else os << c;
+            }
+            os << '"';
+        }
+
+        inline vector_stats_format& exit_format() noexcept{
+            static vector_stats_format format = vector_stats_format::text;
+            return format;
+        }
+    }
+
+    template<class T, class Alloc>
+    struct vector_stats_recorder{
+        static constexpr bool enabled = true;
+
+        static void relocated(const Alloc&, std::vector_event event, std::size_t old_cap, std::size_t new_cap, std::size_t count, bool moved) noexcept{
+            detail::vector_stats_site& s = site();
+            if(event == std::vector_event::shrink) s.shrinks.fetch_add(1, std::memory_order_relaxed);
+            else if(old_cap == 0) s.allocations.fetch_add(1, std::memory_order_relaxed);
+            else s.reallocations[static_cast<int>(event)].fetch_add(1, std::memory_order_relaxed);
+            if(count){
+                (moved ? s.moved : s.copied).fetch_add(count, std::memory_order_relaxed);
+                s.bytes_relocated.fetch_add(count * sizeof(T), std::memory_order_relaxed);
+            }
+            detail::store_max(s.peak_capacity, new_cap);
+        }
+
+        static void expanded(const Alloc&, std::size_t, std::size_t new_cap) noexcept{
+            detail::vector_stats_site& s = site();
+            s.in_place.fetch_add(1, std::memory_order_relaxed);
+            detail::store_max(s.peak_capacity, new_cap);
+        }
+
+        static void size_grew(const Alloc&, std::size_t size, std::size_t) noexcept{
+            detail::store_max(site().peak_size, size);
+        }
+
+        static void released(const Alloc&, std::size_t, std::size_t) noexcept{}
+
+    private:
+        static detail::vector_stats_site& site() noexcept{
+            static detail::vector_stats_site s(std::source_location::current().function_name(), sizeof(T));
+            return s;
+        }
+    };
+
+    //every instantiation that has recorded something, most bytes relocated first
+    inline std::vector<vector_stats> collect_vector_stats(){
+        std::vector<vector_stats> out;
+        for(auto* s = detail::vector_stats_sites.load(std::memory_order_acquire); s; s = s->next){
+            vector_stats v{detail::vector_stats_type_name(s->signature), s->element_size,
+                           s->allocations.load(std::memory_order_relaxed), {},
+                           s->in_place.load(std::memory_order_relaxed), s->shrinks.load(std::memory_order_relaxed),
+                           s->moved.load(std::memory_order_relaxed), s->copied.load(std::memory_order_relaxed),
+                           s->bytes_relocated.load(std::memory_order_relaxed),
+                           s->peak_size.load(std::memory_order_relaxed), s->peak_capacity.load(std::memory_order_relaxed)};
+            for(int e = 0; e < 4; ++e) v.reallocations[e] = s->reallocations[e].load(std::memory_order_relaxed);
+            out.push_back(std::move(v));
+        }
+        std::sort(out.begin(), out.end(), [](const vector_stats& a, const vector_stats& b){
+            return a.bytes_relocated != b.bytes_relocated ? a.bytes_relocated > b.bytes_relocated : a.type < b.type;
+        });
+        return out;
+    }
+
+    //zero every counter, e.g. after warm-up
+    inline void reset_vector_stats() noexcept{
+        for(auto* s = detail::vector_stats_sites.load(std::memory_order_acquire); s; s = s->next){
+            for(auto* c : {&s->allocations, &s->in_place, &s->shrinks, &s->moved, &s->copied,
+                           &s->bytes_relocated, &s->peak_size, &s->peak_capacity}) c->store(0, std::memory_order_relaxed);
+            for(auto& c : s->reallocations) c.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    inline void write_vector_stats(std::ostream& os, vector_stats_format format = vector_stats_format::text){
+        const std::vector<vector_stats> stats = collect_vector_stats();
+        if(format == vector_stats_format::json){
+            static constexpr const char* causes[4] = {"grow", "append", "resize", "insert"};
+            os << "[";
+            for(std::size_t i = 0; i < stats.size(); ++i){
+                const vector_stats& s = stats[i];
+                os << (i ? ",\n " : "\n ") << "{\"type\": ";
+                detail::write_json_string(os, s.type);
+                os << ", \"element_size\": " << s.element_size << ", \"allocations\": " << s.allocations
+                   << ", \"reallocations\": {";
+                for(int e = 0; e < 4; ++e) os << (e ? ", \"" : "\"") << causes[e] << "\": " << s.reallocations[e];
+                os << "}, \"in_place\": " << s.in_place << ", \"shrinks\": " << s.shrinks
+                   << ", \"moved\": " << s.moved << ", \"copied\": " << s.copied
+                   << ", \"bytes_relocated\": " << s.bytes_relocated
+                   << ", \"peak_size\": " << s.peak_size << ", \"peak_capacity\": " << s.peak_capacity << "}";
+            }
+            os << (stats.empty() ? "]\n" : "\n]\n");
+            return;
+        }
+        os << "vector statistics, " << stats.size() << " instantiation" << (stats.size() == 1 ? "" : "s") << "\n";
+        os << std::right << std::setw(8) << "allocs" << std::setw(10) << "reallocs" << std::setw(10) << "in place"
+           << std::setw(9) << "shrinks" << std::setw(12) << "moved" << std::setw(12) << "copied"
+           << std::setw(14) << "bytes reloc" << std::setw(12) << "peak size" << std::setw(12) << "peak cap" << "  type\n";
+        for(const vector_stats& s : stats){
+            os << std::setw(8) << s.allocations << std::setw(10) << s.total_reallocations() << std::setw(10) << s.in_place
+               << std::setw(9) << s.shrinks << std::setw(12) << s.moved << std::setw(12) << s.copied
+               << std::setw(14) << s.bytes_relocated << std::setw(12) << s.peak_size << std::setw(12) << s.peak_capacity
+               << "  " << s.type << "\n";
+        }
+        os << std::left;
+    }
+
+    //print the statistics to stderr when the process exits normally
+    inline void write_vector_stats_at_exit(vector_stats_format format = vector_stats_format::text){
+        static bool registered = false;
+        detail::exit_format() = format;
+        if(!registered){
+            registered = true;
+            std::atexit([]{ write_vector_stats(std::cerr, detail::exit_format()); });
+        }
+    }
+}
+
+//count vector<T> (with std::allocator) in this program; at namespace scope, before vector<T> is used
+#define EXT_VECTOR_STATS(...) \
+    template<> struct std::vector_stats_policy<__VA_ARGS__, std::allocator<__VA_ARGS__>> \
+        : ext::vector_stats_recorder<__VA_ARGS__, std::allocator<__VA_ARGS__>>{}
+
+#ifdef VECTOR_STATS
+namespace std{
+    template<class T, class Alloc>
+    struct vector_stats_default : ext::vector_stats_recorder<T, Alloc>{};
+}
+#endif
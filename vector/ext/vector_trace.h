@@ -0,0 +1,164 @@
+//Reallocation and copy tracer
+//
+//vector_trace_recorder<T, Alloc> implements vector_trace_policy. Every reallocation
+//or copy construction that moves at least VECTOR_TRACE_MIN_BYTES (default 4096)
+//of elements is timed and written to a process-wide ring buffer holding the last
+//VECTOR_TRACE_EVENTS (default 4096, a power of two) events. Smaller ones are not
+//timed at all; they do not cause latency spikes.
+//
+//With VECTOR_TRACE_USDT defined each traced event also fires the USDT probe
+//    vector:relocate(event, old_cap, new_cap, elem_size, count, duration_ns)
+//(event is a vector_event value), which needs <sys/sdt.h> from systemtap-sdt-dev
+//and costs a nop while nothing is attached:
+//    bpftrace -e 'usdt:./server:vector:relocate { @us = hist(arg5 / 1000); }'
+//    perf probe -x ./server sdt_vector:relocate && perf record -e sdt_vector:relocate ...
+//
+//Timestamps come from steady_clock (CLOCK_MONOTONIC on Linux); record with
+//perf record -k CLOCK_MONOTONIC to put both on one time line.
+//
+//Turn it on for one type with EXT_VECTOR_TRACE(T) at namespace scope before that
+//vector<T> is first used, or for every vector by defining VECTOR_TRACE for the
+//whole program.
+//
+//    ext::write_vector_trace(std::cerr);   //e.g. from a slow-request handler
+#pragma once
+#include "../vector.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifdef VECTOR_TRACE_USDT
+#if !__has_include(<sys/sdt.h>)
+#error "VECTOR_TRACE_USDT needs <sys/sdt.h> (systemtap-sdt-dev)"
+#endif
+#include <sys/sdt.h>
+#endif
+
+#ifndef VECTOR_TRACE_MIN_BYTES
+#define VECTOR_TRACE_MIN_BYTES 4096
+#endif
+
+#ifndef VECTOR_TRACE_EVENTS
+#define VECTOR_TRACE_EVENTS 4096
+#endif
+
+namespace ext{
+    struct vector_trace_event{
+        std::uint64_t start_ns;     //steady_clock
+        std::uint64_t duration_ns;
+        std::vector_event event;
+        std::uint32_t tid;
+        std::uint64_t old_cap;
+        std::uint64_t new_cap;
+        std::uint64_t elem_size;
+        std::uint64_t count;
+    };
+
+    namespace detail{
+        static_assert((VECTOR_TRACE_EVENTS & (VECTOR_TRACE_EVENTS - 1)) == 0, "VECTOR_TRACE_EVENTS must be a power of two");
+
+        //a seqlock per slot: seq is odd while a writer fills it and 2 * (ticket + 1) once done
+        struct alignas(64) vector_trace_slot{
+            std::atomic<std::uint64_t> seq{0};
+            std::atomic<std::uint64_t> words[7]{};
+        };
+
+        inline constinit std::atomic<std::uint64_t> vector_trace_head{0};
+        inline constinit vector_trace_slot vector_trace_ring[VECTOR_TRACE_EVENTS];
+
+        inline std::uint64_t trace_now() noexcept{
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        inline std::uint32_t trace_tid() noexcept{
+            static thread_local std::uint32_t tid = static_cast<std::uint32_t>(::syscall(SYS_gettid));
+            return tid;
+        }
+
+        inline void trace_record(const vector_trace_event& e) noexcept{
+            const std::uint64_t ticket = vector_trace_head.fetch_add(1, std::memory_order_relaxed);
+            vector_trace_slot& slot = vector_trace_ring[ticket & (VECTOR_TRACE_EVENTS - 1)];
+            slot.seq.store(2 * ticket + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            const std::uint64_t words[7] = {e.start_ns, e.duration_ns,
+                                            static_cast<std::uint64_t>(e.event) | std::uint64_t(e.tid) << 32,
+                                            e.old_cap, e.new_cap, e.elem_size, e.count};
+            for(int i = 0; i < 7; ++i) slot.words[i].store(words[i], std::memory_order_relaxed);
+            slot.seq.store(2 * ticket + 2, std::memory_order_release);
+        }
+
+        inline const char* trace_event_name(std::vector_event e) noexcept{
+            switch(e){
+                case std::vector_event::grow: return "grow";
+                case std::vector_event::append: return "append";
+                case std::vector_event::resize: return "resize";
+                case std::vector_event::insert: return "insert";
+                case std::vector_event::shrink: return "shrink";
+                case std::vector_event::copy: return "copy";
+            }
+            return "?";
+        }
+    }
+
+    template<class T, class Alloc>
+    struct vector_trace_recorder{
+        static constexpr bool enabled = true;
+
+        static std::uint64_t start(std::vector_event, std::size_t bytes) noexcept{
+            return bytes >= VECTOR_TRACE_MIN_BYTES ? detail::trace_now() : 0;
+        }
+
+        static void finish(std::uint64_t start, std::vector_event event, std::size_t old_cap, std::size_t new_cap,
+                           std::size_t elem_size, std::size_t count) noexcept{
+            const std::uint64_t duration = detail::trace_now() - start;
+#ifdef VECTOR_TRACE_USDT
+            DTRACE_PROBE6(vector, relocate, static_cast<int>(event), old_cap, new_cap, elem_size, count, duration);
+#endif
+            detail::trace_record({start, duration, event, detail::trace_tid(), old_cap, new_cap, elem_size, count});
+        }
+    };
+
+    //the events still in the ring, oldest first; ones being overwritten right now are skipped
+    inline std::vector<vector_trace_event> vector_trace_events(){
+        const std::uint64_t head = detail::vector_trace_head.load(std::memory_order_acquire);
+        std::vector<vector_trace_event> out;
+        for(std::uint64_t t = head > VECTOR_TRACE_EVENTS ? head - VECTOR_TRACE_EVENTS : 0; t < head; ++t){
+            const detail::vector_trace_slot& slot = detail::vector_trace_ring[t & (VECTOR_TRACE_EVENTS - 1)];
+            const std::uint64_t seq = slot.seq.load(std::memory_order_acquire);
+            if(seq != 2 * t + 2) continue;
+            std::uint64_t w[7];
+            for(int i = 0; i < 7; ++i) w[i] = slot.words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(slot.seq.load(std::memory_order_relaxed) != seq) continue;
+            out.push_back({w[0], w[1], static_cast<std::vector_event>(w[2] & 0xffffffff), static_cast<std::uint32_t>(w[2] >> 32),
+                           w[3], w[4], w[5], w[6]});
+        }
+        return out;
+    }
+
+    //one line per event: start_ns tid event old_cap -> new_cap elem_size count duration_ns
+    inline void write_vector_trace(std::ostream& os){
+        for(const vector_trace_event& e : vector_trace_events()){
+            os << e.start_ns << ' ' << e.tid << ' ' << detail::trace_event_name(e.event) << ' '
+               << e.old_cap << " -> " << e.new_cap << " x" << e.elem_size << "B, " << e.count
+               << " elements, " << e.duration_ns << " ns\n";
+        }
+    }
+}
+
+//trace vector<T> (with std::allocator) in this program; at namespace scope, before vector<T> is used
+#define EXT_VECTOR_TRACE(...) \
+    template<> struct std::vector_trace_policy<__VA_ARGS__, std::allocator<__VA_ARGS__>> \
+        : ext::vector_trace_recorder<__VA_ARGS__, std::allocator<__VA_ARGS__>>{}
+
+#ifdef VECTOR_TRACE
+namespace std{
+    template<class T, class Alloc>
+    struct vector_trace_default : ext::vector_trace_recorder<T, Alloc>{};
+}
+#endif
@@ -0,0 +1,156 @@
+//Benchmark baselines: the rows of one run kept in a text file, and the regressions
+//of a later run against it.
+//
+//A row is a name and n with its mean, ci95, standard deviation and sample count
+//(ns per call) and the heap it left allocated. The file is tab-separated text,
+//one row per line, under a fingerprint line for the machine and build that
+//produced it:
+//    fingerprint	<cpu model>; <threads> threads; <compiler>; <optimized or -O0>
+//    <name>	<n>	<mean_ns>	<ci95>	<sd_ns>	<samples>	<heap_bytes>
+//
+//A row is slower when Welch's t-test puts the new mean above the old one at 99%
+//one-sided and it is also more than `tolerance` slower, so that a real but tiny
+//difference is not a failure. It holds more memory when its heap grew by more than
+//`tolerance` and by at least 64 KiB. Rows measured from one sample have no variance
+//and are compared on the tolerance alone.
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bench{
+    struct baseline_row{
+        std::string name;
+        std::size_t n;
+        double mean_ns;
+        double ci95;
+        double sd_ns;
+        std::size_t samples;
+        long heap_bytes;
+    };
+
+    struct regression{
+        std::string name;
+        std::size_t n;
+        bool memory;        //heap grew, rather than the mean
+        double before;      //ns or bytes
+        double after;
+        double t;           //Welch's t, 0 when not tested
+    };
+
+    //what makes timings comparable: the CPU, how many threads it runs and the build
+    inline std::string machine_fingerprint(){
+        std::string cpu = "unknown cpu";
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        for(std::string line; std::getline(cpuinfo, line);){
+            if(line.compare(0, 10, "model name") == 0){
+                std::size_t colon = line.find(':');
+                if(colon != std::string::npos) cpu = line.substr(line.find_first_not_of(' ', colon + 1));
+                break;
+            }
+        }
+        std::ostringstream os;
+        os << cpu << "; " << std::thread::hardware_concurrency() << " threads; "
+#if defined(__clang__)
+           << "clang " << __clang_version__
+#elif defined(__GNUC__)
+           << "g++ " << __VERSION__
+#endif
+#ifdef __OPTIMIZE__
+           << "; optimized";
+#else
+           << "; -O0";
+#endif
+        return os.str();
+    }
+
+    class baseline{
+    public:
+        std::string fingerprint;
+        std::vector<baseline_row> rows;
+
+        //false when the file does not exist or is not a baseline
+        bool load(const std::string& path){
+            std::ifstream in(path);
+            std::string line;
+            if(!in || !std::getline(in, line) || line.compare(0, 12, "fingerprint\t") != 0) return false;
+            fingerprint = line.substr(12);
+            rows.clear();
+            while(std::getline(in, line)){
+                std::size_t tab = line.find('\t');
+                if(tab == std::string::npos) continue;
+                baseline_row r{line.substr(0, tab), 0, 0, 0, 0, 0, 0};
+                std::istringstream fields(line.substr(tab + 1));
+                if(fields >> r.n >> r.mean_ns >> r.ci95 >> r.sd_ns >> r.samples >> r.heap_bytes) rows.push_back(r);
+            }
+            return true;
+        }
+
+        bool save(const std::string& path) const{
+            std::ofstream out(path);
+            out << "fingerprint\t" << fingerprint << "\n";
+            out.precision(10);
+            for(const baseline_row& r : rows){
+                out << r.name << '\t' << r.n << '\t' << r.mean_ns << '\t' << r.ci95 << '\t' << r.sd_ns << '\t'
+                    << r.samples << '\t' << r.heap_bytes << "\n";
+            }
+            return static_cast<bool>(out);
+        }
+
+        [[nodiscard]] const baseline_row* find(const std::string& name, std::size_t n) const{
+            for(const baseline_row& r : rows){
+                if(r.n == n && r.name == name) return &r;
+            }
+            return nullptr;
+        }
+
+        //replace the rows that were measured again, keep the others (e.g. those a --filter skipped)
+        void merge(const std::vector<baseline_row>& now){
+            for(const baseline_row& r : now){
+                auto it = std::find_if(rows.begin(), rows.end(), [&](const baseline_row& b){ return b.n == r.n && b.name == r.name; });
+                if(it != rows.end()) *it = r;
+                else rows.push_back(r);
+            }
+        }
+    };
+
+    namespace detail{
+        //one-sided 99% quantile of Student's t with df degrees of freedom
+        //(Cornish-Fisher expansion around the normal quantile; within 1% from df = 3)
+        inline double t_critical_99(double df){
+            const double z = 2.3263478740;
+            const double z3 = z * z * z, z5 = z3 * z * z;
+            return z + (z3 + z) / (4 * df) + (5 * z5 + 16 * z3 + 3 * z) / (96 * df * df);
+        }
+    }
+
+    //the rows of `now` that are significantly slower than, or hold more heap than, the same rows in `base`
+    inline std::vector<regression> compare(const baseline& base, const std::vector<baseline_row>& now, double tolerance){
+        std::vector<regression> out;
+        for(const baseline_row& r : now){
+            const baseline_row* b = base.find(r.name, r.n);
+            if(!b) continue;
+            if(r.mean_ns > b->mean_ns * (1 + tolerance)){
+                double t = 0;
+                bool significant = true;
+                if(r.samples > 1 && b->samples > 1){
+                    const double va = b->sd_ns * b->sd_ns / b->samples, vb = r.sd_ns * r.sd_ns / r.samples;
+                    if(va + vb > 0){
+                        t = (r.mean_ns - b->mean_ns) / std::sqrt(va + vb);
+                        const double df = (va + vb) * (va + vb) / (va * va / (b->samples - 1) + vb * vb / (r.samples - 1));
+                        significant = t > detail::t_critical_99(df);
+                    }
+                }
+                if(significant) out.push_back({r.name, r.n, false, b->mean_ns, r.mean_ns, t});
+            }
+            const double heap_limit = std::max(b->heap_bytes * (1 + tolerance), b->heap_bytes + 65536.0);
+            if(r.heap_bytes > heap_limit) out.push_back({r.name, r.n, true, double(b->heap_bytes), double(r.heap_bytes), 0});
+        }
+        return out;
+    }
+}
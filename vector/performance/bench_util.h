@@ -0,0 +1,73 @@
+//Shared helpers for the benchmarks in this directory.
+//A Timer, the table layout also used by harness.h, and barriers so the optimiser
+//cannot drop a result that is only computed to be timed.
+#pragma once
+#include <chrono>
+#include <initializer_list>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace bench{
+    using namespace std::chrono;
+
+    class Timer {
+        steady_clock::time_point start;
+    public:
+        Timer() : start(steady_clock::now()) {}
+
+        double elapsed_ms() {
+            auto end = steady_clock::now();
+            return duration_cast<nanoseconds>(end - start).count() / 1000000.0;
+        }
+
+        void reset() {
+            start = steady_clock::now();
+        }
+    };
+
+    //force the compiler to materialise `value`
+    template<class T>
+    inline void keep(const T& value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    //force the compiler to assume all memory was read and written here
+    inline void clobber() {
+        asm volatile("" : : : "memory");
+    }
+
+    //time `fn` `reps` times and return the fastest run in ms
+    template<class Fn>
+    double best_of(int reps, Fn&& fn) {
+        double best = 0;
+        for(int r = 0; r < reps; ++r) {
+            Timer t;
+            fn();
+            double ms = t.elapsed_ms();
+            if(r == 0 || ms < best) best = ms;
+        }
+        return best;
+    }
+
+    inline void print_header(const std::string& test_name, std::initializer_list<const char*> columns) {
+        std::size_t width = 30 + 12 * columns.size();
+        std::cout << "\n" << std::string(width, '=') << "\n";
+        std::cout << test_name << "\n";
+        std::cout << std::string(width, '=') << "\n";
+        std::cout << std::left << std::setw(30) << "Operation";
+        for(const char* c : columns) std::cout << std::setw(12) << c;
+        std::cout << "\n" << std::string(width, '-') << "\n";
+    }
+
+    //negative values are printed as "-" (e.g. an instruction set the CPU lacks);
+    //a note goes after the last column
+    inline void print_row(const std::string& op, std::initializer_list<double> values, const std::string& note = "") {
+        std::cout << std::left << std::setw(30) << op;
+        for(double v : values) {
+            if(v < 0) std::cout << std::setw(12) << "-";
+            else std::cout << std::setw(12) << std::fixed << std::setprecision(3) << v;
+        }
+        std::cout << note << "\n";
+    }
+}
@@ -0,0 +1,121 @@
+//Benchmark for ext/cow_vector.h against vector copies in copy-heavy call graphs.
+//
+//The use case is a routing table passed by value through layers of code that
+//mostly only read it. Each "call graph" row walks a tree of calls `depth` deep with
+//`fanout` children per call; every call takes the table by value, and every leaf
+//looks up a few routes. One leaf in `edit_every` also changes one route in its copy,
+//which is where cow_vector pays for its single detaching copy.
+//  call graph (read only)     no leaf edits
+//  call graph (1/64 edit)     every 64th leaf edits its copy
+//  call graph (all edit)      every leaf edits: the worst case, one copy per leaf
+//and, on a single table:
+//  copy (x10000)              copy constructor alone
+//  read (operator[])          random lookups, to show reads cost the same
+//
+//build: g++ -std=c++20 -O2 -I.. cow_vector.cpp -o cow_vector
+//usage: ./cow_vector [routes, default 4096] [depth, default 4] [fanout, default 8]
+#include "../ext/cow_vector.h"
+#include "bench_util.h"
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+namespace {
+    struct route {
+        std::uint32_t prefix;
+        std::uint32_t mask;
+        std::uint32_t next_hop;
+        std::uint32_t metric;
+    };
+
+    int depth = 4;
+    int fanout = 8;
+    std::uint64_t leaf_counter = 0;
+
+    std::uint32_t lookup(const route* r, std::size_t n, std::uint32_t key) {
+        std::uint32_t hop = 0;
+        for(int i = 0; i < 4; ++i) {
+            const route& e = r[(key + i * 2654435761u) % n];
+            if((key & e.mask) == e.prefix) hop = e.next_hop;
+            hop += e.metric;
+        }
+        return hop;
+    }
+
+    //the table is taken by value on purpose: that copy is what is being measured
+    std::uint32_t walk(std::vector<route> table, int level, int edit_every) {
+        if(level == depth) {
+            const std::uint64_t leaf = leaf_counter++;
+            if(edit_every && leaf % edit_every == 0) table[leaf % table.size()].metric += 1;
+            return lookup(table.data(), table.size(), static_cast<std::uint32_t>(leaf));
+        }
+        std::uint32_t acc = 0;
+        for(int c = 0; c < fanout; ++c) acc += walk(table, level + 1, edit_every);
+        return acc;
+    }
+
+    std::uint32_t walk(ext::cow_vector<route> table, int level, int edit_every) {
+        if(level == depth) {
+            const std::uint64_t leaf = leaf_counter++;
+            if(edit_every && leaf % edit_every == 0) {
+                const std::size_t i = leaf % table.size();
+                route r = table[i];
+                r.metric += 1;
+                table.set(i, r);
+            }
+            return lookup(table.data(), table.size(), static_cast<std::uint32_t>(leaf));
+        }
+        std::uint32_t acc = 0;
+        for(int c = 0; c < fanout; ++c) acc += walk(table, level + 1, edit_every);
+        return acc;
+    }
+}
+
+int main(int argc, char** argv) {
+    const std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4096;
+    depth = argc > 2 ? std::atoi(argv[2]) : 4;
+    fanout = argc > 3 ? std::atoi(argv[3]) : 8;
+
+    std::vector<route> base(n);
+    for(std::size_t i = 0; i < n; ++i)
+        base[i] = {static_cast<std::uint32_t>(i << 8), 0xffffff00u, static_cast<std::uint32_t>(i % 61), static_cast<std::uint32_t>(i % 7)};
+    const ext::cow_vector<route> cbase(base);
+
+    bench::print_header("COW VECTOR: " + std::to_string(n) + " routes, depth " + std::to_string(depth) +
+                        ", fanout " + std::to_string(fanout) + " (ms)",
+                        {"vector", "cow_vector", "speedup"});
+
+    auto row = [](const std::string& op, double vec, double cow) {
+        bench::print_row(op, {vec, cow, vec / cow});
+    };
+
+    for(int edit_every : {0, 64, 1}) {
+        const std::string name = edit_every == 0 ? "call graph (read only)"
+                               : edit_every == 1 ? "call graph (all edit)"
+                               : "call graph (1/" + std::to_string(edit_every) + " edit)";
+        row(name, bench::best_of(3, [&]{
+            leaf_counter = 0;
+            bench::keep(walk(base, 0, edit_every));
+        }), bench::best_of(3, [&]{
+            leaf_counter = 0;
+            bench::keep(walk(cbase, 0, edit_every));
+        }));
+    }
+
+    row("copy (x10000)", bench::best_of(3, [&]{
+        for(int i = 0; i < 10000; ++i) { std::vector<route> c(base); bench::keep(c.data()); }
+    }), bench::best_of(3, [&]{
+        for(int i = 0; i < 10000; ++i) { ext::cow_vector<route> c(cbase); bench::keep(c.data()); }
+    }));
+
+    row("read (operator[])", bench::best_of(3, [&]{
+        std::uint32_t sum = 0;
+        for(std::size_t i = 0, j = 0; i < 16 * n; ++i, j = (j + 7919) % n) sum += base[j].next_hop;
+        bench::keep(sum);
+    }), bench::best_of(3, [&]{
+        std::uint32_t sum = 0;
+        for(std::size_t i = 0, j = 0; i < 16 * n; ++i, j = (j + 7919) % n) sum += cbase[j].next_hop;
+        bench::keep(sum);
+    }));
+    return 0;
+}
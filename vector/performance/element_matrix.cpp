@@ -0,0 +1,315 @@
+//Every core operation across a matrix of element types, on performance/harness.h.
+//
+//  int, pod64, 1KiB object  trivially copyable: relocated with memmove
+//  string sso/heap          std::string of 6-7 chars (in place) or 48 (allocated)
+//  unique_ptr               move-only
+//  throwing move            a heap string whose move constructor is not noexcept,
+//                           so reallocation copies it (move_if_noexcept in vector.h)
+//
+//After each row come the element moves and copies per n that one untimed run of the
+//same operation made on counted<T>, which counts into __gnu_test::counter_type
+//(testsuite_counter_type.h). counted<T> is never trivially copyable, so for the
+//memmove types these are the relocations that memmove did.
+//1KiB objects are capped at 32 MiB of elements per vector.
+//
+//build: g++ -std=c++20 -O2 -I.. -I../../testsuite_util element_matrix.cpp -o element_matrix
+//usage: ./element_matrix [--xml] [--max-samples=N] [--max-ms=N] [--min-sample-us=N] [--filter=substring]
+//       [--baseline=FILE] [--update-baseline] [--tolerance=PCT]
+//       (rows are named operation/type, so --filter=unique_ptr selects one column of the matrix)
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include "../vector.h"
+#include "harness.h"
+#include <testsuite_counter_type.h>
+
+namespace {
+    using __gnu_test::counter_type;
+
+    struct pod64{
+        long v[8];
+    };
+
+    struct big_object{
+        long v[128];
+    };
+
+    struct throwing_move{
+        std::string s;
+
+        explicit throwing_move(std::string str) : s(std::move(str)){}
+        throwing_move(const throwing_move&) = default;
+        throwing_move(throwing_move&& other) noexcept(false) : s(std::move(other.s)){}
+        throwing_move& operator=(const throwing_move&) = default;
+        throwing_move& operator=(throwing_move&&) = default;
+    };
+
+    //T whose copies and moves are counted; copyable and nothrow-movable exactly when T is
+    template<class T>
+    struct counted{
+        T value;
+
+        explicit counted(T v) : value(std::move(v)){}
+
+        counted(const counted& other) requires std::is_copy_constructible_v<T> : value(other.value){
+            ++counter_type::copy_count;
+        }
+
+        counted(counted&& other) noexcept(std::is_nothrow_move_constructible_v<T>) : value(std::move(other.value)){
+            ++counter_type::move_count;
+        }
+
+        counted& operator=(const counted& other) requires std::is_copy_assignable_v<T>{
+            value = other.value;
+            ++counter_type::copy_assign_count;
+            return *this;
+        }
+
+        counted& operator=(counted&& other) noexcept(std::is_nothrow_move_assignable_v<T>){
+            value = std::move(other.value);
+            ++counter_type::move_assign_count;
+            return *this;
+        }
+    };
+
+    //a column of the matrix: the element type, how to make the i-th one and a value to read from it
+    struct int_case{
+        using type = int;
+        static constexpr const char* name = "int";
+        static type make(std::size_t i){ return static_cast<int>(i); }
+        static long key(const type& v){ return v; }
+    };
+
+    struct pod64_case{
+        using type = pod64;
+        static constexpr const char* name = "pod64";
+        static type make(std::size_t i){ return {{static_cast<long>(i)}}; }
+        static long key(const type& v){ return v.v[0]; }
+    };
+
+    struct string_sso_case{
+        using type = std::string;
+        static constexpr const char* name = "string sso";
+        static type make(std::size_t i){ return std::to_string(i % 10000000); }
+        static long key(const type& v){ return static_cast<long>(v.size()); }
+    };
+
+    struct string_heap_case{
+        using type = std::string;
+        static constexpr const char* name = "string heap";
+        static type make(std::size_t i){ return std::string(40, 'x') + std::to_string(10000000 + i % 10000000); }
+        static long key(const type& v){ return static_cast<long>(v.size()); }
+    };
+
+    struct unique_ptr_case{
+        using type = std::unique_ptr<long>;
+        static constexpr const char* name = "unique_ptr";
+        static type make(std::size_t i){ return std::make_unique<long>(static_cast<long>(i)); }
+        static long key(const type& v){ return *v; }
+    };
+
+    struct throwing_move_case{
+        using type = throwing_move;
+        static constexpr const char* name = "throwing move";
+        static type make(std::size_t i){ return type(string_heap_case::make(i)); }
+        static long key(const type& v){ return static_cast<long>(v.s.size()); }
+    };
+
+    struct big_object_case{
+        using type = big_object;
+        static constexpr const char* name = "1KiB object";
+        static type make(std::size_t i){ return {{static_cast<long>(i)}}; }
+        static long key(const type& v){ return v.v[0]; }
+    };
+
+    template<class Case>
+    struct counted_case{
+        using type = counted<typename Case::type>;
+        static type make(std::size_t i){ return type(Case::make(i)); }
+        static long key(const type& v){ return Case::key(v.value); }
+    };
+
+    template<class Case>
+    using vector_of = std::vector<typename Case::type>;
+
+    template<class Case>
+    vector_of<Case> filled(std::size_t n, std::size_t spare = 0){
+        vector_of<Case> v;
+        v.reserve(n + spare);
+        for(std::size_t i = 0; i < n; ++i) v.push_back(Case::make(i));
+        return v;
+    }
+
+    /*
+        An operation is a struct with
+            fresh       whether each call needs a new state (then setup is untimed)
+            setup<C>(n) the state, e.g. a filled vector
+            body<C>(state, n)
+            applies<C>  false where the type cannot do it (copying a unique_ptr)
+    */
+    struct push_back_op{
+        static constexpr const char* name = "push_back";
+        static constexpr bool fresh = false;
+        template<class C> static constexpr bool applies = true;
+        template<class C> static int setup(std::size_t){ return 0; }
+        template<class C> static void body(int, std::size_t n){
+            vector_of<C> v;
+            for(std::size_t i = 0; i < n; ++i) v.push_back(C::make(i));
+            bench::keep(v.data());
+        }
+    };
+
+    struct reserve_op{
+        static constexpr const char* name = "reserve";
+        static constexpr bool fresh = false;
+        template<class C> static constexpr bool applies = true;
+        template<class C> static int setup(std::size_t){ return 0; }
+        template<class C> static void body(int, std::size_t n){
+            vector_of<C> v;
+            v.reserve(n);
+            for(std::size_t i = 0; i < n; ++i) v.push_back(C::make(i));
+            bench::keep(v.data());
+        }
+    };
+
+    struct insert_begin_op{
+        static constexpr const char* name = "insert begin";
+        static constexpr bool fresh = false;
+        template<class C> static constexpr bool applies = true;
+        template<class C> static int setup(std::size_t){ return 0; }
+        template<class C> static void body(int, std::size_t n){
+            vector_of<C> v;
+            for(std::size_t i = 0; i < n; ++i) v.insert(v.begin(), C::make(i));
+            bench::keep(v.data());
+        }
+    };
+
+    //n inserts into the middle of 10000 elements, with room reserved
+    struct insert_middle_op{
+        static constexpr const char* name = "insert mid";
+        static constexpr bool fresh = true;
+        template<class C> static constexpr bool applies = true;
+        template<class C> static vector_of<C> setup(std::size_t n){ return filled<C>(10000, n); }
+        template<class C> static void body(vector_of<C>& v, std::size_t n){
+            for(std::size_t i = 0; i < n; ++i) v.insert(v.begin() + v.size() / 2, C::make(i));
+            bench::keep(v.data());
+        }
+    };
+
+    //n erases from the middle of 10000 + n elements
+    struct erase_middle_op{
+        static constexpr const char* name = "erase mid";
+        static constexpr bool fresh = true;
+        template<class C> static constexpr bool applies = true;
+        template<class C> static vector_of<C> setup(std::size_t n){ return filled<C>(10000 + n); }
+        template<class C> static void body(vector_of<C>& v, std::size_t n){
+            for(std::size_t i = 0; i < n; ++i) v.erase(v.begin() + v.size() / 2);
+            bench::keep(v.data());
+        }
+    };
+
+    struct pop_back_op{
+        static constexpr const char* name = "pop_back";
+        static constexpr bool fresh = true;
+        template<class C> static constexpr bool applies = true;
+        template<class C> static vector_of<C> setup(std::size_t n){ return filled<C>(n); }
+        template<class C> static void body(vector_of<C>& v, std::size_t){
+            while(!v.empty()) v.pop_back();
+            bench::keep(v.data());
+        }
+    };
+
+    struct copy_op{
+        static constexpr const char* name = "copy";
+        static constexpr bool fresh = false;
+        template<class C> static constexpr bool applies = std::is_copy_constructible_v<typename C::type>;
+        template<class C> static vector_of<C> setup(std::size_t n){ return filled<C>(n); }
+        template<class C> static void body(const vector_of<C>& v, std::size_t){
+            vector_of<C> copy = v;
+            bench::keep(copy.data());
+        }
+    };
+
+    //a move construction and a move assignment back; n is the size of the vector
+    struct move_op{
+        static constexpr const char* name = "move";
+        static constexpr bool fresh = false;
+        template<class C> static constexpr bool applies = true;
+        template<class C> static vector_of<C> setup(std::size_t n){ return filled<C>(n); }
+        template<class C> static void body(vector_of<C>& v, std::size_t){
+            vector_of<C> moved = std::move(v);
+            bench::keep(moved.data());
+            v = std::move(moved);
+        }
+    };
+
+    struct iterate_op{
+        static constexpr const char* name = "iterate";
+        static constexpr bool fresh = false;
+        template<class C> static constexpr bool applies = true;
+        template<class C> static vector_of<C> setup(std::size_t n){ return filled<C>(n); }
+        template<class C> static void body(const vector_of<C>& v, std::size_t){
+            long sum = 0;
+            for(const auto& e : v) sum += C::key(e);
+            bench::keep(sum);
+        }
+    };
+
+    template<class Op, class Case>
+    void row(bench::harness& h, std::size_t n){
+        if constexpr(Op::template applies<Case>){
+            n = std::min(n, (std::size_t(32) << 20) / sizeof(typename Case::type));
+
+            //one untimed run on counted elements for the note
+            {
+                auto state = Op::template setup<counted_case<Case>>(n);
+                counter_type::reset();
+                Op::template body<counted_case<Case>>(state, n);
+                const double moves = counter_type::move_count + counter_type::move_assign_count;
+                const double copies = counter_type::copy_count + counter_type::copy_assign_count;
+                char note[64];
+                std::snprintf(note, sizeof(note), "%.2f moves %.2f copies /n", moves / n, copies / n);
+                h.annotate(note);
+            }
+
+            const std::string name = std::string(Op::name) + "/" + Case::name;
+            if constexpr(Op::fresh){
+                h.run(name, n, [n]{ return Op::template setup<Case>(n); },
+                      [n](vector_of<Case>& v){ Op::template body<Case>(v, n); });
+            }else{
+                auto state = Op::template setup<Case>(n);
+                h.run(name, n, [&]{ Op::template body<Case>(state, n); });
+            }
+        }
+    }
+
+    template<class Op>
+    void matrix(bench::harness& h, const std::string& title, std::size_t n){
+        h.section(title);
+        row<Op, int_case>(h, n);
+        row<Op, pod64_case>(h, n);
+        row<Op, string_sso_case>(h, n);
+        row<Op, string_heap_case>(h, n);
+        row<Op, unique_ptr_case>(h, n);
+        row<Op, throwing_move_case>(h, n);
+        row<Op, big_object_case>(h, n);
+    }
+}
+
+int main(int argc, char** argv){
+    bench::harness h(argc, argv);
+
+    matrix<push_back_op>(h, "PUSH_BACK", 100000);
+    matrix<reserve_op>(h, "RESERVE + PUSH_BACK", 100000);
+    matrix<insert_begin_op>(h, "INSERT AT BEGIN", 1000);
+    matrix<insert_middle_op>(h, "INSERT IN MIDDLE OF 10000", 1000);
+    matrix<erase_middle_op>(h, "ERASE FROM MIDDLE OF 10000 + n", 1000);
+    matrix<pop_back_op>(h, "POP_BACK", 100000);
+    matrix<copy_op>(h, "COPY CONSTRUCTOR", 100000);
+    matrix<move_op>(h, "MOVE (construct + assign back)", 100000);
+    matrix<iterate_op>(h, "ITERATION", 100000);
+
+    return h.finish();
+}
@@ -0,0 +1,329 @@
+//Repeat-until-confident benchmark harness on top of testsuite_util.
+//
+//harness::run(name, n, body) times body(), which handles n elements (or
+//operations). The body is called once to warm up, then batched until one batch
+//takes at least --min-sample-us, because a single push_back is far below the
+//clock's resolution. Each batch is one sample of steady_clock ns per call,
+//fed to result_recorder until it is ~95% confident that the sample mean is
+//within 10% of the true mean (sample_mean_confidence_checker, 30 samples at
+//least), or until --max-samples or --max-ms run out. The "ci95 %" column is
+//the half-width of that interval; above 10 the row did not converge.
+//
+//A body that needs untimed preparation is passed as run(name, n, setup, body):
+//each sample times one call of body(state) on a fresh state = setup(); setup()
+//and destroying the state are not timed. The body should take well over a
+//microsecond, since each sample then includes one clock read.
+//
+//time_counter and resource_counter bracket the sampling of each row for the
+//user/system CPU split, the heap still held afterwards and major page faults.
+//Their times() clock ticks (usually 10 ms) are too coarse to time samples with.
+//
+//--xml prints the results through performance/io/xml_formatter.hpp instead of
+//the tables, when the harness is destroyed: one <cntnr> per name, one
+//<result x = n y = ns per element> per run of that name, so that a loop over n
+//is a parameter sweep.
+//
+//--baseline=FILE compares every row with the same name and n in FILE (see
+//baseline.h), reports the ones that got significantly slower or hold more heap
+//on stderr, and makes finish() return 1 if there are any, so that main can
+//return it. A FILE that does not exist yet is written with this run;
+//--update-baseline rewrites it after comparing. Rows from a build or machine
+//with another fingerprint are still compared, but do not fail the run.
+//--tolerance=PCT (default 10, the precision rows are sampled to) is how much
+//slower or bigger a row may get.
+//
+//--counters also counts hardware events around the timed calls (perf_counters.h)
+//and prints them per element after each row: cycles, instructions and their
+//ratio (IPC), L1D, last-level cache and dTLB read misses, and branch misses.
+//Events the machine cannot count print as "-"; if it can count none, the run
+//says so once on stderr and goes on without them.
+//
+//build: g++ -std=c++20 -O2 -I.. -I../../testsuite_util <benchmark>.cpp
+//flags: --xml --max-samples=N --max-ms=N --min-sample-us=N --filter=substring
+//       --baseline=FILE --update-baseline --tolerance=PCT --counters
+#pragma once
+#include "baseline.h"
+#include "bench_util.h"
+#include "perf_counters.h"
+#include <testsuite_performance.h>
+#include <statistic/result_recorder.hpp>
+#include <statistic/sample_variance.hpp>
+#include <performance/io/xml_formatter.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+
+namespace bench{
+    struct measurement{
+        double mean_ns;         //per call of the body
+        double ci95;            //half-width of the 95% interval relative to the mean, -1 from one sample
+        double sd_ns;
+        double min_ns;
+        std::size_t samples;
+        std::size_t batch;      //calls per sample
+        double user_ms;
+        double system_ms;
+        long heap_bytes;        //still allocated after sampling
+        long page_faults;
+        double events[perf_counters::count];    //per call of the body, -1 where not counted
+    };
+
+    //a body that is not prepared by anything
+    struct no_setup{
+        int operator()() const noexcept{ return 0; }
+    };
+
+    class harness{
+    public:
+        harness(int argc, char** argv){
+            for(int i = 1; i < argc; ++i){
+                const std::string arg = argv[i];
+                auto value = [&](const char* flag) -> const char*{
+                    const std::size_t len = std::strlen(flag);
+                    return arg.compare(0, len, flag) == 0 && arg.size() > len && arg[len] == '=' ? argv[i] + len + 1 : nullptr;
+                };
+                if(arg == "--xml") m_xml = true;
+                else if(arg == "--update-baseline") m_update_baseline = true;
+                else if(arg == "--counters") m_counters = std::make_unique<perf_counters>();
+                else if(const char* v = value("--max-samples")) m_max_samples = std::strtoull(v, nullptr, 10);
+                else if(const char* v = value("--max-ms")) m_max_ms = std::atof(v);
+                else if(const char* v = value("--min-sample-us")) m_min_sample_us = std::atof(v);
+                else if(const char* v = value("--filter")) m_filter = v;
+                else if(const char* v = value("--baseline")) m_baseline = v;
+                else if(const char* v = value("--tolerance")) m_tolerance = std::atof(v) / 100;
+                else{
+                    std::cerr << "usage: " << argv[0] << " [--xml] [--max-samples=N] [--max-ms=N] [--min-sample-us=N] [--filter=substring]\n"
+                              << "       [--baseline=FILE] [--update-baseline] [--tolerance=PCT] [--counters]\n";
+                    std::exit(2);
+                }
+            }
+            if(m_counters && !m_counters->available()){
+                std::cerr << "counters: perf_event_open failed (" << m_counters->error()
+                          << "); no PMU in this VM or container, or kernel.perf_event_paranoid > 2\n";
+                m_counters.reset();
+            }
+        }
+
+        harness(const harness&) = delete;
+        harness& operator=(const harness&) = delete;
+
+        ~harness(){
+            finish();
+        }
+
+        //write the xml, compare with and update the baseline; 1 if a row regressed,
+        //else 0. Runs once; the destructor calls it if main did not.
+        int finish(){
+            if(m_finished) return m_status;
+            m_finished = true;
+            if(m_xml) write_xml();
+            if(!m_baseline.empty()) m_status = check_baseline();
+            return m_status;
+        }
+
+        //start a table of the following rows; printed with its first row that runs
+        void section(const std::string& title){
+            m_section = title;
+        }
+
+        //text printed after the next row, e.g. counts that go with its timing; --xml leaves it out
+        void annotate(std::string note){
+            m_note = std::move(note);
+        }
+
+        template<class Body>
+        measurement run(const std::string& name, std::size_t n, Body&& body){
+            return run(name, n, no_setup(), [&](int){ body(); });
+        }
+
+        template<class Setup, class Body>
+        measurement run(const std::string& name, std::size_t n, Setup&& setup, Body&& body){
+            if(!m_filter.empty() && name.find(m_filter) == std::string::npos){
+                m_note.clear();
+                return {};
+            }
+            constexpr bool untimed_setup = !std::is_same_v<std::decay_t<Setup>, no_setup>;
+
+            //ns for `batch` calls, setup excluded
+            auto time_batch = [&](std::size_t batch){
+                double ns = 0;
+                if constexpr(untimed_setup){
+                    for(std::size_t b = 0; b < batch; ++b){
+                        auto state = setup();
+                        if(m_counters) m_counters->start();
+                        auto t0 = std::chrono::steady_clock::now();
+                        body(state);
+                        ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+                        if(m_counters) m_counters->stop();
+                        clobber();
+                    }
+                }else{
+                    if(m_counters) m_counters->start();
+                    auto t0 = std::chrono::steady_clock::now();
+                    for(std::size_t b = 0; b < batch; ++b){
+                        body(0);
+                        clobber();
+                    }
+                    ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+                    if(m_counters) m_counters->stop();
+                }
+                return ns;
+            };
+
+            //warm up, then grow the batch until a sample is long enough to time
+            std::size_t batch = 1;
+            for(double ns = time_batch(1); !untimed_setup && ns < m_min_sample_us * 1000 && batch < (std::size_t(1) << 30);){
+                batch = ns > 0 ? std::max(batch * 2, static_cast<std::size_t>(batch * m_min_sample_us * 1200 / ns)) : batch * 2;
+                ns = time_batch(batch);
+            }
+
+            __gnu_test::time_counter time;
+            __gnu_test::resource_counter resource;
+            __gnu_pbds::test::detail::result_recorder<double> recorder;
+            std::vector<double> samples;
+            if(m_counters) m_counters->reset();     //the warm-up is not counted
+            __gnu_test::start_counters(time, resource);
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double, std::milli>(m_max_ms);
+            for(bool confident = false; samples.empty() || (!confident && samples.size() < m_max_samples && std::chrono::steady_clock::now() < deadline);){
+                samples.push_back(time_batch(batch) / batch);
+                confident = recorder.add_result(samples.back());
+            }
+            __gnu_test::stop_counters(time, resource);
+
+            measurement m{};
+            m.mean_ns = recorder.get_sample_mean();
+            const double sd = __gnu_pbds::test::detail::sample_variance(samples.begin(), samples.end(), m.mean_ns);
+            m.ci95 = samples.size() > 1 && m.mean_ns > 0 ? 1.976 * sd / std::sqrt(double(samples.size())) / m.mean_ns : -1;
+            m.sd_ns = samples.size() > 1 ? sd : 0;
+            m.min_ns = *std::min_element(samples.begin(), samples.end());
+            m.samples = samples.size();
+            m.batch = batch;
+            const double ms_per_tick = 1000.0 / ::sysconf(_SC_CLK_TCK);
+            m.user_ms = time.user_time() * ms_per_tick;
+            m.system_ms = time.system_time() * ms_per_tick;
+            m.heap_bytes = resource.allocated_memory();
+            m.page_faults = resource.hard_page_fault();
+            for(int e = 0; e < perf_counters::count; ++e){
+                const double v = m_counters ? m_counters->value(static_cast<perf_counters::event>(e)) : -1;
+                m.events[e] = v < 0 ? -1 : v / (samples.size() * batch);
+            }
+
+            m_results.push_back({name, n, m.mean_ns, m.ci95, m.sd_ns, m.samples, m.heap_bytes});
+            if(!m_xml){
+                if(!m_section.empty()){
+                    print_header(m_section, {"n", "mean us", "ci95 %", "min us", "ns/elem", "samples", "user ms", "sys ms", "heap KB", "faults"});
+                    m_section.clear();
+                }
+                std::ostringstream label;
+                label << std::left << std::setw(30) << name << std::setw(12) << n;
+                print_row(label.str(), {m.mean_ns / 1000, m.ci95 * 100, m.min_ns / 1000, m.mean_ns / (n ? n : 1), double(m.samples),
+                                        m.user_ms, m.system_ms, m.heap_bytes / 1024.0, double(m.page_faults)},
+                                        m_counters ? m_note + counters_note(m, n) : m_note);
+            }
+            m_note.clear();
+            return m;
+        }
+
+    private:
+        //results of the same name form one result set, in order of first appearance
+        void write_xml(){
+            __gnu_pbds::test::xml_test_performance_formatter test("elements", "ns per element");
+            std::vector<bool> done(m_results.size());
+            for(std::size_t i = 0; i < m_results.size(); ++i){
+                if(done[i]) continue;
+                __gnu_pbds::test::xml_result_set_performance_formatter set(m_results[i].name, m_results[i].name);
+                for(std::size_t j = i; j < m_results.size(); ++j){
+                    if(done[j] || m_results[j].name != m_results[i].name) continue;
+                    set.add_res(m_results[j].n, m_results[j].mean_ns / (m_results[j].n ? m_results[j].n : 1));
+                    done[j] = true;
+                }
+            }
+        }
+
+        //"cycles/n 3.10 IPC 2.41 L1D/n 0.012 ..." for the events of one row
+        static std::string counters_note(const measurement& m, std::size_t n){
+            static constexpr const char* labels[perf_counters::count] = {"cycles/n", "instr/n", "L1D/n", "LLC/n", "dTLB/n", "br-miss/n"};
+            const double per = n ? n : 1;
+            std::ostringstream os;
+            os << std::fixed;
+            for(int e = 0; e < perf_counters::count; ++e){
+                if(e == perf_counters::l1d_misses){
+                    const double c = m.events[perf_counters::cycles], i = m.events[perf_counters::instructions];
+                    os << " IPC ";
+                    if(c > 0 && i >= 0) os << std::setprecision(2) << i / c;
+                    else os << "-";
+                }
+                os << (e ? " " : "  ") << labels[e] << ' ';
+                if(m.events[e] < 0) os << "-";
+                else os << std::setprecision(e <= perf_counters::instructions ? 2 : 3) << m.events[e] / per;
+            }
+            return os.str();
+        }
+
+        int check_baseline(){
+            baseline base;
+            if(!base.load(m_baseline)){
+                base.fingerprint = machine_fingerprint();
+                base.merge(m_results);
+                if(!base.save(m_baseline)) std::cerr << "baseline: cannot write " << m_baseline << "\n";
+                else std::cerr << "baseline: wrote " << m_results.size() << " rows to " << m_baseline << "\n";
+                return 0;
+            }
+
+            const std::string fingerprint = machine_fingerprint();
+            const bool comparable = base.fingerprint == fingerprint;
+            const std::vector<regression> found = compare(base, m_results, m_tolerance);
+            std::size_t compared = 0;
+            for(const baseline_row& r : m_results) compared += base.find(r.name, r.n) != nullptr;
+            std::cerr << "baseline: " << compared << " of " << m_results.size() << " rows compared with " << m_baseline
+                      << ", " << found.size() << " regressed\n";
+            if(!comparable){
+                std::cerr << "baseline: recorded on " << base.fingerprint << "\n"
+                          << "          this run on " << fingerprint << "\n"
+                          << "          regressions are reported but do not fail the run\n";
+            }
+            for(const regression& r : found){
+                std::ostringstream line;
+                line << std::fixed << std::setprecision(3) << "  " << (r.memory ? "MORE HEAP " : "SLOWER    ") << r.name << " (n = " << r.n << "): ";
+                if(r.memory) line << r.before / 1024 << " KB -> " << r.after / 1024 << " KB";
+                else line << r.before / 1000 << " us -> " << r.after / 1000 << " us";
+                line << std::setprecision(1) << " (+" << (r.before > 0 ? 100 * (r.after / r.before - 1) : 100.0) << "%";
+                if(r.t > 0) line << ", t = " << r.t;
+                line << ")\n";
+                std::cerr << line.str();
+            }
+
+            if(m_update_baseline){
+                base.fingerprint = fingerprint;
+                base.merge(m_results);
+                if(!base.save(m_baseline)) std::cerr << "baseline: cannot write " << m_baseline << "\n";
+            }
+            return comparable && !found.empty() ? 1 : 0;
+        }
+
+        bool m_xml = false;
+        std::size_t m_max_samples = 300;
+        double m_max_ms = 2000;
+        double m_min_sample_us = 1000;
+        std::string m_filter;
+        std::string m_section;
+        std::string m_note;
+        std::string m_baseline;
+        bool m_update_baseline = false;
+        double m_tolerance = 0.10;
+        bool m_finished = false;
+        int m_status = 0;
+        std::vector<baseline_row> m_results;
+        std::unique_ptr<perf_counters> m_counters;
+    };
+}
@@ -0,0 +1,98 @@
+//Benchmark for ext/ingest.h: reading a file or a pipe into a vector<char>.
+//
+//  buffer + insert            read() 64 KiB at a time into a scratch buffer,
+//                             then v.insert(v.end(), ...) - every byte is copied twice
+//  buffer + insert, reserved  the same with v.reserve(file size) up front
+//  append_from_fd             readv straight into the vector's tail
+//
+//The file runs read from the page cache (it was just written), so they measure
+//memory traffic and reallocation rather than the disk. The pipe runs are fed by a
+//writer thread in 64 KiB writes.
+//
+//build: g++ -std=c++20 -O2 -I.. ingest.cpp -o ingest -pthread
+//usage: ./ingest [size in MB, default 1024] [file, default /tmp/vector_ingest.bin]
+#include "../ext/ingest.h"
+#include "bench_util.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+namespace {
+    constexpr std::size_t buffer_size = 64 * 1024;
+
+    void copy_through(std::vector<char>& v, int fd) {
+        static char buf[buffer_size];
+        ssize_t got;
+        while((got = ::read(fd, buf, sizeof(buf))) > 0) {
+            v.insert(v.end(), buf, buf + got);
+        }
+    }
+
+    template<class Fn>
+    double file_run(const char* path, Fn&& fn) {
+        return bench::best_of(3, [&]{
+            int fd = ::open(path, O_RDONLY);
+            std::vector<char> v;
+            fn(v, fd);
+            bench::keep(v.size());
+            ::close(fd);
+        });
+    }
+
+    template<class Fn>
+    double pipe_run(std::size_t bytes, Fn&& fn) {
+        return bench::best_of(3, [&]{
+            int p[2];
+            if(::pipe(p) != 0) std::abort();
+            std::thread writer([&]{
+                static char block[buffer_size] = {1};
+                for(std::size_t left = bytes; left > 0;) {
+                    ssize_t put = ::write(p[1], block, std::min(left, sizeof(block)));
+                    if(put <= 0) break;
+                    left -= static_cast<std::size_t>(put);
+                }
+                ::close(p[1]);
+            });
+            std::vector<char> v;
+            fn(v, p[0]);
+            bench::keep(v.size());
+            writer.join();
+            ::close(p[0]);
+        });
+    }
+}
+
+int main(int argc, char** argv) {
+    const std::size_t mb = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1024;
+    const char* path = argc > 2 ? argv[2] : "/tmp/vector_ingest.bin";
+    const std::size_t bytes = mb * 1024 * 1024;
+    {
+        std::vector<char> data(bytes, 'x');
+        FILE* f = std::fopen(path, "wb");
+        std::fwrite(data.data(), 1, data.size(), f);
+        std::fclose(f);
+    }
+
+    bench::print_header("FD INGESTION: " + std::to_string(mb) + " MB into vector<char>", {"file (ms)", "pipe (ms)", "file MB/s"});
+
+    auto row = [&](const std::string& op, double file_ms, double pipe_ms) {
+        bench::print_row(op, {file_ms, pipe_ms, mb / (file_ms / 1000.0)});
+    };
+
+    auto plain = [](std::vector<char>& v, int fd) { copy_through(v, fd); };
+    row("buffer + insert", file_run(path, plain), pipe_run(bytes, plain));
+
+    auto reserved = [](std::vector<char>& v, int fd) {
+        struct stat st;
+        if(::fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) v.reserve(st.st_size);
+        copy_through(v, fd);
+    };
+    row("buffer + insert, reserved", file_run(path, reserved), -1);
+
+    auto direct = [](std::vector<char>& v, int fd) { ext::append_from_fd(v, fd); };
+    row("append_from_fd", file_run(path, direct), pipe_run(bytes, direct));
+
+    std::remove(path);
+    return 0;
+}
@@ -0,0 +1,80 @@
+//HDR-style latency histogram for per-operation timings.
+//
+//Values (ns) are counted in log-linear buckets: exactly below 256, and above
+//that in 128 linear steps per power of two, so any value is reported within
+//1/128 (0.8%) of what was recorded, from 1 ns to hours, in a fixed 58 KiB of
+//counters and with no allocation while recording. min, max and the mean are
+//kept exactly. Percentiles report the upper end of the bucket the rank falls
+//in (at most the max), as HdrHistogram does, so a p99 is never understated.
+//
+//    bench::latency_histogram h;
+//    for(...){ auto t0 = clock::now(); op(); h.record(ns since t0); }
+//    h.percentile(99.9);
+#pragma once
+#include "../ext/log_linear_buckets.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace bench{
+    class latency_histogram{
+    public:
+        void record(std::uint64_t value) noexcept{
+            ++m_counts[bucket::index(value)];
+            ++m_count;
+            m_sum += static_cast<double>(value);
+            m_min = std::min(m_min, value);
+            m_max = std::max(m_max, value);
+        }
+
+        //add the counts of another histogram, e.g. of another round
+        void merge(const latency_histogram& other) noexcept{
+            for(std::size_t i = 0; i < buckets; ++i) m_counts[i] += other.m_counts[i];
+            m_count += other.m_count;
+            m_sum += other.m_sum;
+            m_min = std::min(m_min, other.m_min);
+            m_max = std::max(m_max, other.m_max);
+        }
+
+        void reset() noexcept{
+            *this = latency_histogram();
+        }
+
+        [[nodiscard]] std::uint64_t count() const noexcept{ return m_count; }
+        [[nodiscard]] std::uint64_t min() const noexcept{ return m_count ? m_min : 0; }
+        [[nodiscard]] std::uint64_t max() const noexcept{ return m_max; }
+        [[nodiscard]] double mean() const noexcept{ return m_count ? m_sum / m_count : 0; }
+
+        //the value that p percent of the recorded values are at or below, 0 when empty
+        [[nodiscard]] std::uint64_t percentile(double p) const noexcept{
+            if(m_count == 0) return 0;
+            const double wanted = p / 100 * static_cast<double>(m_count);
+            std::uint64_t rank = wanted < 1 ? 1 : static_cast<std::uint64_t>(wanted);
+            if(static_cast<double>(rank) < wanted) ++rank;
+            std::uint64_t seen = 0;
+            for(std::size_t i = 0; i < buckets; ++i){
+                seen += m_counts[i];
+                if(seen >= rank) return std::min(bucket::highest_in(i), m_max);
+            }
+            return m_max;
+        }
+
+        //how many values are above `value` (with the bucket error above)
+        [[nodiscard]] std::uint64_t count_above(std::uint64_t value) const noexcept{
+            std::uint64_t n = 0;
+            for(std::size_t i = bucket::index(value) + 1; i < buckets; ++i) n += m_counts[i];
+            return n;
+        }
+
+    private:
+        using bucket = ext::detail::log_linear_buckets<7>;          //128 steps per power of two, exact below 256
+        static constexpr std::size_t buckets = bucket::count;
+
+        std::uint64_t m_counts[buckets] = {};
+        std::uint64_t m_count = 0;
+        double m_sum = 0;
+        std::uint64_t m_min = std::numeric_limits<std::uint64_t>::max();
+        std::uint64_t m_max = 0;
+    };
+}
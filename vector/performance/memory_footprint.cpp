@@ -0,0 +1,187 @@
+//Memory footprint of building a vector, next to the wall times of performance_test.cpp.
+//
+//Each row builds one vector of n elements in a forked child, so that getrusage's
+//max RSS and fault counts belong to that row alone. The vector allocates through
+//tracker_allocator<T, footprint_allocator<T>>: tracker_allocator (testsuite_allocator.h)
+//sums the bytes requested and released, footprint_allocator counts calls and the
+//bytes held at once.
+//  allocs        allocate() calls
+//  alloc MB      bytes requested over the whole build, old blocks of each growth included
+//  peak/ideal    most bytes held at once over n * sizeof(T); a doubling holds the
+//                old and the new block together, so about 3 at worst
+//  slack %       (capacity - size) / capacity once built
+//  heap KB       resource_counter::allocated_memory, what malloc still holds for it
+//                after the build, malloc's own overhead included
+//  rss KB        growth of the max RSS (ru_maxrss) during the build
+//  minflt/majflt page faults during the build; each new page faults once when touched
+//
+//With -I.., <vector> is this tree's vector; without it, libstdc++'s. Build both and
+//compare the tables:
+//build: g++ -std=c++20 -O2 -I.. -I../../testsuite_util memory_footprint.cpp -o memory_footprint
+//       g++ -std=c++20 -O2 -I../../testsuite_util memory_footprint.cpp -o memory_footprint_std
+#include <vector>
+#include "bench_util.h"
+#include <testsuite_performance.h>
+#include <memory_resource>      //testsuite_allocator.h no longer includes it itself
+#include <testsuite_allocator.h>
+#include <cstdio>
+#include <initializer_list>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+//the counters of tracker_allocator, as in testsuite_allocator.cc, which would also
+//need testsuite_hooks.cc
+namespace __gnu_test{
+    tracker_allocator_counter::size_type tracker_allocator_counter::allocationCount_ = 0;
+    tracker_allocator_counter::size_type tracker_allocator_counter::deallocationCount_ = 0;
+    int tracker_allocator_counter::constructCount_ = 0;
+    int tracker_allocator_counter::destructCount_ = 0;
+}
+
+namespace {
+    //the process only ever runs one build at a time, so plain counters do
+    struct footprint{
+        static inline std::size_t allocations = 0;
+        static inline std::size_t live_bytes = 0;
+        static inline std::size_t peak_bytes = 0;
+    };
+
+    template<class T>
+    struct footprint_allocator{
+        using value_type = T;
+
+        footprint_allocator() = default;
+        template<class U>
+        footprint_allocator(const footprint_allocator<U>&) noexcept{}
+
+        T* allocate(std::size_t n){
+            T* p = std::allocator<T>().allocate(n);
+            ++footprint::allocations;
+            footprint::live_bytes += n * sizeof(T);
+            if(footprint::live_bytes > footprint::peak_bytes) footprint::peak_bytes = footprint::live_bytes;
+            return p;
+        }
+
+        void deallocate(T* p, std::size_t n) noexcept{
+            footprint::live_bytes -= n * sizeof(T);
+            std::allocator<T>().deallocate(p, n);
+        }
+
+        friend bool operator==(const footprint_allocator&, const footprint_allocator&) noexcept{ return true; }
+    };
+
+    template<class T>
+    using tracked_vector = std::vector<T, __gnu_test::tracker_allocator<T, footprint_allocator<T>>>;
+
+    //64 bytes, so that slack costs more than it does for int
+    struct record{
+        long key;
+        double values[7];
+    };
+
+    constexpr const char* implementation =
+#if __has_include(<vector.h>)
+        "this tree's vector";
+#else
+        "libstdc++ std::vector";
+#endif
+
+    //build(n) returns the vector to measure; it is measured alive, then destroyed
+    template<class Build>
+    void measure(const std::string& name, std::size_t n, Build build){
+        std::cout.flush();
+        const pid_t pid = ::fork();
+        if(pid < 0){
+            std::perror("fork");
+            return;
+        }
+        if(pid > 0){
+            ::waitpid(pid, nullptr, 0);
+            return;
+        }
+
+        using counter = __gnu_test::tracker_allocator_counter;
+        counter::reset();
+        __gnu_test::resource_counter resource;
+        rusage before{}, after{};
+        ::getrusage(RUSAGE_SELF, &before);
+        resource.start();
+        double slack, elem_size;
+        {
+            auto v = build(n);
+            bench::keep(v.data());
+            resource.stop();
+            ::getrusage(RUSAGE_SELF, &after);
+            slack = v.capacity() ? double(v.capacity() - v.size()) / v.capacity() : 0;
+            elem_size = sizeof(*v.data());
+        }
+
+        std::ostringstream label;
+        label << std::left << std::setw(30) << name << std::setw(12) << n;
+        bench::print_row(label.str(), {double(footprint::allocations), counter::get_allocation_count() / 1048576.0,
+                                       footprint::peak_bytes / (n * elem_size), slack * 100,
+                                       resource.allocated_memory() / 1024.0, double(after.ru_maxrss - before.ru_maxrss),
+                                       double(after.ru_minflt - before.ru_minflt), double(after.ru_majflt - before.ru_majflt)});
+        if(counter::get_deallocation_count() != counter::get_allocation_count() || footprint::live_bytes != 0)
+            std::cout << "  leaked " << counter::get_allocation_count() - counter::get_deallocation_count() << " bytes\n";
+        std::cout.flush();
+        ::_exit(0);
+    }
+
+    void section(const std::string& title){
+        bench::print_header(title + " (" + implementation + ")",
+                            {"n", "allocs", "alloc MB", "peak/ideal", "slack %", "heap KB", "rss KB", "minflt", "majflt"});
+    }
+
+    template<class T>
+    T make(std::size_t i){
+        if constexpr(std::is_same_v<T, int>) return static_cast<int>(i);
+        else return T{static_cast<long>(i), {}};
+    }
+
+    template<class T>
+    void growth(const std::string& type, std::initializer_list<std::size_t> sizes){
+        section("GROWTH: vector<" + type + ">");
+        for(std::size_t n : sizes){
+            measure("push_back", n, [](std::size_t n){
+                tracked_vector<T> v;
+                for(std::size_t i = 0; i < n; ++i) v.push_back(make<T>(i));
+                return v;
+            });
+            measure("reserve + push_back", n, [](std::size_t n){
+                tracked_vector<T> v;
+                v.reserve(n);
+                for(std::size_t i = 0; i < n; ++i) v.push_back(make<T>(i));
+                return v;
+            });
+            measure("push_back + shrink_to_fit", n, [](std::size_t n){
+                tracked_vector<T> v;
+                for(std::size_t i = 0; i < n; ++i) v.push_back(make<T>(i));
+                v.shrink_to_fit();
+                return v;
+            });
+            //16 ranges of n / 16 into the middle: growth driven by range insert
+            measure("insert 16 ranges at middle", n, [](std::size_t n){
+                tracked_vector<T> v;
+                std::vector<T> chunk;
+                for(std::size_t i = 0; i < n / 16; ++i) chunk.push_back(make<T>(i));
+                for(int r = 0; r < 16; ++r) v.insert(v.begin() + v.size() / 2, chunk.begin(), chunk.end());
+                return v;
+            });
+            measure("resize", n, [](std::size_t n){
+                tracked_vector<T> v;
+                v.resize(n);
+                return v;
+            });
+        }
+    }
+}
+
+int main(){
+    growth<int>("int", {1000, 100000, 1000000, 10000000});
+    growth<record>("64-byte record", {1000, 100000, 1000000});
+    return 0;
+}
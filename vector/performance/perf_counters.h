@@ -0,0 +1,105 @@
+//Hardware performance counters for the benchmarks, through Linux perf_event_open.
+//
+//perf_counters opens cycles, instructions, L1D read misses, last-level cache
+//misses, dTLB read misses and branch misses for this thread, user space only.
+//Each event is opened on its own, so one the CPU or hypervisor lacks leaves the
+//others working; in a container or VM without a PMU, or with
+//kernel.perf_event_paranoid above 2, none opens and available() is false.
+//When the kernel multiplexes more events than the PMU has counters, counts are
+//scaled by the time each event was actually counting.
+//
+//    bench::perf_counters c;
+//    c.start(); work(); c.stop();
+//    c.value(bench::perf_counters::instructions);   //-1 if that event is missing
+#pragma once
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace bench{
+    class perf_counters{
+    public:
+        enum event{ cycles, instructions, l1d_misses, llc_misses, dtlb_misses, branch_misses, count };
+
+        static constexpr const char* names[count] = {"cycles", "instructions", "L1D misses", "LLC misses", "dTLB misses", "branch misses"};
+
+        perf_counters(){
+            static constexpr std::uint64_t cache_read_miss =
+                (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            static constexpr struct{ std::uint32_t type; std::uint64_t config; } events[count] = {
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+                {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | cache_read_miss},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+                {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | cache_read_miss},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            };
+            for(int e = 0; e < count; ++e){
+                perf_event_attr attr{};
+                attr.size = sizeof(attr);
+                attr.type = events[e].type;
+                attr.config = events[e].config;
+                attr.disabled = 1;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+                m_fd[e] = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+                if(m_fd[e] < 0 && m_error.empty()) m_error = std::strerror(errno);
+            }
+        }
+
+        perf_counters(const perf_counters&) = delete;
+        perf_counters& operator=(const perf_counters&) = delete;
+
+        ~perf_counters(){
+            for(int fd : m_fd){
+                if(fd >= 0) ::close(fd);
+            }
+        }
+
+        [[nodiscard]] bool available() const noexcept{
+            for(int fd : m_fd){
+                if(fd >= 0) return true;
+            }
+            return false;
+        }
+
+        //why the first event that failed did not open, empty if all did
+        [[nodiscard]] const std::string& error() const noexcept{ return m_error; }
+
+        //zero the counts; following start()/stop() pairs add up
+        void reset() noexcept{
+            for(int fd : m_fd){
+                if(fd >= 0) ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            }
+        }
+
+        void start() noexcept{
+            for(int fd : m_fd){
+                if(fd >= 0) ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+
+        void stop() noexcept{
+            for(int fd : m_fd){
+                if(fd >= 0) ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+
+        //the count since reset(), -1 for an event that is not available or never ran
+        [[nodiscard]] double value(event e) const noexcept{
+            std::uint64_t v[3];     //value, time enabled, time running
+            if(m_fd[e] < 0 || ::read(m_fd[e], v, sizeof(v)) != static_cast<ssize_t>(sizeof(v)) || v[2] == 0) return -1;
+            return static_cast<double>(v[0]) * static_cast<double>(v[1]) / static_cast<double>(v[2]);
+        }
+
+    private:
+        int m_fd[count];
+        std::string m_error;
+    };
+}
@@ -0,0 +1,100 @@
+//Benchmark for ext/persistent_vector.h against full vector copies.
+//
+//The use case is handing the same large vector<int> to many readers as snapshots,
+//with occasional edits between snapshots. Each row does `snapshots` times:
+//  snapshot           take a snapshot (vector: copy constructor, persistent: copy)
+//  snapshot + set     take a snapshot and change one element of it
+//  snapshot + push    take a snapshot and append one element to it
+//  slice half         the middle half as its own vector / version
+//and, once over the whole vector:
+//  build (push_back)  append n elements one at a time
+//  read (operator[])  random reads, the price of the trie on the read side
+//  iterate            sequential sum
+//
+//build: g++ -std=c++20 -O2 -I.. persistent_vector.cpp -o persistent_vector
+//usage: ./persistent_vector [elements, default 1000000] [snapshots, default 200]
+#include "../ext/persistent_vector.h"
+#include "bench_util.h"
+#include <cstdlib>
+#include <string>
+
+int main(int argc, char** argv) {
+    const std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const int snapshots = argc > 2 ? std::atoi(argv[2]) : 200;
+
+    std::vector<int> base(n);
+    for(std::size_t i = 0; i < n; ++i) base[i] = static_cast<int>(i);
+    const ext::persistent_vector<int> pbase(base);
+
+    bench::print_header("PERSISTENT VECTOR: " + std::to_string(n) + " ints, " + std::to_string(snapshots) + " snapshots (ms)",
+                        {"vector", "persistent", "transient", "speedup"});
+
+    auto row = [](const std::string& op, double vec, double per, double tr = -1) {
+        bench::print_row(op, {vec, per, tr, vec / per});
+    };
+
+    row("snapshot", bench::best_of(3, [&]{
+        for(int s = 0; s < snapshots; ++s) { std::vector<int> c(base); bench::keep(c.data()); }
+    }), bench::best_of(3, [&]{
+        for(int s = 0; s < snapshots; ++s) { ext::persistent_vector<int> c(pbase); bench::keep(c.size()); }
+    }));
+
+    row("snapshot + set", bench::best_of(3, [&]{
+        for(int s = 0; s < snapshots; ++s) { std::vector<int> c(base); c[s * 7919 % n] = -1; bench::keep(c.data()); }
+    }), bench::best_of(3, [&]{
+        for(int s = 0; s < snapshots; ++s) { auto c = pbase.set(s * 7919 % n, -1); bench::keep(c.size()); }
+    }));
+
+    row("snapshot + push", bench::best_of(3, [&]{
+        for(int s = 0; s < snapshots; ++s) { std::vector<int> c(base); c.push_back(s); bench::keep(c.data()); }
+    }), bench::best_of(3, [&]{
+        for(int s = 0; s < snapshots; ++s) { auto c = pbase.push_back(s); bench::keep(c.size()); }
+    }));
+
+    row("slice half", bench::best_of(3, [&]{
+        for(int s = 0; s < snapshots; ++s) { std::vector<int> c(base.begin() + n / 4, base.begin() + 3 * n / 4); bench::keep(c.data()); }
+    }), bench::best_of(3, [&]{
+        for(int s = 0; s < snapshots; ++s) { auto c = pbase.slice(n / 4, 3 * n / 4); bench::keep(c.size()); }
+    }));
+
+    row("build (push_back)", bench::best_of(3, [&]{
+        std::vector<int> v;
+        for(std::size_t i = 0; i < n; ++i) v.push_back(static_cast<int>(i));
+        bench::keep(v.data());
+    }), bench::best_of(3, [&]{
+        ext::persistent_vector<int> v;
+        for(std::size_t i = 0; i < n; ++i) v = v.push_back(static_cast<int>(i));
+        bench::keep(v.size());
+    }), bench::best_of(3, [&]{
+        ext::transient_vector<int> t;
+        for(std::size_t i = 0; i < n; ++i) t.push_back(static_cast<int>(i));
+        auto v = t.persistent();
+        bench::keep(v.size());
+    }));
+
+    row("read (operator[])", bench::best_of(3, [&]{
+        long sum = 0;
+        for(std::size_t i = 0, j = 0; i < n; ++i, j = (j + 7919) % n) sum += base[j];
+        bench::keep(sum);
+    }), bench::best_of(3, [&]{
+        long sum = 0;
+        for(std::size_t i = 0, j = 0; i < n; ++i, j = (j + 7919) % n) sum += pbase[j];
+        bench::keep(sum);
+    }));
+
+    row("iterate", bench::best_of(3, [&]{
+        long sum = 0;
+        for(int x : base) sum += x;
+        bench::keep(sum);
+    }), bench::best_of(3, [&]{
+        long sum = 0;
+        for(int x : pbase) sum += x;
+        bench::keep(sum);
+    }));
+
+    row("to_vector", -1, bench::best_of(3, [&]{
+        auto v = pbase.to_vector();
+        bench::keep(v.data());
+    }));
+    return 0;
+}
@@ -0,0 +1,82 @@
+//Benchmark for ext/arena.h: vectors that live for one request.
+//
+//Each request builds a few vector<int> one after another by push_back (no reserve),
+//the way a handler collects ids or offsets, sums them and is done. Arena-backed
+//requests get a fresh arena whose chunks come from a counting upstream resource,
+//so the table also shows how much memory one request consumed.
+//
+//  std::allocator        new/delete for every growth step
+//  monotonic             std::pmr::monotonic_buffer_resource: every growth
+//                        abandons the old block in the arena
+//  bump_arena            ext::bump_arena: growth of the latest allocation is in place
+//
+//build: g++ -std=c++20 -O2 -I.. pmr_arena.cpp -o pmr_arena
+#include "../ext/arena.h"
+#include "bench_util.h"
+#include <string>
+
+namespace {
+    constexpr int vectors_per_request = 4;
+
+    //upstream that counts what the arenas ask for
+    class counting_resource : public std::pmr::memory_resource {
+    public:
+        std::size_t bytes = 0;
+    private:
+        void* do_allocate(std::size_t n, std::size_t align) override {
+            bytes += n;
+            return std::pmr::new_delete_resource()->allocate(n, align);
+        }
+        void do_deallocate(void* p, std::size_t n, std::size_t align) override {
+            std::pmr::new_delete_resource()->deallocate(p, n, align);
+        }
+        bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override { return this == &o; }
+    };
+
+    template<class Vec, class... A>
+    long handle_request(int n, A&&... alloc) {
+        long total = 0;
+        for(int k = 0; k < vectors_per_request; ++k) {
+            Vec v(alloc...);
+            for(int i = 0; i < n; ++i) v.push_back(i ^ k);
+            for(int x : v) total += x;
+        }
+        return total;
+    }
+
+    struct result { double ns; double kb; };
+
+    template<class Fn>
+    result run(int requests, Fn&& fn) {
+        counting_resource upstream;
+        double ms = bench::best_of(3, [&]{
+            upstream.bytes = 0;
+            for(int r = 0; r < requests; ++r) bench::keep(fn(upstream));
+        });
+        return {ms * 1e6 / requests, upstream.bytes / 1024.0 / requests};
+    }
+}
+
+int main() {
+    bench::print_header("REQUEST-LIFETIME VECTORS: " + std::to_string(vectors_per_request) + " x vector<int> per request",
+                        {"new (ns)", "mono (ns)", "bump (ns)", "mono (KB)", "bump (KB)"});
+
+    for(int n : {16, 128, 1024, 16384}) {
+        const int requests = 20000000 / (n * vectors_per_request) + 10;
+
+        result heap = run(requests, [&](counting_resource&) {
+            return handle_request<std::vector<int>>(n);
+        });
+        result mono = run(requests, [&](counting_resource& up) {
+            std::pmr::monotonic_buffer_resource arena(4096, &up);
+            return handle_request<std::pmr::vector<int>>(n, &arena);
+        });
+        result bump = run(requests, [&](counting_resource& up) {
+            ext::bump_arena arena(4096, &up);
+            return handle_request<std::pmr::vector<int>>(n, &arena);
+        });
+
+        bench::print_row(std::to_string(n) + " elements each", {heap.ns, mono.ns, bump.ns, mono.kb, bump.kb});
+    }
+    return 0;
+}
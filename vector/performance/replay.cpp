@@ -0,0 +1,288 @@
+//Replays an operation trace (ext/op_trace.h) against several containers.
+//
+//The trace is read and checked up front, then applied once per container and
+//repetition, each container in a forked child so that max RSS is its own:
+//  vector          vector.h with std::allocator
+//  vector + pool   vector.h with ext::pool_allocator
+//  deque           std::deque; reserve() is skipped, it has none
+//Elements are blobs of the recorded sizeof(T) rounded up to a power of two (at
+//most 1 KiB), all zero: a trace keeps the shape of the work, not the values, so
+//element constructors that are not plain copies are not modelled.
+//
+//  best ms       fastest replay of the whole trace
+//  ns/op         best ms per record
+//  allocs        allocate() calls per replay
+//  peak KB       most bytes the containers had asked their allocator for at once
+//  rss KB        growth of the max RSS over the first replay; pool blocks that
+//                ext::pool_allocator keeps cached show here, not in peak KB
+//
+//To try it without a trace of your own, --demo writes one first: a few hundred
+//order books that grow, insert and erase in the middle and get cleared.
+//Another container is one more replay<...>() line in main; it needs default
+//construction, push_back, pop_back, insert(pos, n, value), erase(first, last),
+//resize, clear and shrink_to_fit, and reserve if it has one.
+//
+//build: g++ -std=c++20 -O2 -I.. replay.cpp -o replay
+//usage: ./replay TRACE [--reps=N]
+//       ./replay --demo=TRACE [--reps=N]
+#include "../ext/op_trace.h"
+#include "../ext/thread_pool_allocator.h"
+#include "bench_util.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <optional>
+#include <random>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <tuple>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+    struct counts{
+        static inline std::size_t allocations = 0;
+        static inline std::size_t live_bytes = 0;
+        static inline std::size_t peak_bytes = 0;
+    };
+
+    //Base plus the counts above
+    template<class T, class Base = std::allocator<T>>
+    struct counting_allocator : Base{
+        using value_type = T;
+
+        template<class U>
+        struct rebind{
+            using other = counting_allocator<U, typename std::allocator_traits<Base>::template rebind_alloc<U>>;
+        };
+
+        counting_allocator() = default;
+        template<class U, class B>
+        counting_allocator(const counting_allocator<U, B>& other) noexcept : Base(static_cast<const B&>(other)){}
+
+        T* allocate(std::size_t n){
+            T* p = Base::allocate(n);
+            ++counts::allocations;
+            counts::live_bytes += n * sizeof(T);
+            if(counts::live_bytes > counts::peak_bytes) counts::peak_bytes = counts::live_bytes;
+            return p;
+        }
+
+        void deallocate(T* p, std::size_t n) noexcept{
+            counts::live_bytes -= n * sizeof(T);
+            Base::deallocate(p, n);
+        }
+
+        friend bool operator==(const counting_allocator&, const counting_allocator&) noexcept{ return true; }
+    };
+
+    template<class T>
+    using plain_vector = std::vector<T, counting_allocator<T>>;
+    template<class T>
+    using pool_vector = std::vector<T, counting_allocator<T, ext::pool_allocator<T>>>;
+    template<class T>
+    using plain_deque = std::deque<T, counting_allocator<T>>;
+
+    template<std::size_t N>
+    struct blob{
+        unsigned char bytes[N];
+    };
+
+    constexpr std::size_t blob_sizes[] = {1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024};
+    constexpr std::size_t size_classes = std::size(blob_sizes);
+
+    //a record with the vector's id turned into its size class and slot in that class
+    struct step{
+        ext::op_trace_op op;
+        std::uint8_t cls;
+        std::uint32_t slot;
+        std::uint64_t a;
+        std::uint64_t b;
+    };
+
+    struct plan{
+        std::vector<step> steps;
+        std::size_t slots[size_classes] = {};
+    };
+
+    plan make_plan(const std::vector<ext::op_trace_record>& records){
+        plan p;
+        std::vector<std::pair<std::uint8_t, std::uint32_t>> where;      //by id
+        for(const ext::op_trace_record& r : records){
+            if(r.op == ext::op_trace_op::create){
+                std::size_t cls = 0;
+                while(cls + 1 < size_classes && blob_sizes[cls] < r.a) ++cls;
+                if(r.id >= where.size()) where.resize(r.id + 1);
+                where[r.id] = {static_cast<std::uint8_t>(cls), static_cast<std::uint32_t>(p.slots[cls]++)};
+            }
+            p.steps.push_back({r.op, where[r.id].first, where[r.id].second, r.a, r.b});
+        }
+        return p;
+    }
+
+    template<template<class> class Container>
+    class replayer{
+    public:
+        explicit replayer(const plan& p) : m_plan(p){}
+
+        void run(){
+            resize_pools(std::make_index_sequence<size_classes>());
+            for(const step& s : m_plan.steps) dispatch(s, std::make_index_sequence<size_classes>());
+            clear_pools(std::make_index_sequence<size_classes>());
+        }
+
+    private:
+        template<std::size_t I>
+        using container = Container<blob<blob_sizes[I]>>;
+
+        template<std::size_t... I>
+        void resize_pools(std::index_sequence<I...>){
+            (std::get<I>(m_pools).resize(m_plan.slots[I]), ...);
+        }
+
+        template<std::size_t... I>
+        void clear_pools(std::index_sequence<I...>){
+            (std::get<I>(m_pools).clear(), ...);
+        }
+
+        template<std::size_t... I>
+        void dispatch(const step& s, std::index_sequence<I...>){
+            ((s.cls == I && (apply<I>(s), true)) || ...);
+        }
+
+        template<std::size_t I>
+        void apply(const step& s){
+            using E = blob<blob_sizes[I]>;
+            std::optional<container<I>>& slot = std::get<I>(m_pools)[s.slot];
+            using op = ext::op_trace_op;
+            switch(s.op){
+                case op::create: slot.emplace(); break;
+                case op::destroy: slot.reset(); break;
+                case op::push_back: slot->push_back(E{}); break;
+                case op::pop_back: slot->pop_back(); break;
+                case op::insert: slot->insert(slot->begin() + s.a, s.b, E{}); break;
+                case op::erase: slot->erase(slot->begin() + s.a, slot->begin() + (s.a + s.b)); break;
+                case op::reserve:
+                    if constexpr(requires(container<I>& c){ c.reserve(s.a); }) slot->reserve(s.a);
+                    break;
+                case op::resize: slot->resize(s.a); break;
+                case op::clear: slot->clear(); break;
+                case op::shrink: slot->shrink_to_fit(); break;
+            }
+        }
+
+        template<std::size_t... I>
+        static auto make_pools(std::index_sequence<I...>) -> std::tuple<std::vector<std::optional<container<I>>>...>;
+
+        const plan& m_plan;
+        decltype(make_pools(std::make_index_sequence<size_classes>())) m_pools;
+    };
+
+    template<template<class> class Container>
+    void replay(const char* name, const plan& p, int reps){
+        std::cout.flush();
+        const pid_t pid = ::fork();
+        if(pid < 0){
+            std::perror("fork");
+            return;
+        }
+        if(pid > 0){
+            ::waitpid(pid, nullptr, 0);
+            return;
+        }
+
+        replayer<Container> r(p);
+        rusage before{}, after{};
+        double best = 0;
+        std::size_t allocations = 0, peak = 0;
+        for(int i = 0; i < reps; ++i){
+            counts::allocations = counts::peak_bytes = 0;
+            if(i == 0) ::getrusage(RUSAGE_SELF, &before);
+            bench::Timer t;
+            r.run();
+            const double ms = t.elapsed_ms();
+            if(i == 0){
+                ::getrusage(RUSAGE_SELF, &after);
+                allocations = counts::allocations;
+                peak = counts::peak_bytes;
+            }
+            if(i == 0 || ms < best) best = ms;
+        }
+        bench::print_row(name, {best, best * 1e6 / (p.steps.size() ? p.steps.size() : 1), double(allocations),
+                                peak / 1024.0, double(after.ru_maxrss - before.ru_maxrss)});
+        std::cout.flush();
+        ::_exit(0);
+    }
+
+    struct order{
+        std::uint64_t id;
+        double price;
+        std::uint32_t quantity;
+        std::uint32_t flags;
+    };
+
+    //order books: each grows to a few thousand orders by appends and mid-book
+    //inserts, loses fills from the front and cancels from the middle, then is
+    //cleared for the next session
+    void record_demo(const char* path){
+        ext::start_op_trace(path);
+        std::mt19937 rng(42);
+        {
+            std::vector<ext::recorded_vector<order>> books(300);
+            for(int session = 0; session < 3; ++session){
+                for(auto& book : books){
+                    const std::size_t target = 500 + rng() % 4000;
+                    for(std::size_t i = 0; i < target; ++i){
+                        const std::uint32_t r = rng() % 100;
+                        if(r < 70 || book.size() < 16) book.push_back({i, 100.0, 1, 0});
+                        else if(r < 85) book.insert(book.begin() + rng() % book.size(), order{i, 99.0, 1, 0});
+                        else if(r < 92) book.erase(book.begin(), book.begin() + 1 + rng() % 8);
+                        else book.erase(book.begin() + rng() % book.size());
+                    }
+                    if(session < 2) book.clear();
+                }
+            }
+        }
+        ext::stop_op_trace();
+    }
+}
+
+int main(int argc, char** argv){
+    const char* path = nullptr;
+    bool demo = false;
+    int reps = 5;
+    for(int i = 1; i < argc; ++i){
+        if(std::strncmp(argv[i], "--reps=", 7) == 0) reps = std::max(1, std::atoi(argv[i] + 7));
+        else if(std::strncmp(argv[i], "--demo=", 7) == 0){
+            path = argv[i] + 7;
+            demo = true;
+        }else if(argv[i][0] != '-' && !path) path = argv[i];
+        else path = nullptr, i = argc;
+    }
+    if(!path){
+        std::cerr << "usage: " << argv[0] << " TRACE [--reps=N]\n"
+                  << "       " << argv[0] << " --demo=TRACE [--reps=N]\n";
+        return 2;
+    }
+
+    try{
+        if(demo) record_demo(path);
+        const std::vector<ext::op_trace_record> records = ext::read_op_trace(path);
+        const plan p = make_plan(records);
+        std::size_t vectors = 0;
+        for(std::size_t n : p.slots) vectors += n;
+        bench::print_header("REPLAY " + std::string(path) + ": " + std::to_string(records.size()) + " records, " +
+                            std::to_string(vectors) + " vectors, best of " + std::to_string(reps),
+                            {"best ms", "ns/op", "allocs", "peak KB", "rss KB"});
+        replay<plain_vector>("vector", p, reps);
+        replay<pool_vector>("vector + pool", p, reps);
+        replay<plain_deque>("deque", p, reps);
+    }catch(const std::exception& e){
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,86 @@
+//Benchmark of ext/simd_algo.h against the generic std algorithms on vector.h
+//Every kernel is timed once per instruction set level (clamped with set_isa),
+//times are the best of several runs in milliseconds.
+//
+//build: g++ -std=c++20 -O2 -I.. simd_algo.cpp -o simd_algo
+#include "../ext/simd_algo.h"
+#include "bench_util.h"
+#include <cstdint>
+#include <random>
+
+using ext::simd::isa;
+
+namespace {
+    const int REPS = 5;
+
+    //time `fn` at every instruction set level, -1 for levels the CPU lacks
+    template<class Fn>
+    void time_levels(const std::string& op, double generic, Fn&& fn) {
+        double t[4];
+        for(int level = 0; level < 4; ++level) {
+            if(static_cast<isa>(level) > ext::simd::supported_isa()) {
+                t[level] = -1;
+                continue;
+            }
+            ext::simd::set_isa(static_cast<isa>(level));
+            t[level] = bench::best_of(REPS, fn);
+        }
+        ext::simd::set_isa(ext::simd::supported_isa());
+        bench::print_row(op, {generic, t[0], t[1], t[2], t[3]});
+    }
+
+    template<class T>
+    std::vector<T> make_data(std::size_t n) {
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<int> dis(1, 100);
+        std::vector<T> v;
+        v.reserve(n);
+        for(std::size_t i = 0; i < n; ++i) {
+            v.push_back(static_cast<T>(dis(gen)));
+        }
+        return v;
+    }
+
+    template<class T>
+    void bench_type(const char* name, std::size_t n) {
+        bench::print_header(std::string("SIMD KERNELS: vector<") + name + ">, " + std::to_string(n) + " elements",
+                            {"generic", "scalar", "sse4.1", "avx2", "avx512"});
+        std::vector<T> v = make_data<T>(n);
+        std::vector<T> w(v);
+        //a value that is not in the data, so find scans the whole vector
+        const T missing = static_cast<T>(0);
+        const T present = v[n / 2];
+
+        time_levels("find (miss)",
+            bench::best_of(REPS, [&]{ bench::keep(std::find(v.begin(), v.end(), missing)); }),
+            [&]{ bench::keep(ext::simd::find(v, missing)); });
+        time_levels("count",
+            bench::best_of(REPS, [&]{ bench::keep(std::count(v.begin(), v.end(), present)); }),
+            [&]{ bench::keep(ext::simd::count(v, present)); });
+        time_levels("min_element",
+            bench::best_of(REPS, [&]{ bench::keep(std::min_element(v.begin(), v.end())); }),
+            [&]{ bench::keep(ext::simd::min_element(v)); });
+        time_levels("max_element",
+            bench::best_of(REPS, [&]{ bench::keep(std::max_element(v.begin(), v.end())); }),
+            [&]{ bench::keep(ext::simd::max_element(v)); });
+        time_levels("sum",
+            bench::best_of(REPS, [&]{ bench::keep(std::accumulate(v.begin(), v.end(), ext::simd::sum_type<T>{})); }),
+            [&]{ bench::keep(ext::simd::sum(v)); });
+        time_levels("equal",
+            bench::best_of(REPS, [&]{ bench::keep(std::equal(v.begin(), v.end(), w.begin())); }),
+            [&]{ bench::keep(ext::simd::equal(v, w)); });
+    }
+}
+
+int main() {
+    const std::size_t N = 10000000;
+    std::cout << "Widest supported instruction set: " << ext::simd::isa_name(ext::simd::supported_isa()) << "\n";
+
+    bench_type<int>("int", N);
+    bench_type<float>("float", N);
+    bench_type<double>("double", N);
+    bench_type<std::uint8_t>("uint8_t", N);
+
+    std::cout << "\nTimes in ms; the scalar column is the std fallback reached through the dispatcher.\n";
+    return 0;
+}
@@ -0,0 +1,73 @@
+//Selectivity sweep for erase_if on vector.h: std::erase_if with a lambda
+//(std::remove_if + erase) against the SIMD compaction kernels reached through
+//the ext::simd predicates, at every instruction set level.
+//Each run erases from a fresh copy of the data made outside the timed region.
+//
+//build: g++ -std=c++20 -O2 -I.. simd_erase.cpp -o simd_erase
+#include "../ext/simd_algo.h"
+#include "bench_util.h"
+#include <cstdint>
+#include <random>
+
+using ext::simd::isa;
+
+namespace {
+    const int REPS = 5;
+
+    template<class T>
+    void sweep(const char* name, std::size_t n) {
+        bench::print_header(std::string("ERASE_IF SELECTIVITY SWEEP: vector<") + name + ">, " + std::to_string(n) + " elements",
+                            {"lambda", "scalar", "sse4.1", "avx2", "avx512"});
+        //uniform in [0, 100): erasing x < p removes p% of the elements
+        std::mt19937 gen(7);
+        std::uniform_int_distribution<int> dis(0, 99);
+        std::vector<T> src;
+        src.reserve(n);
+        for(std::size_t i = 0; i < n; ++i) {
+            src.push_back(static_cast<T>(dis(gen)));
+        }
+
+        //best of REPS runs, each on a fresh copy made outside the timed region
+        auto time_one = [&](auto&& fn) {
+            double best = 0;
+            for(int r = 0; r < REPS; ++r) {
+                std::vector<T> v(src);
+                bench::Timer t;
+                fn(v);
+                double ms = t.elapsed_ms();
+                bench::keep(v.size());
+                if(r == 0 || ms < best) best = ms;
+            }
+            return best;
+        };
+
+        for(int percent : {0, 10, 30, 50, 70, 90, 100}) {
+            const T threshold = static_cast<T>(percent);
+            double lambda = time_one([&](std::vector<T>& v){ std::erase_if(v, [&](const T& x){ return x < threshold; }); });
+            double t[4];
+            for(int level = 0; level < 4; ++level) {
+                if(static_cast<isa>(level) > ext::simd::supported_isa()) {
+                    t[level] = -1;
+                    continue;
+                }
+                ext::simd::set_isa(static_cast<isa>(level));
+                t[level] = time_one([&](std::vector<T>& v){ std::erase_if(v, ext::simd::less(threshold)); });
+            }
+            ext::simd::set_isa(ext::simd::supported_isa());
+            bench::print_row("erase " + std::to_string(percent) + "%", {lambda, t[0], t[1], t[2], t[3]});
+        }
+    }
+}
+
+int main() {
+    const std::size_t N = 5000000;
+    std::cout << "Widest supported instruction set: " << ext::simd::isa_name(ext::simd::supported_isa()) << "\n";
+
+    sweep<int>("int", N);
+    sweep<float>("float", N);
+    sweep<double>("double", N);
+    sweep<std::uint8_t>("uint8_t", N);
+
+    std::cout << "\nTimes in ms; the scalar column is the std::remove_if fallback reached through the dispatcher.\n";
+    return 0;
+}
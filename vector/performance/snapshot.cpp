@@ -0,0 +1,115 @@
+//Startup-time benchmark for ext/snapshot.h: how long until a multi-GB
+//vector<double> lookup table is usable again.
+//
+//  text + push_back   parse one number per line and push_back (the old way),
+//                     measured on a slice and scaled to the full size
+//  load (read)        load_snapshot: one read into uninitialised capacity
+//  map + verify       map_snapshot with the CRC32C check over all pages
+//  map                map_snapshot without the check, then one pass over the
+//                     data so the page faults are part of the time
+//
+//Cold runs drop the file from the page cache first (posix_fadvise DONTNEED),
+//warm runs read it from memory.
+//
+//build: g++ -std=c++20 -O2 -I.. snapshot.cpp -o snapshot
+//usage: ./snapshot [size in MB, default 2048] [file, default /tmp/vector_snapshot.bin]
+#include "../ext/snapshot.h"
+#include "bench_util.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+namespace {
+    void drop_page_cache(const char* path) {
+        int fd = ::open(path, O_RDONLY);
+        if(fd < 0) return;
+        ::fdatasync(fd);
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+
+    double touch(const double* p, std::size_t n) {
+        double s = 0;
+        for(std::size_t i = 0; i < n; i += 512) s += p[i];
+        return s;
+    }
+
+    template<class Fn>
+    void run(const std::string& op, const char* path, double mb, Fn&& fn) {
+        drop_page_cache(path);
+        bench::Timer t;
+        fn();
+        double cold = t.elapsed_ms();
+        t.reset();
+        fn();
+        double warm = t.elapsed_ms();
+        bench::print_row(op, {cold, warm, mb / (warm / 1000.0)});
+    }
+}
+
+int main(int argc, char** argv) {
+    const std::size_t mb = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2048;
+    const char* path = argc > 2 ? argv[2] : "/tmp/vector_snapshot.bin";
+    const std::size_t n = mb * 1024 * 1024 / sizeof(double);
+
+    std::vector<double> table;
+    table.reserve(n);
+    for(std::size_t i = 0; i < n; ++i) {
+        table.push_back(static_cast<double>(i) * 0.25);
+    }
+
+    bench::print_header("SNAPSHOT STARTUP: vector<double>, " + std::to_string(mb) + " MB", {"cold (ms)", "warm (ms)", "MB/s"});
+
+    bench::Timer t;
+    ext::save_snapshot(table, path);
+    double save_ms = t.elapsed_ms();
+    bench::print_row("save (writev)", {-1, save_ms, mb / (save_ms / 1000.0)});
+
+    //text baseline on a slice: formatting and parsing gigabytes of text would take minutes
+    {
+        const std::size_t slice = std::min<std::size_t>(n, 4 * 1024 * 1024);
+        const std::string text_path = std::string(path) + ".txt";
+        {
+            std::ofstream out(text_path);
+            for(std::size_t i = 0; i < slice; ++i) out << table[i] << '\n';
+        }
+        const double slice_mb = slice * sizeof(double) / (1024.0 * 1024.0);
+        run("text + push_back (scaled)", text_path.c_str(), slice_mb, [&]{
+            std::ifstream in(text_path);
+            std::vector<double> v;
+            double x;
+            while(in >> x) v.push_back(x);
+            bench::keep(v.size());
+        });
+        std::remove(text_path.c_str());
+        std::cout << "  (measured on " << slice << " elements; full size would take about "
+                  << static_cast<double>(n) / slice << "x as long)\n";
+    }
+
+    run("load (read)", path, mb, [&]{
+        std::vector<double> v;
+        ext::load_snapshot(v, path);
+        bench::keep(v.size());
+    });
+    run("load (read, no checksum)", path, mb, [&]{
+        std::vector<double> v;
+        ext::load_snapshot(v, path, false);
+        bench::keep(v.size());
+    });
+    run("map + verify", path, mb, [&]{
+        auto view = ext::map_snapshot<double>(path);
+        bench::keep(view.size());
+    });
+    run("map + first touch", path, mb, [&]{
+        auto view = ext::map_snapshot<double>(path, false);
+        bench::keep(touch(view.data(), view.size()));
+    });
+    run("map only", path, mb, [&]{
+        auto view = ext::map_snapshot<double>(path, false);
+        bench::keep(view.size());
+    });
+
+    std::remove(path);
+    return 0;
+}
@@ -0,0 +1,266 @@
+//Tail latency of single vector operations, by element type and growth policy.
+//
+//Amortised O(1) push_back still makes one call in every doubling O(n): the
+//one that reallocates and relocates everything. Means hide that call; this
+//benchmark times every operation on its own into a latency_histogram.h and
+//prints its percentiles. Each row is `rounds` runs of n operations on a fresh
+//vector, all in one histogram.
+//
+//  push_back     a value made before the clock starts is moved in
+//  emplace_back  the element is constructed in place, inside the timing
+//  insert mid    n inserts in the middle of a vector that starts at 1000
+//  erase mid     n erases from the middle of n + 1000 elements; nothing grows,
+//                so it runs once per type
+//
+//Growth policies:
+//  2x            vector.h's own growth, new/delete underneath
+//  reserve       reserve() of the final size first, so nothing reallocates
+//  arena         std::pmr::vector in ext/arena.h's bump_arena, which grows in
+//                place while the vector is the arena's latest allocation and
+//                copies when the arena needs a new chunk
+//  incremental   ext/incremental_vector.h, which moves two old elements per
+//                push_back after growing instead of all of them at once; it
+//                has no insert, so only push_back and emplace_back rows
+//
+//"growths" is how many operations per round changed capacity and "growth %"
+//their share of the total time; under 2x those are the p99.9/max outliers.
+//What is left under reserve is mostly the first write to each new page of the
+//reserved block (a page fault every 4 KiB of elements).
+//The first table is the clock itself timing nothing: that floor (two
+//steady_clock reads) is in every value below it.
+//
+//build: g++ -std=c++20 -O2 -I.. tail_latency.cpp -o tail_latency
+//usage: ./tail_latency [--n=N] [--rounds=N] [--filter=substring]
+//       (rows are named operation/type/policy, e.g. --filter=/2x)
+#include "../ext/arena.h"
+#include "../ext/incremental_vector.h"
+#include "bench_util.h"
+#include "latency_histogram.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+    struct pod64{
+        long v[8];
+    };
+
+    //an element type: how to make the i-th one, and how to emplace it
+    struct int_case{
+        using type = int;
+        static constexpr const char* name = "int";
+        static type make(std::size_t i){ return static_cast<int>(i); }
+        template<class V> static void emplace(V& v, std::size_t i){ v.emplace_back(static_cast<int>(i)); }
+    };
+
+    struct pod64_case{
+        using type = pod64;
+        static constexpr const char* name = "pod64";
+        static type make(std::size_t i){ return {{static_cast<long>(i)}}; }
+        template<class V> static void emplace(V& v, std::size_t i){ v.emplace_back(pod64{{static_cast<long>(i)}}); }
+    };
+
+    struct string_case{
+        using type = std::string;
+        static constexpr const char* name = "string";
+        static type make(std::size_t){ return std::string(48, 'x'); }
+        template<class V> static void emplace(V& v, std::size_t){ v.emplace_back(48, 'x'); }
+    };
+
+    //a growth policy: a context per round that hands out the vectors of that round
+    struct doubling_policy{
+        static constexpr const char* name = "2x";
+        template<class T>
+        struct context{
+            std::vector<T> make(std::size_t){ return {}; }
+        };
+    };
+
+    struct reserve_policy{
+        static constexpr const char* name = "reserve";
+        template<class T>
+        struct context{
+            std::vector<T> make(std::size_t final_size){
+                std::vector<T> v;
+                v.reserve(final_size);
+                return v;
+            }
+        };
+    };
+
+    struct arena_policy{
+        static constexpr const char* name = "arena";
+        template<class T>
+        struct context{
+            ext::bump_arena arena;
+            std::pmr::vector<T> make(std::size_t){ return std::pmr::vector<T>(&arena); }
+        };
+    };
+
+    struct incremental_policy{
+        static constexpr const char* name = "incremental";
+        template<class T>
+        struct context{
+            ext::incremental_vector<T> make(std::size_t){ return {}; }
+        };
+    };
+
+    struct options{
+        std::size_t n = 1000000;
+        int rounds = 10;
+        std::string filter;
+    };
+
+    struct row_stats{
+        bench::latency_histogram latency;
+        std::size_t growths = 0;
+        double growth_ns = 0;
+        double total_ns = 0;
+    };
+
+    //time fn() alone and count it as a growth if it changed v's capacity
+    template<class V, class Fn>
+    inline void timed(row_stats& s, const V& v, Fn&& fn){
+        const std::size_t cap = v.capacity();
+        const auto t0 = std::chrono::steady_clock::now();
+        fn();
+        const auto t1 = std::chrono::steady_clock::now();
+        bench::clobber();
+        const auto ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+        s.latency.record(ns);
+        s.total_ns += ns;
+        if(v.capacity() != cap){
+            ++s.growths;
+            s.growth_ns += ns;
+        }
+    }
+
+    void print(const std::string& name, const row_stats& s, int rounds){
+        const bench::latency_histogram& h = s.latency;
+        bench::print_row(name, {double(h.count()), double(h.percentile(50)), double(h.percentile(99)), double(h.percentile(99.9)),
+                                h.max() / 1000.0, h.mean(), double(s.growths) / rounds,
+                                s.total_ns > 0 ? 100 * s.growth_ns / s.total_ns : 0});
+    }
+
+    bool selected(const options& opt, const std::string& name){
+        return opt.filter.empty() || name.find(opt.filter) != std::string::npos;
+    }
+
+    template<class Case, class Policy>
+    void push_back_row(const options& opt){
+        const std::string name = std::string("push_back/") + Case::name + "/" + Policy::name;
+        if(!selected(opt, name)) return;
+        row_stats s;
+        for(int r = 0; r < opt.rounds; ++r){
+            typename Policy::template context<typename Case::type> ctx;
+            auto v = ctx.make(opt.n);
+            for(std::size_t i = 0; i < opt.n; ++i){
+                typename Case::type x = Case::make(i);
+                timed(s, v, [&]{ v.push_back(std::move(x)); });
+            }
+            bench::keep(v.size());
+        }
+        print(name, s, opt.rounds);
+    }
+
+    template<class Case, class Policy>
+    void emplace_back_row(const options& opt){
+        const std::string name = std::string("emplace_back/") + Case::name + "/" + Policy::name;
+        if(!selected(opt, name)) return;
+        row_stats s;
+        for(int r = 0; r < opt.rounds; ++r){
+            typename Policy::template context<typename Case::type> ctx;
+            auto v = ctx.make(opt.n);
+            for(std::size_t i = 0; i < opt.n; ++i) timed(s, v, [&]{ Case::emplace(v, i); });
+            bench::keep(v.size());
+        }
+        print(name, s, opt.rounds);
+    }
+
+    template<class Case, class Policy>
+    void insert_row(const options& opt, std::size_t n){
+        const std::string name = std::string("insert mid/") + Case::name + "/" + Policy::name;
+        if(!selected(opt, name)) return;
+        row_stats s;
+        for(int r = 0; r < opt.rounds; ++r){
+            typename Policy::template context<typename Case::type> ctx;
+            auto v = ctx.make(1000 + n);
+            for(std::size_t i = 0; i < 1000; ++i) v.push_back(Case::make(i));
+            for(std::size_t i = 0; i < n; ++i){
+                typename Case::type x = Case::make(i);
+                timed(s, v, [&]{ v.insert(v.begin() + v.size() / 2, std::move(x)); });
+            }
+            bench::keep(v.data());
+        }
+        print(name, s, opt.rounds);
+    }
+
+    template<class Case>
+    void erase_row(const options& opt, std::size_t n){
+        const std::string name = std::string("erase mid/") + Case::name;
+        if(!selected(opt, name)) return;
+        row_stats s;
+        for(int r = 0; r < opt.rounds; ++r){
+            std::vector<typename Case::type> v;
+            v.reserve(n + 1000);
+            for(std::size_t i = 0; i < n + 1000; ++i) v.push_back(Case::make(i));
+            for(std::size_t i = 0; i < n; ++i) timed(s, v, [&]{ v.erase(v.begin() + v.size() / 2); });
+            bench::keep(v.data());
+        }
+        print(name, s, opt.rounds);
+    }
+
+    template<class Case>
+    void type_rows(const options& opt, std::size_t insert_n){
+        push_back_row<Case, doubling_policy>(opt);
+        push_back_row<Case, reserve_policy>(opt);
+        push_back_row<Case, arena_policy>(opt);
+        push_back_row<Case, incremental_policy>(opt);
+        emplace_back_row<Case, doubling_policy>(opt);
+        emplace_back_row<Case, reserve_policy>(opt);
+        emplace_back_row<Case, arena_policy>(opt);
+        emplace_back_row<Case, incremental_policy>(opt);
+        insert_row<Case, doubling_policy>(opt, insert_n);
+        insert_row<Case, reserve_policy>(opt, insert_n);
+        insert_row<Case, arena_policy>(opt, insert_n);
+        erase_row<Case>(opt, insert_n);
+    }
+
+    void header(const std::string& title){
+        bench::print_header(title, {"ops", "p50 ns", "p99 ns", "p99.9 ns", "max us", "mean ns", "growths", "growth %"});
+    }
+}
+
+int main(int argc, char** argv){
+    options opt;
+    for(int i = 1; i < argc; ++i){
+        if(std::strncmp(argv[i], "--n=", 4) == 0) opt.n = std::max(1ull, std::strtoull(argv[i] + 4, nullptr, 10));
+        else if(std::strncmp(argv[i], "--rounds=", 9) == 0) opt.rounds = std::max(1, std::atoi(argv[i] + 9));
+        else if(std::strncmp(argv[i], "--filter=", 9) == 0) opt.filter = argv[i] + 9;
+        else{
+            std::cerr << "usage: " << argv[0] << " [--n=N] [--rounds=N] [--filter=substring]\n";
+            return 2;
+        }
+    }
+    //middle inserts and erases are O(n) each
+    const std::size_t insert_n = std::min<std::size_t>(opt.n, 20000);
+
+    header("CLOCK FLOOR (two steady_clock reads around nothing)");
+    {
+        row_stats s;
+        std::vector<int> none;
+        for(int r = 0; r < opt.rounds; ++r){
+            for(std::size_t i = 0; i < opt.n; ++i) timed(s, none, []{});
+        }
+        print("(clock)", s, opt.rounds);
+    }
+
+    header("INT, " + std::to_string(opt.n) + " push/emplace, " + std::to_string(insert_n) + " insert/erase, x" + std::to_string(opt.rounds));
+    type_rows<int_case>(opt, insert_n);
+    header("POD64");
+    type_rows<pod64_case>(opt, insert_n);
+    header("STRING (48 chars, on the heap)");
+    type_rows<string_case>(opt, insert_n);
+    return 0;
+}
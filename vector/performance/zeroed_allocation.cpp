@@ -0,0 +1,74 @@
+//Benchmark for vector_allocator_zeroed: value-initialising a huge vector<int>.
+//
+//Each row builds a vector of n ints with vector(n) or resize(n), then writes one
+//int per 64 pages, the way a sparse table or a histogram with most buckets empty
+//is used. With std::allocator the constructor writes every zero itself, so all
+//pages become resident at once; calloc_allocator, page_allocator and
+//reserving_allocator hand over memory that is zero already, and only the pages
+//written become resident.
+//  build ms      the constructor or resize
+//  sparse ms     the sparse writes after it
+//  rss MB        resident set growth over the build and the sparse writes
+//  minflt        minor faults over the same
+//
+//build: g++ -std=c++20 -O2 -I.. zeroed_allocation.cpp -o zeroed_allocation
+//usage: ./zeroed_allocation [n]      (default 256M ints, 1 GiB)
+#include "../ext/calloc_allocator.h"
+#include "../ext/page_release.h"
+#include "../ext/reserved_vector.h"
+#include "bench_util.h"
+#include <cstdio>
+#include <cstdlib>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+    double rss_mb(){
+        long pages = 0, resident = 0;
+        if(std::FILE* f = std::fopen("/proc/self/statm", "r")){
+            if(std::fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+            std::fclose(f);
+        }
+        return resident * static_cast<double>(::sysconf(_SC_PAGESIZE)) / (1 << 20);
+    }
+
+    long minor_faults(){
+        rusage u{};
+        ::getrusage(RUSAGE_SELF, &u);
+        return u.ru_minflt;
+    }
+
+    template<class Vector>
+    void measure(const std::string& name, std::size_t n, bool use_resize){
+        const double rss0 = rss_mb();
+        const long faults0 = minor_faults();
+        bench::Timer build;
+        Vector v = use_resize ? Vector() : Vector(n);
+        if(use_resize) v.resize(n);
+        const double build_ms = build.elapsed_ms();
+
+        const std::size_t stride = 64 * static_cast<std::size_t>(::sysconf(_SC_PAGESIZE)) / sizeof(int);
+        bench::Timer sparse;
+        for(std::size_t i = 0; i < n; i += stride) ++v[i];
+        bench::keep(v.data());
+        const double sparse_ms = sparse.elapsed_ms();
+        bench::print_row(name, {build_ms, sparse_ms, rss_mb() - rss0, double(minor_faults() - faults0)});
+    }
+
+    template<class Vector>
+    void rows(const std::string& name, std::size_t n){
+        measure<Vector>(name + " vector(n)", n, false);
+        measure<Vector>(name + " resize(n)", n, true);
+    }
+}
+
+int main(int argc, char** argv){
+    const std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : std::size_t(256) << 20;
+    bench::print_header("VECTOR<int> OF " + std::to_string(n) + ", ONE WRITE PER 64 PAGES",
+                        {"build ms", "sparse ms", "rss MB", "minflt"});
+    rows<std::vector<int>>("std::allocator", n);
+    rows<ext::calloc_vector<int>>("calloc_allocator", n);
+    rows<ext::page_vector<int>>("page_allocator", n);
+    rows<ext::reserved_vector<int>>("reserving_allocator", n);
+    return 0;
+}
@@ -1,7 +1,51 @@
 #include "vector.h"
+#include "ext/simd_algo.h"
+#include "ext/snapshot.h"
+#include "ext/ingest.h"
+#include "ext/arena.h"
+#include "ext/thread_pool_allocator.h"
+#include "ext/persistent_vector.h"
+#include "ext/cow_vector.h"
+#include "ext/rcu_vector.h"
+#include "ext/vector_stats.h"
+#include "ext/growth_sites.h"
+#include "ext/vector_trace.h"
+#include "ext/op_trace.h"
+#include "ext/incremental_vector.h"
+#include "ext/capacity_hints.h"
+#include "ext/shrink_policy.h"
+#include "ext/page_release.h"
+#include "ext/reserved_vector.h"
+#include "ext/calloc_allocator.h"
 #include <iostream>
+#include <memory>
 #include <cassert>
 #include <stdexcept>
+#include <cmath>
+#include <numeric>
+#include <thread>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+
+// counted by test_vector_stats; enabled before either vector type is first used
+struct stats_probe {
+    int v;
+};
+struct stats_copy_probe {
+    int v;
+    stats_copy_probe(int x) : v(x) {}
+    stats_copy_probe(const stats_copy_probe&) = default;
+    stats_copy_probe(stats_copy_probe&& other) noexcept(false) : v(other.v) {}
+};
+EXT_VECTOR_STATS(stats_probe);
+EXT_VECTOR_STATS(stats_copy_probe);
+
+// traced by test_vector_trace; 1 KiB elements so four of them reach the trace threshold
+struct trace_probe {
+    char bytes[1024];
+};
+EXT_VECTOR_TRACE(trace_probe);
 
 void test_constructor() {
     std::cout << "Testing constructors..." << std::endl;
@@ -94,6 +138,12 @@ void test_insert() {
     v.insert(v.end(), 4);
     assert(v[4] == 4);
     assert(v.size() == 5);
+
+    // Insert a move-only element into a full vector
+    std::vector<std::unique_ptr<int>> ptrs;
+    ptrs.push_back(std::make_unique<int>(1));
+    ptrs.insert(ptrs.begin(), std::make_unique<int>(0));
+    assert(ptrs.size() == 2 && *ptrs[0] == 0 && *ptrs[1] == 1);
     
     std::cout << "✓ insert passed" << std::endl;
 }
@@ -318,6 +368,1029 @@ void test_front_back() {
     std::cout << "✓ front/back passed" << std::endl;
 }
 
+template<class T>
+void check_simd_kernels() {
+    // sizes around every register width so both the vector loop and the tail run
+    for(std::size_t n : {0, 1, 3, 15, 16, 17, 63, 64, 65, 129, 1000}) {
+        std::vector<T> v;
+        for(std::size_t i = 0; i < n; ++i) {
+            v.push_back(static_cast<T>((i * 7 + 3) % 41));
+        }
+        for(int x : {0, 3, 10, 40, 99}) {
+            assert(ext::simd::find(v, static_cast<T>(x)) == std::find(v.begin(), v.end(), static_cast<T>(x)));
+            assert(ext::simd::count(v, static_cast<T>(x)) == static_cast<std::size_t>(std::count(v.begin(), v.end(), static_cast<T>(x))));
+        }
+        assert(ext::simd::min_element(v) == std::min_element(v.begin(), v.end()));
+        assert(ext::simd::max_element(v) == std::max_element(v.begin(), v.end()));
+        assert(ext::simd::sum(v) == std::accumulate(v.begin(), v.end(), ext::simd::sum_type<T>{}));
+
+        std::vector<T> w(v);
+        assert(ext::simd::equal(v, w));
+        if(n > 0) {
+            w.back() = static_cast<T>(100);
+            assert(!ext::simd::equal(v, w));
+        }
+    }
+}
+
+void test_simd_algo() {
+    std::cout << "Testing SIMD kernels..." << std::endl;
+
+    const ext::simd::isa widest = ext::simd::supported_isa();
+    for(int level = 0; level <= static_cast<int>(widest); ++level) {
+        ext::simd::set_isa(static_cast<ext::simd::isa>(level));
+        check_simd_kernels<int>();
+        check_simd_kernels<float>();
+        check_simd_kernels<double>();
+        check_simd_kernels<std::uint8_t>();
+        check_simd_kernels<long>();
+
+        // NaN never compares equal and min/max must order it the way std does
+        std::vector<double> d(100, 1.0);
+        d[40] = 0.5;
+        d[70] = NAN;
+        assert(ext::simd::find(d, static_cast<double>(NAN)) == d.end());
+        assert(ext::simd::min_element(d) == std::min_element(d.begin(), d.end()));
+        assert(ext::simd::max_element(d) == std::max_element(d.begin(), d.end()));
+
+        // first of several equal extremes, -0.0 and +0.0 tie
+        std::vector<float> z(40, 1.0f);
+        z[5] = 0.0f;
+        z[20] = -0.0f;
+        assert(ext::simd::min_element(z) - z.begin() == 5);
+
+        // int sums widen with sign extension
+        std::vector<int> neg(1000);
+        for(std::size_t i = 0; i < neg.size(); ++i) neg[i] = (i % 3 == 0) ? -2000000000 + static_cast<int>(i) : static_cast<int>(i);
+        assert(ext::simd::sum(neg) == std::accumulate(neg.begin(), neg.end(), std::int64_t(0)));
+    }
+    ext::simd::set_isa(widest);
+
+    std::cout << "✓ SIMD kernels passed" << std::endl;
+}
+
+template<class T, class Pred>
+void check_erase_if_matches_scalar(const std::vector<T>& src, Pred pred) {
+    std::vector<T> simd(src);
+    std::vector<T> scalar(src);
+    auto removed = std::erase_if(simd, pred);
+    auto expected = std::erase_if(scalar, [&](const T& x) { return pred(x); });
+    assert(removed == expected);
+    assert(simd.size() == scalar.size());
+    for(std::size_t i = 0; i < simd.size(); ++i) {
+        assert(simd[i] == scalar[i] || (simd[i] != simd[i] && scalar[i] != scalar[i]));
+    }
+}
+
+template<class T>
+void check_simd_compaction() {
+    for(std::size_t n : {0, 1, 5, 16, 17, 64, 65, 300}) {
+        std::vector<T> v;
+        for(std::size_t i = 0; i < n; ++i) {
+            v.push_back(static_cast<T>((i * 13 + 5) % 50));
+        }
+        for(int x : {0, 10, 25, 49}) {
+            const T a = static_cast<T>(x);
+            const T b = static_cast<T>(x + 10);
+            check_erase_if_matches_scalar(v, ext::simd::equal_to(a));
+            check_erase_if_matches_scalar(v, ext::simd::not_equal_to(a));
+            check_erase_if_matches_scalar(v, ext::simd::less(a));
+            check_erase_if_matches_scalar(v, ext::simd::less_equal(a));
+            check_erase_if_matches_scalar(v, ext::simd::greater(a));
+            check_erase_if_matches_scalar(v, ext::simd::greater_equal(a));
+            check_erase_if_matches_scalar(v, ext::simd::between(a, b));
+            check_erase_if_matches_scalar(v, ext::simd::outside(a, b));
+        }
+    }
+}
+
+void test_simd_erase_if() {
+    std::cout << "Testing SIMD erase_if..." << std::endl;
+
+    const ext::simd::isa widest = ext::simd::supported_isa();
+    for(int level = 0; level <= static_cast<int>(widest); ++level) {
+        ext::simd::set_isa(static_cast<ext::simd::isa>(level));
+        check_simd_compaction<int>();
+        check_simd_compaction<float>();
+        check_simd_compaction<double>();
+        check_simd_compaction<std::uint8_t>();
+        check_simd_compaction<long>();
+
+        // NaN fails every ordered comparison, so less keeps it and not_equal_to drops it
+        std::vector<float> f(40, 1.0f);
+        f[3] = NAN;
+        f[33] = NAN;
+        check_erase_if_matches_scalar(f, ext::simd::less(2.0f));
+        check_erase_if_matches_scalar(f, ext::simd::not_equal_to(1.0f));
+    }
+    ext::simd::set_isa(widest);
+
+    std::vector<int> v{1, 2, 3, 2, 1};
+    assert(ext::simd::erase(v, 2) == 2);
+    assert(v.size() == 3 && v[0] == 1 && v[1] == 3 && v[2] == 1);
+    auto end = ext::simd::remove_if(v, ext::simd::greater(1));
+    assert(end - v.begin() == 2 && v.size() == 3);
+
+    std::cout << "✓ SIMD erase_if passed" << std::endl;
+}
+
+void test_snapshot() {
+    std::cout << "Testing snapshot save/load..." << std::endl;
+
+    std::vector<int> r;
+    r.resize_and_overwrite(10, [](int* p, std::size_t n) {
+        for(std::size_t i = 0; i < n; ++i) p[i] = static_cast<int>(i);
+        return n / 2;
+    });
+    assert(r.size() == 5 && r[4] == 4);
+    bool threw = false;
+    try {
+        r.resize_and_overwrite(4, [](int*, std::size_t n) { return n + 1; });
+    } catch(const std::length_error&) {
+        threw = true;
+    }
+    assert(threw);
+
+    const char* path = "/tmp/vector_test_snapshot.bin";
+    std::vector<double> v(1000);
+    for(std::size_t i = 0; i < v.size(); ++i) v[i] = i * 0.5;
+    ext::save_snapshot(v, path);
+
+    std::vector<double> loaded{1.0, 2.0};
+    ext::load_snapshot(loaded, path);
+    assert(loaded == v);
+
+    auto view = ext::map_snapshot<double>(path);
+    assert(view.size() == v.size() && view[999] == 499.5);
+    assert(view.to_vector() == v);
+
+    // the type tag guards against reading the payload as another type
+    std::vector<float> wrong;
+    threw = false;
+    try {
+        ext::load_snapshot(wrong, path);
+    } catch(const ext::snapshot_error&) {
+        threw = true;
+    }
+    assert(threw && wrong.empty());
+
+    // a flipped payload byte fails the checksum
+    {
+        std::FILE* f = std::fopen(path, "r+b");
+        std::fseek(f, -3, SEEK_END);
+        std::fputc(0x5A, f);
+        std::fclose(f);
+    }
+    threw = false;
+    try {
+        ext::load_snapshot(loaded, path);
+    } catch(const ext::snapshot_error&) {
+        threw = true;
+    }
+    assert(threw && loaded.empty());
+    std::remove(path);
+
+    std::cout << "✓ Snapshot save/load passed" << std::endl;
+}
+
+void test_ingest() {
+    std::cout << "Testing fd ingestion..." << std::endl;
+
+    const char* path = "/tmp/vector_test_ingest.bin";
+    std::vector<int> src(5000);
+    for(std::size_t i = 0; i < src.size(); ++i) src[i] = static_cast<int>(i * 3);
+    ext::save_snapshot(src, path);  // any file will do; skip the 64-byte header below
+
+    std::vector<int> v{-1};
+    int fd = ::open(path, O_RDONLY);
+    ::lseek(fd, 64, SEEK_SET);
+    auto r = ext::append_from_fd(v, fd, 10);
+    assert(r.count == 10 && !r.eof && v.size() == 11 && v[0] == -1 && v[10] == 27);
+    r = ext::append_from_fd(v, fd);
+    assert(r.count == 4990 && r.eof && v.back() == 14997);
+    ::close(fd);
+
+    // a pipe that delivers elements split across writes
+    int p[2];
+    if(::pipe(p) != 0) throw std::runtime_error("pipe failed");
+    const char* bytes = reinterpret_cast<const char*>(src.data());
+    ssize_t put = ::write(p[1], bytes, 7);
+    put += ::write(p[1], bytes + 7, 93);
+    assert(put == 100);
+    ::close(p[1]);
+    std::vector<int> piped;
+    r = ext::append_from_fd(piped, p[0]);
+    ::close(p[0]);
+    assert(r.eof && piped.size() == 25 && piped[24] == 72);
+
+    // input ending inside an element leaves the vector as it was
+    if(::pipe(p) != 0) throw std::runtime_error("pipe failed");
+    put = ::write(p[1], bytes, 10);
+    assert(put == 10);
+    ::close(p[1]);
+    bool threw = false;
+    try {
+        ext::append_from_fd(piped, p[0]);
+    } catch(const std::runtime_error&) {
+        threw = true;
+    }
+    ::close(p[0]);
+    assert(threw && piped.size() == 25);
+
+    std::vector<char> text = ext::read_file(path);
+    assert(text.size() == 64 + src.size() * sizeof(int));
+    std::remove(path);
+
+    std::cout << "✓ fd ingestion passed" << std::endl;
+}
+
+void test_pmr_arena() {
+    std::cout << "Testing pmr arena growth..." << std::endl;
+
+    alignas(std::max_align_t) static char buffer[1 << 16];
+    ext::bump_arena arena(buffer, sizeof(buffer));
+    std::pmr::vector<int> v(&arena);
+    v.push_back(0);
+    const int* first = v.data();
+    for(int i = 1; i < 1000; ++i) v.push_back(i);
+    v.resize(2000, 7);
+    // the latest allocation grows in place: same block, nothing abandoned
+    assert(v.data() == first);
+    assert(arena.bytes_used() == v.capacity() * sizeof(int));
+    v.insert(v.begin(), 3, -1);
+    assert(v.data() == first);
+    assert(v.size() == 2003 && v[0] == -1 && v[3] == 0 && v[1002] == 999 && v[2002] == 7);
+
+    // once something else is allocated behind it, growth relocates as usual
+    std::pmr::vector<int> w(&arena);
+    w.push_back(1);
+    v.resize(v.capacity() + 1);
+    assert(v.data() != first && v[1002] == 999);
+
+    // other resources are unaffected
+    std::pmr::monotonic_buffer_resource mono;
+    std::pmr::vector<int> m(&mono);
+    for(int i = 0; i < 100; ++i) m.push_back(i);
+    assert(m.size() == 100 && m[99] == 99);
+
+    // a wrapper that forwards is_equal to the arena is not expandable itself
+    struct logging_resource : std::pmr::memory_resource {
+        std::pmr::memory_resource* upstream;
+        std::size_t allocations = 0;
+        explicit logging_resource(std::pmr::memory_resource* r) : upstream(r) {}
+        void* do_allocate(std::size_t bytes, std::size_t align) override { ++allocations; return upstream->allocate(bytes, align); }
+        void do_deallocate(void* p, std::size_t bytes, std::size_t align) override { upstream->deallocate(p, bytes, align); }
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return upstream->is_equal(other); }
+    };
+    ext::bump_arena wrapped_arena;
+    logging_resource logging(&wrapped_arena);
+    assert(logging.is_equal(wrapped_arena));
+    std::pmr::vector<int> logged(&logging);
+    for(int i = 0; i < 1000; ++i) logged.push_back(i);
+    assert(logged.size() == 1000 && logged[999] == 999 && logging.allocations > 1);
+
+    arena.release();
+    assert(arena.bytes_used() == 0);
+
+    std::cout << "✓ pmr arena growth passed" << std::endl;
+}
+
+void test_pool_allocator() {
+    std::cout << "Testing pool allocator..." << std::endl;
+
+    using pool_vector = std::vector<int, ext::pool_allocator<int>>;
+    static_assert(ext::detail::pool_class_size(ext::detail::pool_class_of(48)) == 64);
+
+    pool_vector v;
+    for(int i = 0; i < 100000; ++i) v.push_back(i);
+    pool_vector copy = v;
+    assert(copy.size() == 100000 && copy[99999] == 99999);
+    v.clear();
+    v.shrink_to_fit();
+
+    // over-aligned elements get blocks aligned for them
+    struct alignas(64) line { char bytes[64]; };
+    std::vector<line, ext::pool_allocator<line>> lines(3);
+    assert(reinterpret_cast<std::uintptr_t>(lines.data()) % 64 == 0);
+
+    // blocks freed on another thread than the one that allocated them
+    std::vector<pool_vector> made(1000);
+    std::thread producer([&] {
+        for(std::size_t i = 0; i < made.size(); ++i) made[i].assign(i % 40 + 1, static_cast<int>(i));
+    });
+    producer.join();
+    for(std::size_t i = 0; i < made.size(); ++i) assert(made[i].size() == i % 40 + 1 && made[i][0] == static_cast<int>(i));
+    made.clear();
+    ext::pool_flush_thread_cache();
+
+    std::cout << "✓ pool allocator passed" << std::endl;
+}
+
+void test_persistent_vector() {
+    std::cout << "Testing persistent vector..." << std::endl;
+
+    std::vector<int> plain(5000);
+    std::iota(plain.begin(), plain.end(), 0);
+    const ext::persistent_vector<int> v0(plain);
+    assert(v0.size() == 5000 && v0[4999] == 4999 && v0.to_vector() == plain);
+
+    // every operation returns a new version and leaves the old one alone
+    auto v1 = v0.set(100, -1).push_back(5000);
+    assert(v1.size() == 5001 && v1[100] == -1 && v1.back() == 5000);
+    assert(v0.size() == 5000 && v0[100] == 100);
+    auto v2 = v1.pop_back().pop_back();
+    assert(v2.size() == 4999 && v2.back() == 4998 && v1.back() == 5000);
+
+    // slices share structure with the original and can keep growing
+    auto s = v0.slice(1000, 1100);
+    assert(s.size() == 100 && s.front() == 1000 && s.back() == 1099);
+    s = s.push_back(7).set(0, 8);
+    assert(s.size() == 101 && s[0] == 8 && s[100] == 7 && v0[1000] == 1000 && v0[1100] == 1100);
+    assert(std::accumulate(s.begin(), s.end(), 0L) == std::accumulate(plain.begin() + 1001, plain.begin() + 1100, 0L) + 15);
+
+    // a transient batch does not touch the version it started from
+    auto t = v0.transient();
+    for(int i = 0; i < 100; ++i) t.set(i, i * 2);
+    for(int i = 0; i < 40; ++i) t.push_back(i);
+    t.pop_back();
+    auto v3 = t.persistent();
+    assert(v3.size() == 5039 && v3[99] == 198 && v3.back() == 38);
+    assert(v0[99] == 99 && v0.size() == 5000);
+    assert(v0 == ext::persistent_vector<int>(plain) && !(v0 == v3));
+
+    bool threw = false;
+    try {
+        (void)v0.slice(10, 5001);
+    } catch(const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::cout << "✓ persistent vector passed" << std::endl;
+}
+
+void test_cow_vector() {
+    std::cout << "Testing copy-on-write vector..." << std::endl;
+
+    ext::cow_vector<int> a{1, 2, 3, 4};
+    assert(a.size() == 4 && a[3] == 4 && a.use_count() == 1);
+
+    // copies share the buffer until one of them is changed
+    ext::cow_vector<int> b = a;
+    const int* shared = a.data();
+    assert(b.data() == shared && a.use_count() == 2);
+    b.set(0, 10);
+    assert(b[0] == 10 && a[0] == 1 && a.data() == shared && b.data() != shared);
+    assert(a.use_count() == 1 && b.use_count() == 1);
+
+    // mutating an unshared buffer does not copy it
+    const int* own = b.data();
+    b.set(1, 20);
+    assert(b.data() == own);
+
+    ext::cow_vector<int> c = a;
+    c.push_back(5);
+
+    // emplace_back hands out no mutable reference that a later copy would share
+    static_assert(std::is_same_v<decltype(c.emplace_back(6)), const int&>);
+    const int& emplaced = c.emplace_back(6);
+    ext::cow_vector<int> shares_emplaced = c;
+    assert(&emplaced == &shares_emplaced.back());
+    c.pop_back();
+    c.mutate([](std::vector<int>& v) { v.erase(v.begin()); });
+    assert(c.to_vector() == std::vector<int>({2, 3, 4, 5}));
+    assert(a.view() == std::vector<int>({1, 2, 3, 4}));
+
+    // clearing a shared copy just lets go of the buffer
+    ext::cow_vector<int> d = a;
+    d.clear();
+    assert(d.empty() && d.use_count() == 0 && a.size() == 4 && a.use_count() == 1);
+    assert(std::accumulate(a.begin(), a.end(), 0) == 10);
+
+    ext::cow_vector<std::string> e;
+    e.emplace_back("route");
+    ext::cow_vector<std::string> f = e;
+    assert(e == f);
+    f.pop_back();
+    assert(f.empty() && e.size() == 1 && e.front() == "route" && !(e == f));
+
+    bool threw = false;
+    try {
+        (void)a.at(4);
+    } catch(const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::cout << "✓ copy-on-write vector passed" << std::endl;
+}
+
+void test_rcu_vector() {
+    std::cout << "Testing RCU vector..." << std::endl;
+
+    ext::rcu_vector<int> table(std::vector<int>{1, 2, 3});
+    {
+        // a snapshot keeps its version while writers replace it
+        auto before = table.read();
+        table.update([](std::vector<int>& v) { v.push_back(4); });
+        auto after = table.read();
+        assert(before.size() == 3 && after.size() == 4 && after[3] == 4);
+        table.publish(std::vector<int>{9});
+        assert(before[2] == 3 && after[3] == 4 && table.read()[0] == 9);
+
+        bool threw = false;
+        try {
+            ext::rcu_vector<int>::synchronize();
+        } catch(const std::logic_error&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    ext::rcu_vector<int>::synchronize();
+
+    // a throwing update publishes nothing
+    try {
+        table.update([](std::vector<int>& v) { v.clear(); throw std::runtime_error("abort"); });
+    } catch(const std::runtime_error&) {
+    }
+    assert(table.read().size() == 1);
+
+    // readers always see a complete version: every element equal to the first
+    ext::rcu_vector<long> shared(std::vector<long>(256, 0));
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+    std::vector<std::thread> readers;
+    for(int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            while(!done.load()) {
+                auto s = shared.read();
+                for(long x : s) {
+                    if(x != s[0]) torn.fetch_add(1);
+                }
+            }
+        });
+    }
+    for(long w = 1; w <= 200; ++w) {
+        shared.update([w](std::vector<long>& v) { std::fill(v.begin(), v.end(), w); });
+    }
+    done.store(true);
+    for(auto& t : readers) t.join();
+    assert(torn.load() == 0 && shared.read()[255] == 200);
+
+    std::cout << "✓ RCU vector passed" << std::endl;
+}
+
+void test_vector_stats() {
+    std::cout << "Testing vector stats..." << std::endl;
+
+    auto find = [](const std::string& type) {
+        for(const ext::vector_stats& s : ext::collect_vector_stats()) {
+            if(s.type == type) return s;
+        }
+        return ext::vector_stats{};
+    };
+
+    ext::reset_vector_stats();
+    std::size_t reallocs = 0, relocated = 0, peak_capacity = 0;
+    {
+        std::vector<stats_probe> v;
+        for(int i = 0; i < 100; ++i) {
+            if(v.size() == v.capacity() && v.capacity() != 0) {
+                ++reallocs;
+                relocated += v.size();
+            }
+            v.push_back({i});
+        }
+        v.reserve(1000);
+        peak_capacity = v.capacity();
+        ++reallocs;
+        relocated += 100;
+        v.resize(10);
+        v.shrink_to_fit();
+        relocated += 10;
+    }
+    ext::vector_stats s = find("vector<stats_probe>");
+    assert(s.element_size == sizeof(stats_probe));
+    assert(s.allocations == 2);  // the first push_back and shrink_to_fit's new block
+    assert(s.total_reallocations() == reallocs && s.reallocations[0] == 1);
+    assert(s.shrinks == 1);
+    assert(s.moved == relocated && s.copied == 0);
+    assert(s.bytes_relocated == relocated * sizeof(stats_probe));
+    assert(s.peak_size == 100 && s.peak_capacity == peak_capacity);
+
+    // move_if_noexcept copies when the move constructor may throw
+    {
+        std::vector<stats_copy_probe> v(4, stats_copy_probe(1));
+        v.reserve(8);
+    }
+    s = find("vector<stats_copy_probe>");
+    assert(s.copied == 4 && s.moved == 0 && s.peak_size == 4 && s.peak_capacity == 8);
+
+    std::ostringstream json, text;
+    ext::write_vector_stats(json, ext::vector_stats_format::json);
+    ext::write_vector_stats(text);
+    assert(json.str().find("\"type\": \"vector<stats_probe>\"") != std::string::npos);
+    assert(json.str().find("\"bytes_relocated\": ") != std::string::npos);
+    assert(text.str().find("vector<stats_copy_probe>") != std::string::npos);
+
+    ext::reset_vector_stats();
+    assert(find("vector<stats_probe>").peak_size == 0);
+
+    std::cout << "✓ Vector stats passed" << std::endl;
+}
+
+void test_growth_sites() {
+    std::cout << "Testing growth sites..." << std::endl;
+
+    // one site per source location, however often it is reached
+    ext::detail::growth_site* seen[2];
+    for(int i = 0; i < 2; ++i) seen[i] = ext::this_site().site;
+    assert(seen[0] == seen[1]);
+
+    ext::growth_site_tag grown = ext::this_site();
+    ext::growth_site_tag reserved = ext::this_site();
+    assert(grown.site != reserved.site && grown.site->line + 1 == reserved.site->line);
+    for(int i = 0; i < 3; ++i) {
+        ext::sited_vector<long> v(grown);
+        for(long j = 0; j < 100; ++j) v.push_back(j);
+    }
+    {
+        ext::sited_vector<long> v(reserved);
+        v.reserve(100);
+        for(long j = 0; j < 100; ++j) v.push_back(j);
+        ext::sited_vector<long> copy(v);  // copies report to the same site
+        assert(copy.get_allocator().site() == reserved.site);
+    }
+    // capacities 1, 2, 4, ..., 128: seven reallocations moving 127 elements per vector
+    const ext::detail::growth_site& g = *grown.site;
+    assert(g.vectors == 3 && g.reallocations == 21 && g.bytes_relocated == 3 * 127 * sizeof(long));
+    assert(g.max_size == 100 && g.live_bytes == 0);
+    assert(g.peak_live_bytes == (64 + 128) * sizeof(long));  // old and new block during the last move
+    assert(ext::detail::slack_share(g) > 0.0 && ext::detail::slack_share(g) < 0.5);
+    const ext::detail::growth_site& r = *reserved.site;
+    assert(r.vectors == 2 && r.reallocations == 0 && r.live_bytes == 0);
+
+    std::FILE* out = std::tmpfile();
+    ext::write_growth_report(fileno(out));
+    std::rewind(out);
+    std::string report;
+    char buf[512];
+    for(std::size_t n; (n = std::fread(buf, 1, sizeof(buf), out)) > 0;) report.append(buf, n);
+    std::fclose(out);
+    assert(report.find("reserve(100)") != std::string::npos);
+    // the site that reallocated ranks above the one that reserved
+    const std::string grown_at = ":" + std::to_string(g.line) + " ";
+    const std::string reserved_at = ":" + std::to_string(r.line) + " ";
+    assert(report.find(grown_at) != std::string::npos && report.find(grown_at) < report.find(reserved_at));
+
+    std::cout << "✓ Growth sites passed" << std::endl;
+}
+
+void test_vector_trace() {
+    std::cout << "Testing vector trace..." << std::endl;
+
+    auto probe_events = [] {
+        std::vector<ext::vector_trace_event> out;
+        for(const ext::vector_trace_event& e : ext::vector_trace_events()) {
+            if(e.elem_size == sizeof(trace_probe)) out.push_back(e);
+        }
+        return out;
+    };
+    assert(probe_events().empty());
+    {
+        std::vector<trace_probe> v;
+        for(int i = 0; i < 16; ++i) v.push_back({});  // only the 4 -> 8 and 8 -> 16 moves reach 4 KiB
+        std::vector<trace_probe> copy(v);
+        v.resize(2);
+        v.shrink_to_fit();  // 2 KiB, not traced
+    }
+    std::vector<ext::vector_trace_event> events = probe_events();
+    assert(events.size() == 3);
+    assert(events[0].event == std::vector_event::append && events[0].old_cap == 4 && events[0].new_cap == 8 && events[0].count == 4);
+    assert(events[1].event == std::vector_event::append && events[1].old_cap == 8 && events[1].new_cap == 16 && events[1].count == 8);
+    assert(events[2].event == std::vector_event::copy && events[2].old_cap == 16 && events[2].new_cap == 16 && events[2].count == 16);
+    assert(events[0].start_ns <= events[1].start_ns && events[1].start_ns <= events[2].start_ns && events[0].tid != 0);
+
+    std::ostringstream text;
+    ext::write_vector_trace(text);
+    assert(text.str().find(" copy 16 -> 16 x1024B, 16 elements, ") != std::string::npos);
+
+    std::cout << "✓ Vector trace passed" << std::endl;
+}
+
+void test_op_trace() {
+    std::cout << "Testing op trace..." << std::endl;
+
+    using op = ext::op_trace_op;
+    const char* path = "/tmp/vector_test_op_trace.bin";
+    ext::recorded_vector<int> before{1, 2, 3};   // holds elements when the trace starts
+    ext::start_op_trace(path);
+    {
+        ext::recorded_vector<long> v;
+        v.reserve(4);
+        for(long i = 0; i < 6; ++i) v.push_back(i);
+        v.insert(v.begin() + 1, 3, 7L);
+        v.erase(v.begin(), v.begin() + 2);
+        v.pop_back();
+        v.resize(2);
+        ext::recorded_vector<long> moved = std::move(v);  // keeps v's id
+        moved.clear();
+        moved.shrink_to_fit();
+        before.push_back(4);
+    }
+    ext::stop_op_trace();
+    before.push_back(5);  // not recorded
+
+    std::vector<ext::op_trace_record> r = ext::read_op_trace(path);
+    const std::vector<ext::op_trace_record> expected{
+        {op::create, 1, sizeof(long), 0}, {op::reserve, 1, 4, 0},
+        {op::push_back, 1, 0, 0}, {op::push_back, 1, 0, 0}, {op::push_back, 1, 0, 0},
+        {op::push_back, 1, 0, 0}, {op::push_back, 1, 0, 0}, {op::push_back, 1, 0, 0},
+        {op::insert, 1, 1, 3}, {op::erase, 1, 0, 2}, {op::pop_back, 1, 0, 0}, {op::resize, 1, 2, 0},
+        {op::clear, 1, 0, 0}, {op::shrink, 1, 0, 0},
+        {op::create, 2, sizeof(int), 0}, {op::reserve, 2, 3, 0}, {op::resize, 2, 3, 0}, {op::push_back, 2, 0, 0},
+        {op::destroy, 1, 0, 0}};
+    assert(r.size() == expected.size());
+    for(std::size_t i = 0; i < r.size(); ++i) {
+        assert(r[i].op == expected[i].op && r[i].id == expected[i].id && r[i].a == expected[i].a && r[i].b == expected[i].b);
+    }
+
+    // an erase past the end of the vector is rejected when reading
+    {
+        std::FILE* f = std::fopen(path, "ab");
+        const unsigned char bad[] = {static_cast<unsigned char>(op::erase), 2, 3, 5};
+        std::fwrite(bad, 1, sizeof(bad), f);
+        std::fclose(f);
+    }
+    bool threw = false;
+    try {
+        ext::read_op_trace(path);
+    } catch(const ext::op_trace_error&) {
+        threw = true;
+    }
+    assert(threw);
+
+    // two traces in a row: a vector from the first starts over in the second
+    {
+        ext::recorded_vector<int> old_one;
+        ext::start_op_trace(path);
+        old_one.push_back(1);
+        ext::stop_op_trace();
+        ext::start_op_trace(path);
+        ext::recorded_vector<int> new_one;
+        new_one.push_back(1);
+        old_one.push_back(2);
+        ext::stop_op_trace();
+        r = ext::read_op_trace(path);
+        const std::vector<ext::op_trace_record> second{
+            {op::create, 1, sizeof(int), 0}, {op::push_back, 1, 0, 0},
+            {op::create, 2, sizeof(int), 0}, {op::reserve, 2, 1, 0}, {op::resize, 2, 1, 0}, {op::push_back, 2, 0, 0}};
+        assert(r.size() == second.size());
+        for(std::size_t i = 0; i < r.size(); ++i) {
+            assert(r[i].op == second[i].op && r[i].id == second[i].id && r[i].a == second[i].a && r[i].b == second[i].b);
+        }
+    }
+    std::remove(path);
+
+    std::cout << "✓ Op trace passed" << std::endl;
+}
+
+// throws from its copy constructor once copies_left copies have been made
+struct copy_bomb {
+    static inline int copies_left = 0;
+    std::string payload = std::string(40, 'x');
+    copy_bomb() = default;
+    copy_bomb(const copy_bomb& other) : payload(other.payload) {
+        if(copies_left-- == 0) throw std::runtime_error("copy_bomb");
+    }
+};
+
+void test_incremental_vector() {
+    std::cout << "Testing incremental vector..." << std::endl;
+
+    ext::incremental_vector<std::string> v;
+    for(int i = 0; i < 8; ++i) v.push_back(std::to_string(i));
+    assert(v.capacity() == 8 && !v.migrating());
+
+    // growing leaves the elements in the old buffer and moves two per push_back
+    v.push_back("8");
+    assert(v.capacity() == 16 && v.migrating() && v.pending() == 8);
+    for(int i = 0; i < 9; ++i) assert(v[i] == std::to_string(i));
+    v.push_back(v[7]);      // an element still in the old buffer
+    assert(v.pending() == 6 && v[9] == "7" && v[0] == "0" && v[7] == "7");
+
+    // popping into the old range shortens what is left to move
+    v.pop_back();
+    v.pop_back();
+    assert(v.size() == 8 && v.pending() == 6 && v.back() == "7");
+    v.pop_back();
+    assert(v.size() == 7 && v.pending() == 5 && v.back() == "6");
+    for(int i = 0; i < 3; ++i) v.push_back("x");
+    assert(!v.migrating() && v.size() == 10);
+    for(int i = 0; i < 7; ++i) assert(v.at(i) == std::to_string(i));
+
+    // iteration and copies see the elements in order wherever they are
+    ext::incremental_vector<int> n;
+    for(int i = 0; i < 1000; ++i) {
+        n.push_back(i);
+        assert(n.pending() <= n.capacity() - n.size() + 1);
+    }
+    assert(std::accumulate(n.begin(), n.end(), 0) == 999 * 1000 / 2);
+    for(int i = 0; i < 30; ++i) n.push_back(i);
+    assert(n.migrating() && n.capacity() == 2048);
+    ext::incremental_vector<int> copy = n;
+    assert(copy == n && !copy.migrating() && std::is_sorted(copy.begin(), copy.begin() + 1000));
+    const int* p = n.contiguous();
+    assert(!n.migrating() && p[1010] == 10 && std::equal(p, p + 1030, copy.begin()));
+
+    n.clear();
+    assert(n.empty() && n.capacity() == 2048);
+
+    // move-only elements
+    ext::incremental_vector<std::unique_ptr<int>> u;
+    for(int i = 0; i < 100; ++i) u.emplace_back(std::make_unique<int>(i));
+    assert(*u[64] == 64 && *u.back() == 99);
+
+    // a copy that throws part way frees what it had built (checked under ASan)
+    copy_bomb::copies_left = 1000;
+    ext::incremental_vector<copy_bomb> bombs;
+    for(int i = 0; i < 10; ++i) bombs.emplace_back();
+    for(int limit : {0, 4, 9}) {
+        copy_bomb::copies_left = limit;
+        bool threw = false;
+        try {
+            ext::incremental_vector<copy_bomb> copy_of_bombs = bombs;
+        } catch(const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    copy_bomb::copies_left = 2;
+    bool threw = false;
+    try {
+        ext::incremental_vector<copy_bomb> listed{copy_bomb(), copy_bomb(), copy_bomb(), copy_bomb()};
+    } catch(const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    copy_bomb::copies_left = 1000;
+
+    std::cout << "✓ incremental vector passed" << std::endl;
+}
+
+void test_capacity_hints() {
+    std::cout << "Testing capacity hints..." << std::endl;
+
+    // sixteen vectors that ended with 100 elements teach the site to start at 100
+    ext::hint_site_tag site = ext::this_hint_site();
+    for(int i = 0; i < 16; ++i) {
+        assert(ext::capacity_hint(site) == 0);
+        ext::hinted_vector<int> v(site);
+        for(int j = 0; j < 100; ++j) v.push_back(j);
+    }
+    const std::size_t hint = ext::capacity_hint(site);
+    assert(hint >= 100 && hint <= 100 + 100 / 8);
+    {
+        ext::hinted_vector<int> v(site);
+        v.push_back(1);
+        assert(v.capacity() == hint);
+        ext::hinted_vector<int> reserved(site);
+        reserved.reserve(5);
+        assert(reserved.capacity() == 5);
+        ext::hinted_vector<int> plain;      // no site, no hint
+        plain.push_back(1);
+        assert(plain.capacity() == 1);
+    }
+
+    // a saved table gives another run's sites their hints before they have learned any
+    const char* path = "/tmp/vector_test_capacity_hints.tsv";
+    ext::save_capacity_hints(path);
+    ext::hint_site_tag fresh = ext::this_hint_site();
+    {
+        std::FILE* f = std::fopen(path, "a");
+        std::fprintf(f, "500\t3\t%u\t%s\t%s\n", static_cast<unsigned>(fresh.site->line), fresh.site->file, fresh.site->function);
+        std::fclose(f);
+    }
+    assert(ext::load_capacity_hints(path));
+    assert(ext::capacity_hint(fresh) == 500 && ext::capacity_hint(site) == hint);
+    ext::hinted_vector<int> v(fresh);
+    v.emplace_back(1);
+    assert(v.capacity() == 500);
+
+    // 18 samples: the two vectors of the block above count as well
+    std::ifstream saved(path);
+    std::string header, row;
+    std::getline(saved, header);
+    std::getline(saved, row);
+    assert(header == "vector capacity hints 1" && row.find(std::to_string(hint) + "\t18\t" + std::to_string(site.site->line) + "\t") == 0);
+    std::remove(path);
+    assert(!ext::load_capacity_hints(path));
+
+    std::cout << "✓ capacity hints passed" << std::endl;
+}
+
+void test_shrink_policy() {
+    std::cout << "Testing shrink policy..." << std::endl;
+
+    // below a quarter of the capacity, shrink to twice the size
+    ext::shrinking_vector<int> v;
+    for(int i = 0; i < 1000; ++i) v.push_back(i);
+    assert(v.capacity() == 1024);
+    while(v.size() > 256) v.pop_back();
+    assert(v.capacity() == 1024);
+    // a shrink moves every element, so even &v[1] is invalidated by a pop_back
+    const int* second = &v[1];
+    v.pop_back();
+    assert(v.size() == 255 && v.capacity() == 510 && v.back() == 254);
+    assert(&v[1] != second && v[1] == 1);
+
+    // hovering around the threshold does not reallocate
+    for(int i = 0; i < 10; ++i) {
+        v.push_back(1);
+        v.pop_back();
+    }
+    assert(v.capacity() == 510);
+    v.erase(v.begin(), v.begin() + 155);
+    assert(v.size() == 100 && v.capacity() == 200 && v.front() == 155);
+    v.resize(40);
+    assert(v.capacity() == 80);
+    v.clear();
+    assert(v.capacity() == 16);
+
+    // lazy: removing leaves the buffer, the next push_back shrinks it
+    ext::lazy_shrinking_vector<std::string> lazy(ext::shrink_options{0.1, 4, 0});
+    for(int i = 0; i < 100; ++i) lazy.push_back(std::to_string(i));
+    lazy.erase(lazy.begin() + 5, lazy.end());
+    assert(lazy.size() == 5 && lazy.capacity() == 128);
+    // the push_back fits in the capacity and still moves every element
+    const std::string* first = &lazy[0];
+    lazy.push_back(lazy[0]);
+    assert(lazy.size() == 6 && lazy.capacity() == 24 && lazy.back() == "0" && lazy[4] == "4");
+    assert(&lazy[0] != first);
+    lazy.clear();
+    assert(lazy.capacity() == 24);
+
+    bool threw = false;
+    try {
+        ext::shrinking_vector<int> thrash(ext::shrink_options{0.5, 2, 0});
+    } catch(const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::cout << "✓ shrink policy passed" << std::endl;
+}
+
+// pages of [p, p + bytes) that are resident
+static std::size_t resident_pages(const void* p, std::size_t bytes) {
+    const std::size_t page = ext::detail::page_size();
+    std::vector<unsigned char> in_core((bytes + page - 1) / page);
+    assert(mincore(const_cast<void*>(p), bytes, in_core.data()) == 0);
+    return std::count_if(in_core.begin(), in_core.end(), [](unsigned char c) { return c & 1; });
+}
+
+void test_page_release() {
+    std::cout << "Testing page release..." << std::endl;
+
+    const std::size_t page = ext::detail::page_size();
+    const std::size_t per_page = page / sizeof(int);
+    ext::page_vector<int> v;
+    v.reserve(64 * per_page);
+    assert(reinterpret_cast<std::uintptr_t>(v.data()) % page == 0);
+    for(std::size_t i = 0; i < 64 * per_page; ++i) v.push_back(static_cast<int>(i));
+    assert(resident_pages(v.data(), 64 * page) == 64);
+
+    // keep 10.5 pages of elements: the page they end in stays, the other 53 go
+    v.resize(10 * per_page + per_page / 2);
+    const int* data = v.data();
+    assert(ext::release_unused_pages(v) == 53 * page);
+    assert(resident_pages(data, 64 * page) == 11 && v.capacity() == 64 * per_page && v.data() == data);
+    assert(v.back() == static_cast<int>(v.size() - 1));
+
+    // refilling reuses the capacity
+    for(std::size_t i = v.size(); i < 64 * per_page; ++i) v.push_back(1);
+    assert(v.data() == data && resident_pages(data, 64 * page) == 64);
+
+    assert(ext::clear_and_release(v, ext::page_release::lazy_free) == 64 * page);
+    assert(v.empty() && v.capacity() == 64 * per_page);
+    ext::clear_and_release(v);
+    assert(resident_pages(data, 64 * page) == 0);
+
+    // any allocator: only the pages wholly inside the unused part
+    std::vector<int> plain(64 * per_page);
+    plain.resize(per_page);
+    const std::size_t released = ext::release_unused_pages(plain);
+    assert(released % page == 0 && released >= 61 * page && released <= 63 * page);
+    assert(ext::release_unused_pages(plain) == released);
+
+    std::cout << "✓ page release passed" << std::endl;
+}
+
+void test_reserved_vector() {
+    std::cout << "Testing reserved vector..." << std::endl;
+
+    const std::size_t page = ext::detail::page_size();
+    ext::reserved_vector<int> v;
+    v.push_back(0);
+    const int* data = v.data();
+    const int& first = v.front();
+    auto it = v.begin();
+    for(int i = 1; i < 1000000; ++i) v.push_back(i);
+    assert(v.data() == data && &first == data && it == v.begin() && *it == 0);
+    assert(v.back() == 999999 && v.size() == 1000000 && v.capacity() >= v.size());
+    assert(v.max_size() == ext::reserving_allocator<int>::default_reservation / sizeof(int));
+
+    // resize, reserve and insert grow in place too
+    v.resize(3000000, 7);
+    v.reserve(5000000);
+    v.insert(v.begin() + 1, 100, -1);
+    assert(v.data() == data && v[1] == -1 && v[101] == 1 && v.back() == 7);
+
+    // only the pages written are resident, not the capacity
+    assert(resident_pages(data, v.capacity() * sizeof(int)) <= (v.size() * sizeof(int) + page - 1) / page);
+
+    // a small reservation is the limit
+    ext::reserved_vector<long> small(ext::reserving_allocator<long>(4 * page));
+    assert(small.max_size() == 4 * page / sizeof(long));
+    small.resize(small.max_size(), 1);
+    const long* small_data = small.data();
+    bool threw = false;
+    try{
+        small.push_back(2);
+    }catch(const std::length_error&){
+        threw = true;
+    }
+    assert(threw && small.data() == small_data && small.size() == small.max_size());
+
+    // copies get a reservation of their own; moves keep the block
+    ext::reserved_vector<long> copy(small);
+    assert(copy.data() != small.data() && copy == small);
+    ext::reserved_vector<long> moved(std::move(copy));
+    assert(moved.get_allocator().reservation() == 4 * page && moved == small);
+    copy = small;
+    small = std::move(moved);
+    assert(small.data() != small_data && copy == small);
+
+    // the committed pages past the capacity can be released
+    v.resize(page / sizeof(int));
+    assert(ext::release_unused_pages(v) == (v.capacity() * sizeof(int) + page - 1) / page * page - page);
+    v.push_back(42);
+    assert(v.back() == 42 && v.data() == data);
+
+    std::cout << "✓ reserved vector passed" << std::endl;
+}
+
+void test_zeroed_allocation() {
+    std::cout << "Testing zeroed allocation..." << std::endl;
+
+    // a fresh mapping is taken as the zeros: nothing becomes resident
+    const std::size_t page = ext::detail::page_size();
+    const std::size_t n = 1024 * page / sizeof(int);
+    ext::page_vector<int> pages(n);
+    assert(pages.size() == n && pages.capacity() == n);
+    assert(resident_pages(pages.data(), n * sizeof(int)) == 0);
+    assert(pages[0] == 0 && pages[n / 2] == 0 && pages.back() == 0);
+    assert(resident_pages(pages.data(), n * sizeof(int)) <= 3);
+
+    // resize into a new block: the old elements move, the new ones are zeros
+    ext::page_vector<double> grown(3, 1.5);
+    grown.resize(n);
+    assert(grown[2] == 1.5 && grown[3] == 0 && grown.back() == 0);
+    assert(resident_pages(grown.data(), n * sizeof(double)) <= 3);
+
+    // within the capacity the memory is not fresh, so resize writes the zeros
+    grown.resize(10);
+    grown[5] = 7;
+    grown.resize(20);
+    grown.resize(10);
+    grown.resize(n / 2);
+    assert(grown[5] == 7 && grown[10] == 0 && grown[19] == 0);
+
+    ext::reserved_vector<int*> pointers(1000);
+    assert(std::all_of(pointers.begin(), pointers.end(), [](int* p){ return p == nullptr; }));
+
+    // calloc, for a recycled block as well as a fresh one
+    for(int round = 0; round < 3; ++round){
+        ext::calloc_vector<long> counts(100000);
+        assert(std::all_of(counts.begin(), counts.end(), [](long x){ return x == 0; }));
+        std::fill(counts.begin(), counts.end(), -1L);
+        ext::calloc_vector<long> small;
+        small.resize(100);
+        assert(std::all_of(small.begin(), small.end(), [](long x){ return x == 0; }));
+        small.assign(100, -1L);
+    }
+
+    // class types are still value-initialised one by one
+    struct point{
+        int x, y;
+    };
+    ext::calloc_vector<point> points(1000);
+    assert(points[999].x == 0 && points[999].y == 0);
+    static_assert(std::is_trivially_default_constructible_v<point>);
+
+    std::cout << "✓ zeroed allocation passed" << std::endl;
+}
+
 int main() {
     std::cout << "Running std::vector unit tests...\n" << std::endl;
     
@@ -336,6 +1409,25 @@ int main() {
         test_move_operations();
         test_iterators();
         test_front_back();
+        test_simd_algo();
+        test_simd_erase_if();
+        test_snapshot();
+        test_ingest();
+        test_pmr_arena();
+        test_pool_allocator();
+        test_persistent_vector();
+        test_cow_vector();
+        test_rcu_vector();
+        test_vector_stats();
+        test_growth_sites();
+        test_vector_trace();
+        test_op_trace();
+        test_incremental_vector();
+        test_capacity_hints();
+        test_shrink_policy();
+        test_page_release();
+        test_reserved_vector();
+        test_zeroed_allocation();
         
         std::cout << "\n✅ All tests passed!" << std::endl;
         return 0;
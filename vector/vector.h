@@ -9,8 +9,164 @@
 #include <limits>
 #include <iterator>
 #include <compare>
+#include <cstdint>
 
 namespace std{
+    namespace pmr{
+        template<class T> class polymorphic_allocator;
+    }
+
+    /*
+        Customization point for growing in place.
+        A specialization with enabled = true and a static
+            bool expand(Alloc& alloc, pointer p, size_type old_cap, size_type new_cap)
+        that tries to extend the block at p (allocated with old_cap elements) to
+        new_cap elements without moving it is asked first whenever the vector needs
+        more capacity. On success nothing is relocated; the block must then be
+        deallocated with new_cap.
+        polymorphic_allocator is specialized at the end of this file for resources
+        derived from vector_expandable_resource.
+    */
+    template<class Alloc>
+    struct vector_allocator_expand{
+        static constexpr bool enabled = false;
+    };
+
+    /*
+        Customization point for memory that comes zeroed.
+        A specialization with enabled = true and a static
+            pointer allocate_zeroed(Alloc& alloc, size_type n)
+        that allocates n elements like allocate, but with every byte zero (a
+        fresh mmap, calloc), lets the count constructor and resize(count) take
+        the value-initialised elements as they are instead of writing them, when
+        T is a scalar other than a member pointer (whose value-initialised bits
+        are all zero) and alloc does not construct itself. A page that is never
+        written then never becomes resident. The block is deallocated as usual.
+        This covers a new block only: resize within the capacity, or into
+        capacity from vector_allocator_expand, still writes the zeros.
+        ext/page_release.h, ext/reserved_vector.h and ext/calloc_allocator.h
+        specialize it.
+    */
+    template<class Alloc>
+    struct vector_allocator_zeroed{
+        static constexpr bool enabled = false;
+    };
+
+    //what a reallocation reported to vector_stats_policy or vector_trace_policy was for
+    enum class vector_event{
+        grow,       //reserve, construction and range insert/assign
+        append,     //push_back/emplace_back on a full vector
+        resize,     //resize past capacity
+        insert,     //insert/emplace on a full vector
+        shrink,     //shrink_to_fit, or vector_shrink_policy giving capacity back
+        copy        //copy construction (vector_trace_policy only)
+    };
+
+    /*
+        Customization point for operation statistics.
+        A specialization with enabled = true and the static noexcept hooks
+            void relocated(const Alloc& alloc, vector_event event, size_type old_cap, size_type new_cap, size_type count, bool moved)
+                a new block of new_cap elements replaced one of old_cap (0 for the
+                first allocation) and count elements were moved into it, or copied
+                when moved == false (move_if_noexcept falls back to copying when T's
+                move constructor may throw)
+            void expanded(const Alloc& alloc, size_type old_cap, size_type new_cap)
+                vector_allocator_expand grew the block in place
+            void size_grew(const Alloc& alloc, size_type size, size_type capacity)
+                an operation left the vector with more elements than before
+            void released(const Alloc& alloc, size_type size, size_type capacity)
+                a vector that had allocated was destroyed holding size elements
+        is told about every reallocation, size increase and destruction; alloc is
+        the vector's own allocator, so stateful allocators can tell vectors (or the
+        places that created them) apart. The primary template
+        is disabled and every hook call is then discarded by if constexpr.
+        ext/vector_stats.h provides a recorder that counts per instantiation;
+        defining VECTOR_STATS (for the whole program) enables it for every vector.
+    */
+#ifdef VECTOR_STATS
+    template<class T, class Alloc>
+    struct vector_stats_default;
+
+    template<class T, class Alloc>
+    struct vector_stats_policy : vector_stats_default<T, Alloc>{};
+#else
+    template<class T, class Alloc>
+    struct vector_stats_policy{
+        static constexpr bool enabled = false;
+    };
+#endif
+
+    /*
+        Customization point for tracing reallocations and copies, e.g. to line up
+        latency spikes with them in perf or bpftrace.
+        A specialization with enabled = true and the static noexcept hooks
+            std::uint64_t start(vector_event event, size_t bytes)
+                about to move (or copy, for vector_event::copy) bytes worth of
+                elements; returns a start timestamp, or 0 to not trace this one
+            void finish(std::uint64_t start, vector_event event, size_t old_cap, size_t new_cap, size_t elem_size, size_t count)
+                the operation is done; count elements went from a block of old_cap
+                (for a copy, the source's capacity) to one of new_cap
+        brackets grow, realloc_append, realloc_resize, realloc_insert, the
+        reallocating insert, shrink_to_fit and the copy constructors. As with
+        vector_stats_policy the primary template is disabled and the calls vanish.
+        ext/vector_trace.h provides a ring buffer tracer with optional USDT probes;
+        defining VECTOR_TRACE (for the whole program) enables it for every vector.
+    */
+#ifdef VECTOR_TRACE
+    template<class T, class Alloc>
+    struct vector_trace_default;
+
+    template<class T, class Alloc>
+    struct vector_trace_policy : vector_trace_default<T, Alloc>{};
+#else
+    template<class T, class Alloc>
+    struct vector_trace_policy{
+        static constexpr bool enabled = false;
+    };
+#endif
+
+    /*
+        Customization point for the capacity of a vector's first buffer.
+        A specialization with enabled = true and the static noexcept hook
+            size_t first_capacity(const Alloc& alloc, size_t needed)
+                a vector without a buffer is growing into one of needed elements
+                (push_back, emplace_back, insert or resize); returns the capacity
+                to allocate instead, ignored when it is not larger
+        is asked once per vector, unless reserve(), assign or a sized constructor
+        allocated first. alloc is the vector's own allocator, as for
+        vector_stats_policy. The primary template is disabled.
+        ext/capacity_hints.h learns the capacity per call site.
+    */
+    template<class T, class Alloc>
+    struct vector_capacity_policy{
+        static constexpr bool enabled = false;
+    };
+
+    /*
+        Customization point for giving capacity back as a vector empties.
+        A specialization with enabled = true,
+            static constexpr bool lazy
+                false: pop_back, erase, a shrinking resize and clear shrink before
+                they return; true: they never reallocate, and the next push_back,
+                emplace_back or growing resize shrinks after adding its elements
+            size_t shrink_to(const Alloc& alloc, size_t size, size_t capacity) noexcept
+                the capacity to reallocate to, at least size; returning capacity
+                (or more) keeps the buffer
+        is asked after each of those calls. The reallocation is non-binding like
+        shrink_to_fit: if it throws, the vector keeps its buffer. When it happens
+        it invalidates every iterator, pointer and reference, as a reallocation
+        does: with lazy = false a pop_back, erase, shrinking resize or clear can
+        invalidate all of them, with lazy = true a push_back or emplace_back can
+        even when size() < capacity(). Growth and shrinking must leave room
+        between them, or the vector reallocates back and forth. The primary
+        template is disabled.
+        ext/shrink_policy.h shrinks below a fraction of the capacity.
+    */
+    template<class T, class Alloc>
+    struct vector_shrink_policy{
+        static constexpr bool enabled = false;
+    };
+
     template <class T, class Allocator = std::allocator<T>>
     class vector{
         static_assert(std::is_same_v<typename std::allocator_traits<Allocator>::value_type, T>,
@@ -180,6 +336,11 @@ namespace std{
                 throw std::length_error("vector::vector: count exceeds max_size()");
             }
 
+            if(allocate_zeroed(count)){
+                m_finish = m_start + count;
+                stats_size_grew();
+                return;
+            }
             grow(count);
             try{
                 for(size_type i = 0; i < count; ++i){
@@ -193,6 +354,7 @@ namespace std{
                 m_start = m_finish = m_end_of_storage = nullptr;
                 throw;
             }
+            stats_size_grew();
         }
 
         constexpr vector(size_type count, const T& value, const Allocator& alloc = Allocator()): rebound_alloc(alloc), m_start(nullptr), m_finish(nullptr), m_end_of_storage(nullptr){
@@ -214,6 +376,7 @@ namespace std{
                 m_start = m_finish = m_end_of_storage = nullptr;
                 throw;
             }
+            stats_size_grew();
         }
 
         template<class InputIt>
@@ -227,9 +390,13 @@ namespace std{
         }
 
         //Copy Constructor
-        constexpr vector(const vector& other): vector(other.m_start, other.m_finish, std::allocator_traits<rebound_alloc_type>::select_on_container_copy_construction(other.rebound_alloc)){}
+        constexpr vector(const vector& other): vector(other, std::allocator_traits<rebound_alloc_type>::select_on_container_copy_construction(other.rebound_alloc)){}
 
-        constexpr vector(const vector& other, const Allocator& alloc): vector(other.m_start, other.m_finish, alloc){}
+        constexpr vector(const vector& other, const Allocator& alloc): rebound_alloc(alloc), m_start(nullptr), m_finish(nullptr), m_end_of_storage(nullptr){
+            const std::uint64_t trace_t0 = trace_start(vector_event::copy, other.size());
+            range_initialize(other.m_start, other.m_finish);
+            trace_finish(trace_t0, vector_event::copy, other.capacity(), capacity(), size());
+        }
 
         //Move Constructor
         //Note: noexcept here so that we can use it in the resizing function. if it's not noexcept,
@@ -272,11 +439,13 @@ namespace std{
                     m_start = m_finish = m_end_of_storage = nullptr;
                     throw;
                 }
+                stats_size_grew();
             }
         }
 
         //Destructor
         constexpr ~vector(){
+            stats_released();
             destroy_and_deallocate(m_start, m_finish, capacity());
         }
 
@@ -310,6 +479,7 @@ namespace std{
                     }
 
                     m_finish = m_start + n;
+                    stats_size_grew();
                 }
                 else{
                     vector temp(other);
@@ -367,6 +537,7 @@ namespace std{
                             }
                         }
                         m_finish = m_start+other_size;
+                        stats_size_grew();
                     }
                 }
             }
@@ -389,6 +560,7 @@ namespace std{
                     std::allocator_traits<rebound_alloc_type>::construct(rebound_alloc, std::to_address(m_finish), value);
                     m_finish++;
                 }
+                stats_size_grew();
             }
             else if(count < this_size){
                 for(pointer it = m_start+count; it != m_finish; ++it){
@@ -569,16 +741,7 @@ namespace std{
 
         //shrink to fit
         constexpr void shrink_to_fit(){
-            size_type this_size = size();
-            if(capacity() > this_size){
-                vector temp(rebound_alloc);
-                temp.reserve(this_size);
-                for(auto it = m_start; it != m_finish; ++it){
-                    std::allocator_traits<rebound_alloc_type>::construct(temp.rebound_alloc, std::to_address(temp.m_finish), std::move_if_noexcept(*it));
-                    temp.m_finish++;
-                }
-                swap(temp);
-            }
+            if(capacity() > size()) reallocate_to(size());
         }
 
         //clear
@@ -587,6 +750,7 @@ namespace std{
                 std::allocator_traits<rebound_alloc_type>::destroy(rebound_alloc, std::to_address(it));
             }
             m_finish = m_start;
+            policy_shrink(false);
         }
 
         //insert
@@ -609,6 +773,7 @@ namespace std{
                 std::allocator_traits<rebound_alloc_type>::construct(rebound_alloc, std::to_address(m_finish), value);
                 m_finish++;
             }
+            stats_size_grew();
             
             return iterator(m_start + idx);
         }
@@ -618,8 +783,7 @@ namespace std{
             size_type cap = capacity();
             size_type this_size = size();
             if (this_size == cap){
-                // T temp = std::move(value);
-                temp_value temp(this, value);
+                temp_value temp(this, std::move(value));
                 size_type new_cap = calculate_growth(1);
                 grow(new_cap);
                 return insert(begin() + idx, std::move(temp.get()));
@@ -635,6 +799,7 @@ namespace std{
             }
             
             m_finish++;
+            stats_size_grew();
         
             return iterator(m_start + idx);
         }
@@ -650,6 +815,10 @@ namespace std{
             if(cap-this_size < count){
                 //allocate new memory
                 size_type new_cap = calculate_growth(count);
+                if(expand_in_place(new_cap)){
+                    return insert(pos, count, value);
+                }
+                const std::uint64_t trace_t0 = trace_start(vector_event::insert, this_size);
                 pointer new_start = std::allocator_traits<rebound_alloc_type>::allocate(rebound_alloc, new_cap);
                 pointer new_finish = new_start;
                 pointer new_end_of_storage = new_start + new_cap;
@@ -711,6 +880,8 @@ namespace std{
                 m_start = new_start;
                 m_finish = new_finish;
                 m_end_of_storage = new_end_of_storage;
+                stats_relocated(vector_event::insert, cap, new_cap, this_size);
+                trace_finish(trace_t0, vector_event::insert, cap, new_cap, this_size);
             }
             else if(start_idx == this_size){
                 try{
@@ -751,6 +922,7 @@ namespace std{
                 
                 m_finish = m_start + this_size + count;
             }
+            stats_size_grew();
 
             return iterator(m_start+start_idx);
         }
@@ -786,6 +958,7 @@ namespace std{
                 }
             }
             m_finish = m_start+this_size+count;
+            stats_size_grew();
 
             return iterator(m_start+idx);
         }
@@ -832,6 +1005,7 @@ namespace std{
             }
             
             // m_finish++;
+            stats_size_grew();
         
             return iterator(m_start + idx);
         }
@@ -845,6 +1019,7 @@ namespace std{
             }
             std::allocator_traits<rebound_alloc_type>::destroy(rebound_alloc, std::to_address(m_start + sz - 1));
             m_finish--;
+            policy_shrink(false);
             return iterator(m_start+idx);
         }
 
@@ -867,6 +1042,7 @@ namespace std{
             }
             
             m_finish -= range;
+            policy_shrink(false);
             return iterator(m_start + first_idx);
         }
         
@@ -881,6 +1057,8 @@ namespace std{
             else{
                 realloc_append(value);
             }
+            stats_size_grew();
+            policy_shrink(true);
         }
 
 
@@ -900,6 +1078,8 @@ namespace std{
             else{
                 realloc_append(std::forward<Args>(args)...);
             }
+            stats_size_grew();
+            policy_shrink(true);
             return back();
         }
 
@@ -908,6 +1088,7 @@ namespace std{
             if(empty()) throw std::out_of_range("vector::pop_back: empty vector");
             m_finish--;
             std::allocator_traits<rebound_alloc_type>::destroy(rebound_alloc, std::to_address(m_finish));
+            policy_shrink(false);
         }
 
         //resize, strong exception gaurantee
@@ -930,6 +1111,8 @@ namespace std{
             if(count > sz){
                 if(count > capacity()){
                     realloc_resize(count);
+                    stats_size_grew();
+                    policy_shrink(true);
                     return;
                 }
                 else{
@@ -953,7 +1136,10 @@ namespace std{
                     std::allocator_traits<rebound_alloc_type>::destroy(rebound_alloc, std::to_address(it));
                 }
             }
+            const bool grew = count > sz;
             m_finish = m_start+count;
+            stats_size_grew();
+            policy_shrink(grew);
         }
 
         constexpr void resize(size_type count, const value_type& value){
@@ -965,6 +1151,8 @@ namespace std{
             if(count > sz){
                 if(count > capacity()){
                     realloc_resize(count,value);
+                    stats_size_grew();
+                    policy_shrink(true);
                     return;
                 }
                 else{
@@ -988,7 +1176,33 @@ namespace std{
                     std::allocator_traits<rebound_alloc_type>::destroy(rebound_alloc, std::to_address(it));
                 }
             }
+            const bool grew = count > sz;
             m_finish = m_start+count;
+            stats_size_grew();
+            policy_shrink(grew);
+        }
+
+        //resize_and_overwrite, modelled on basic_string::resize_and_overwrite
+        //Makes room for count elements and calls op(data(), count). op writes the elements
+        //it wants and returns the new size r <= count. The elements in [size(), r) are taken
+        //as written by op without being constructed, which is why T has to be trivially
+        //copyable. This lets a read()/memcpy fill the uninitialised capacity directly.
+        //If op throws, size() is unchanged (capacity may have grown).
+        template<class Operation>
+            requires std::is_trivially_copyable_v<T>
+        constexpr void resize_and_overwrite(size_type count, Operation op){
+            if(count > max_size()){
+                throw std::length_error("vector::resize_and_overwrite: count exceeds max_size()");
+            }
+            if(count > capacity()){
+                grow(count);
+            }
+            size_type r = static_cast<size_type>(std::move(op)(data(), count));
+            if(r > count){
+                throw std::length_error("vector::resize_and_overwrite: operation returned more than count");
+            }
+            m_finish = m_start + r;
+            stats_size_grew();
         }
 
         //swap
@@ -1105,7 +1319,7 @@ namespace std{
                     throw;
                 }
             }
-            
+            stats_size_grew();
         }
 
         template <typename It>
@@ -1198,6 +1412,7 @@ namespace std{
                     throw;
                 }
             }
+            stats_size_grew();
         }
 
         constexpr void destroy_and_deallocate(pointer start, pointer finish, size_type cap){
@@ -1209,6 +1424,113 @@ namespace std{
             m_start = m_finish = m_end_of_storage = nullptr;
         }
 
+        //extend the current block to new_cap elements without moving it, if the
+        //allocator supports that (see vector_allocator_expand)
+        constexpr bool expand_in_place(size_type new_cap){
+            if constexpr(vector_allocator_expand<rebound_alloc_type>::enabled){
+                size_type old_cap = capacity();
+                if(!std::is_constant_evaluated() && m_start
+                   && vector_allocator_expand<rebound_alloc_type>::expand(rebound_alloc, m_start, old_cap, new_cap)){
+                    m_end_of_storage = m_start + new_cap;
+                    if constexpr(vector_stats_policy<T, Allocator>::enabled){
+                        vector_stats_policy<T, Allocator>::expanded(rebound_alloc, old_cap, new_cap);
+                    }
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        //whether value-initialising T in memory from vector_allocator_zeroed can be skipped
+        static constexpr bool zeroed_is_value_initialized() noexcept{
+            return vector_allocator_zeroed<rebound_alloc_type>::enabled
+                && std::is_scalar_v<T> && !std::is_member_pointer_v<T>
+                && !requires(rebound_alloc_type& a, T* p){ a.construct(p); };
+        }
+
+        //allocate the first block as count value-initialised elements, if that
+        //memory comes zeroed (see vector_allocator_zeroed); false to construct them
+        constexpr bool allocate_zeroed(size_type count){
+            if constexpr(zeroed_is_value_initialized()){
+                if(std::is_constant_evaluated()) return false;
+                const std::uint64_t trace_t0 = trace_start(vector_event::grow, 0);
+                m_start = m_finish = vector_allocator_zeroed<rebound_alloc_type>::allocate_zeroed(rebound_alloc, count);
+                m_end_of_storage = m_start + count;
+                stats_relocated(vector_event::grow, 0, count, 0);
+                trace_finish(trace_t0, vector_event::grow, 0, count, 0);
+                return true;
+            }
+            return false;
+        }
+
+        //statistics hooks, see vector_stats_policy; nothing at all when it is disabled
+        constexpr void stats_relocated(vector_event event, size_type old_cap, size_type new_cap, size_type count) const noexcept{
+            if constexpr(vector_stats_policy<T, Allocator>::enabled){
+                if(!std::is_constant_evaluated()){
+                    constexpr bool moved = std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>;
+                    vector_stats_policy<T, Allocator>::relocated(rebound_alloc, event, old_cap, new_cap, count, moved);
+                }
+            }
+        }
+
+        constexpr void stats_size_grew() const noexcept{
+            if constexpr(vector_stats_policy<T, Allocator>::enabled){
+                if(!std::is_constant_evaluated()) vector_stats_policy<T, Allocator>::size_grew(rebound_alloc, size(), capacity());
+            }
+        }
+
+        //tracing hooks, see vector_trace_policy; nothing at all when it is disabled
+        constexpr std::uint64_t trace_start(vector_event event, size_type count) const noexcept{
+            if constexpr(vector_trace_policy<T, Allocator>::enabled){
+                if(!std::is_constant_evaluated()) return vector_trace_policy<T, Allocator>::start(event, count * sizeof(T));
+            }
+            return 0;
+        }
+
+        constexpr void trace_finish(std::uint64_t start, vector_event event, size_type old_cap, size_type new_cap, size_type count) const noexcept{
+            if constexpr(vector_trace_policy<T, Allocator>::enabled){
+                if(!std::is_constant_evaluated() && start) vector_trace_policy<T, Allocator>::finish(start, event, old_cap, new_cap, sizeof(T), count);
+            }
+        }
+
+        //shrinking hook, see vector_shrink_policy; `added` says whether the call
+        //that ends here added elements, which is when a lazy policy shrinks
+        constexpr void policy_shrink(bool added) noexcept{
+            if constexpr(vector_shrink_policy<T, Allocator>::enabled){
+                if(std::is_constant_evaluated() || vector_shrink_policy<T, Allocator>::lazy != added) return;
+                const size_type cap = capacity();
+                const size_type target = vector_shrink_policy<T, Allocator>::shrink_to(rebound_alloc, size(), cap);
+                if(target >= cap || target < size()) return;
+                try{
+                    reallocate_to(target);
+                }
+                catch(...){
+                    //non-binding, like shrink_to_fit
+                }
+            }
+        }
+
+        constexpr void stats_released() const noexcept{
+            if constexpr(vector_stats_policy<T, Allocator>::enabled){
+                if(!std::is_constant_evaluated() && m_start) vector_stats_policy<T, Allocator>::released(rebound_alloc, size(), capacity());
+            }
+        }
+
+        //move the elements into a buffer of exactly new_cap >= size() elements, strong exception gaurantee
+        constexpr void reallocate_to(size_type new_cap){
+            size_type this_size = size();
+            const std::uint64_t trace_t0 = trace_start(vector_event::shrink, this_size);
+            vector temp(rebound_alloc);
+            temp.reserve(new_cap);
+            for(auto it = m_start; it != m_finish; ++it){
+                std::allocator_traits<rebound_alloc_type>::construct(temp.rebound_alloc, std::to_address(temp.m_finish), std::move_if_noexcept(*it));
+                temp.m_finish++;
+            }
+            swap(temp);
+            stats_relocated(vector_event::shrink, temp.capacity(), capacity(), this_size);
+            trace_finish(trace_t0, vector_event::shrink, temp.capacity(), capacity(), this_size);
+        }
+
         constexpr void grow(size_type new_cap){
             if(new_cap > max_size()){
                 grow(max_size());
@@ -1218,6 +1540,10 @@ namespace std{
                 return;
             }
 
+            if(expand_in_place(new_cap)) return;
+
+            size_type old_cap = capacity();
+            const std::uint64_t trace_t0 = trace_start(vector_event::grow, size());
             pointer new_start = std::allocator_traits<rebound_alloc_type>::allocate(rebound_alloc, new_cap);
             pointer new_finish = new_start;
             try{
@@ -1238,6 +1564,8 @@ namespace std{
             m_start = new_start;
             m_finish = new_finish;
             m_end_of_storage = new_start + new_cap;
+            stats_relocated(vector_event::grow, old_cap, new_cap, size());
+            trace_finish(trace_t0, vector_event::grow, old_cap, new_cap, size());
         }
 
         //used for push_back and emplace_back, strong exception gaurantee
@@ -1252,6 +1580,14 @@ namespace std{
             // 1. allocate new memory
             size_type old_size = size();
             size_type new_cap = calculate_growth(1);
+            if(expand_in_place(new_cap)){
+                // nothing moved, the arguments are still valid
+                std::allocator_traits<rebound_alloc_type>::construct(rebound_alloc, std::to_address(m_finish), std::forward<Args>(args)...);
+                ++m_finish;
+                return;
+            }
+            size_type old_cap = capacity();
+            const std::uint64_t trace_t0 = trace_start(vector_event::append, old_size);
             pointer new_start = std::allocator_traits<rebound_alloc_type>::allocate(rebound_alloc, new_cap);
             pointer new_finish = new_start;
 
@@ -1284,6 +1620,8 @@ namespace std{
             m_start = new_start;
             m_finish = new_finish;
             m_end_of_storage = new_start + new_cap;
+            stats_relocated(vector_event::append, old_cap, new_cap, old_size);
+            trace_finish(trace_t0, vector_event::append, old_cap, new_cap, old_size);
         }
 
         //used for resize, strong exception gaurantee
@@ -1294,10 +1632,35 @@ namespace std{
         constexpr void realloc_resize(size_type count, Args&&... args){
             size_type old_size = size();
             size_type new_cap = calculate_growth(count-old_size);
-            pointer new_start = std::allocator_traits<rebound_alloc_type>::allocate(rebound_alloc, new_cap);
+            if(expand_in_place(new_cap)){
+                size_type i = old_size;
+                try{
+                    for(; i < count; ++i){
+                        std::allocator_traits<rebound_alloc_type>::construct(rebound_alloc, std::to_address(m_start+i), std::forward<Args>(args)...);
+                    }
+                }
+                catch(...){
+                    for(size_type j = old_size; j < i; ++j){
+                        std::allocator_traits<rebound_alloc_type>::destroy(rebound_alloc, std::to_address(m_start+j));
+                    }
+                    throw;
+                }
+                m_finish = m_start + count;
+                return;
+            }
+            size_type old_cap = capacity();
+            const std::uint64_t trace_t0 = trace_start(vector_event::resize, old_size);
+            bool zeroed = false;
+            pointer new_start = nullptr;
+            if constexpr(sizeof...(Args) == 0 && zeroed_is_value_initialized()){
+                zeroed = !std::is_constant_evaluated();
+                if(zeroed) new_start = vector_allocator_zeroed<rebound_alloc_type>::allocate_zeroed(rebound_alloc, new_cap);
+            }
+            if(!zeroed) new_start = std::allocator_traits<rebound_alloc_type>::allocate(rebound_alloc, new_cap);
             pointer new_finish = new_start;
 
-            size_type cur = old_size;
+            // the new elements are already there in zeroed memory
+            size_type cur = zeroed ? count : old_size;
             try{
                 // 2. construct the new element in the new memory
                 for(; cur < count; ++cur){
@@ -1333,6 +1696,8 @@ namespace std{
             m_start = new_start;
             m_finish = new_finish;
             m_end_of_storage = new_start + new_cap;
+            stats_relocated(vector_event::resize, old_cap, new_cap, old_size);
+            trace_finish(trace_t0, vector_event::resize, old_cap, new_cap, old_size);
         }
         
         // used for emplace and insert
@@ -1341,10 +1706,15 @@ namespace std{
             size_type idx = std::distance(cbegin(), pos);
             size_type this_size = size();
             size_type new_cap = calculate_growth(1);
+            if(expand_in_place(new_cap)){
+                // there is room now, so emplace shifts in place
+                return (void)emplace(pos, std::forward<Args>(args)...);
+            }
             pointer old_start = m_start;
             pointer old_finish = m_finish;
             size_type old_cap = capacity();
             
+            const std::uint64_t trace_t0 = trace_start(vector_event::insert, this_size);
             pointer new_start = std::allocator_traits<rebound_alloc_type>::allocate(rebound_alloc, new_cap);
             pointer new_finish = new_start;
             
@@ -1373,6 +1743,8 @@ namespace std{
                 m_start = new_start;
                 m_finish = new_finish;
                 m_end_of_storage = new_start + new_cap;
+                stats_relocated(vector_event::insert, old_cap, new_cap, this_size);
+                trace_finish(trace_t0, vector_event::insert, old_cap, new_cap, this_size);
                 
             } catch (...) {
                 for (pointer p = new_start; p != new_finish; ++p){
@@ -1389,6 +1761,12 @@ namespace std{
         constexpr size_type calculate_growth(size_type count_new_eles) {
             if (max_size() - size() < count_new_eles) throw std::length_error("vector too long");
             const size_type new_cap = size() + (std::max)(size(), count_new_eles);
+            if constexpr(vector_capacity_policy<T, Allocator>::enabled){
+                if(!std::is_constant_evaluated() && capacity() == 0 && new_cap >= size()){
+                    const size_type first = vector_capacity_policy<T, Allocator>::first_capacity(rebound_alloc, new_cap);
+                    if(first > new_cap) return (std::min)(first, max_size());
+                }
+            }
             return (new_cap < size() || new_cap > max_size()) ? max_size() : new_cap;
         }
 
@@ -1423,6 +1801,21 @@ namespace std{
         pointer m_end_of_storage;
     };
 
+    /*
+        Customization point for erase_if.
+        A specialization with enabled = true and a static
+            size_type remove_if(T* first, size_type n, const Pred& pred)
+        that moves the elements not matching pred to the front (keeping their order)
+        and returns how many there are replaces std::remove_if in erase_if.
+        It is only consulted for trivially copyable T, so the elements left behind
+        past the new end need nothing more than being dropped by erase.
+        ext/simd_algo.h specializes it for its SIMD predicates.
+    */
+    template<class T, class Pred>
+    struct vector_remove_if_kernel{
+        static constexpr bool enabled = false;
+    };
+
     /*
         Free functions, std::erase and std::erase_if
     */
@@ -1438,12 +1831,25 @@ namespace std{
     template< class T, class Alloc, class Pred >
     constexpr typename std::vector<T, Alloc>::size_type
     erase_if(vector<T, Alloc>& c, Pred pred ){
+        if constexpr(vector_remove_if_kernel<T, Pred>::enabled && std::is_trivially_copyable_v<T>){
+            if(!std::is_constant_evaluated()){
+                auto kept = vector_remove_if_kernel<T, Pred>::remove_if(c.data(), c.size(), pred);
+                auto r = c.size() - kept;
+                c.erase(c.begin() + kept, c.end());
+                return r;
+            }
+        }
         auto it = std::remove_if(c.begin(), c.end(), pred);
         auto r = std::distance(it, c.end());
         c.erase(it, c.end());
         return r;
     }
 
+    namespace pmr{
+        template<class T>
+        using vector = std::vector<T, polymorphic_allocator<T>>;
+    }
+
     /*
     Type deduction
     */
@@ -1459,3 +1865,45 @@ namespace std{
     template<typename InputIt>
     vector(InputIt, InputIt) -> vector<typename std::iterator_traits<InputIt>::value_type>;
 }
+
+//the pool resources in <memory_resource> are built on pmr::vector, so it can only
+//be included once the alias above exists
+#include <memory_resource>
+
+namespace std{
+    /*
+        Base for memory resources that can extend their most recent allocation in
+        place, such as ext::bump_arena; pmr::vector asks try_expand before it
+        allocates a bigger block.
+        A pmr::vector finds out whether its resource is one of these with a
+        dynamic_cast, once per growth. Nothing cheaper is sound: is_equal is
+        commonly forwarded by wrapping resources to the one they wrap, so an
+        answer from it says nothing about the wrapper's own type.
+    */
+    class vector_expandable_resource : public pmr::memory_resource{
+    public:
+        virtual bool try_expand(void* p, size_t old_bytes, size_t new_bytes) noexcept = 0;
+
+    protected:
+        bool do_is_equal(const pmr::memory_resource& other) const noexcept override{ return this == &other; }
+    };
+
+    template<class T>
+    struct vector_allocator_expand<pmr::polymorphic_allocator<T>>{
+        static constexpr bool enabled = true;
+
+        static bool expand(pmr::polymorphic_allocator<T>& alloc, T* p, size_t old_cap, size_t new_cap) noexcept{
+            auto* resource = dynamic_cast<vector_expandable_resource*>(alloc.resource());
+            if(!resource || new_cap > numeric_limits<size_t>::max() / sizeof(T)) return false;
+            return resource->try_expand(p, old_cap * sizeof(T), new_cap * sizeof(T));
+        }
+    };
+}
+
+#ifdef VECTOR_STATS
+#include "ext/vector_stats.h"
+#endif
+
+#ifdef VECTOR_TRACE
+#include "ext/vector_trace.h"
+#endif